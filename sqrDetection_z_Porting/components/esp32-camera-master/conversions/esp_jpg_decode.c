@@ -14,7 +14,9 @@
 #include "esp_jpg_decode.h"
 
 #include "esp_system.h"
-#if ESP_IDF_VERSION_MAJOR >= 4 // IDF 4+
+#if !defined(ESP_PLATFORM) // host builds of the tests
+#include "tjpgd.h"
+#elif ESP_IDF_VERSION_MAJOR >= 4 // IDF 4+
 #if CONFIG_IDF_TARGET_ESP32 // ESP32/PICO-D4
 #include "esp32/rom/tjpgd.h"
 #elif CONFIG_IDF_TARGET_ESP32S3
@@ -38,6 +40,12 @@
 static const char* TAG = "esp_jpg_decode";
 #endif
 
+// the software decoder needs room for its Huffman lookahead tables, the ROM one does not
+#ifndef JD_SZLUT
+#define JD_SZLUT 0
+#endif
+#define JPG_WORK_LEN (3100 + JD_SZLUT)
+
 typedef struct {
         jpg_scale_t scale;
         jpg_reader_cb reader;
@@ -93,7 +101,7 @@ static unsigned int _jpg_read(JDEC *decoder, uint8_t *buf, unsigned int len)
 
 esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg)
 {
-    static uint8_t work[3100];
+    static uint8_t work[JPG_WORK_LEN];
     JDEC decoder;
     esp_jpg_decoder_t jpeg;
 
@@ -104,7 +112,7 @@ esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jp
     jpeg.scale = scale;
     jpeg.index = 0;
 
-    JRESULT jres = jd_prepare(&decoder, _jpg_read, work, 3100, &jpeg);
+    JRESULT jres = jd_prepare(&decoder, _jpg_read, work, JPG_WORK_LEN, &jpeg);
     if(jres != JDR_OK){
         ESP_LOGE(TAG, "JPG Header Parse Failed! %s", jd_errors[jres]);
         return ESP_FAIL;
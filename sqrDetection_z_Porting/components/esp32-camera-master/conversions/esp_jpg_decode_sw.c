@@ -0,0 +1,535 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "esp_jpg_decode.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Front-ends that need more than the ROM decoder offers (luma output, partial
+// decode), so they always use the software decoder
+#include "tjpgd.h"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#define TAG ""
+#else
+#include "esp_log.h"
+static const char* TAG = "esp_jpg_decode_sw";
+#endif
+
+// pool of one decoder, from the heap: with the Huffman lookahead tables it is too
+// big for the stacks of the callers
+#define JPG_SW_WORK_LEN (3100 + JD_SZLUT)
+#define JPG_BAND_TASK_STACK 3072
+
+typedef struct {
+        jpg_scale_t scale;
+        jpg_reader_cb reader;
+        jpg_writer_cb writer;
+        void * arg;
+        size_t len;
+        size_t index;
+} esp_jpg_decoder_t;
+
+static const char * jd_errors[] = {
+    "Succeeded",
+    "Interrupted by output function",
+    "Device error or wrong termination of input stream",
+    "Insufficient memory pool for the image",
+    "Insufficient stream input buffer",
+    "Parameter error",
+    "Data format error",
+    "Right format but not supported",
+    "Not supported JPEG standard"
+};
+
+static unsigned int _jpg_write(JDEC *decoder, void *bitmap, JRECT *rect)
+{
+    uint16_t x = rect->left;
+    uint16_t y = rect->top;
+    uint16_t w = rect->right + 1 - x;
+    uint16_t h = rect->bottom + 1 - y;
+    uint8_t *data = (uint8_t *)bitmap;
+
+    esp_jpg_decoder_t * jpeg = (esp_jpg_decoder_t *)decoder->device;
+
+    if (jpeg->writer) {
+        return jpeg->writer(jpeg->arg, x, y, w, h, data);
+    }
+    return 0;
+}
+
+static unsigned int _jpg_read(JDEC *decoder, uint8_t *buf, unsigned int len)
+{
+    esp_jpg_decoder_t * jpeg = (esp_jpg_decoder_t *)decoder->device;
+    if (jpeg->len && len > (jpeg->len - jpeg->index)) {
+        len = jpeg->len - jpeg->index;
+    }
+    if (len) {
+        len = jpeg->reader(jpeg->arg, jpeg->index, buf, len);
+        if (!len) {
+            ESP_LOGE(TAG, "Read Fail at %u/%u", jpeg->index, jpeg->len);
+        }
+        jpeg->index += len;
+    }
+    return len;
+}
+
+static esp_err_t _jpg_decode_gray(uint8_t * work, size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg)
+{
+    JDEC decoder;
+    esp_jpg_decoder_t jpeg;
+
+    jpeg.len = len;
+    jpeg.reader = reader;
+    jpeg.writer = writer;
+    jpeg.arg = arg;
+    jpeg.scale = scale;
+    jpeg.index = 0;
+
+    JRESULT jres = jd_prepare(&decoder, _jpg_read, work, JPG_SW_WORK_LEN, &jpeg);
+    if(jres != JDR_OK){
+        ESP_LOGE(TAG, "JPG Header Parse Failed! %s", jd_errors[jres]);
+        return ESP_FAIL;
+    }
+    decoder.outfmt = JD_OUT_GRAY;
+
+    uint16_t output_width = decoder.width / (1 << (uint8_t)(jpeg.scale));
+    uint16_t output_height = decoder.height / (1 << (uint8_t)(jpeg.scale));
+
+    //output start
+    if (!writer(arg, 0, 0, output_width, output_height, NULL)) {
+        ESP_LOGE(TAG, "JPG output rejected %ux%u", output_width, output_height);
+        return ESP_FAIL;
+    }
+    //output write
+    jres = jd_decomp(&decoder, _jpg_write, (uint8_t)jpeg.scale);
+    //output end
+    writer(arg, output_width, output_height, output_width, output_height, NULL);
+
+    if (jres != JDR_OK) {
+        ESP_LOGE(TAG, "JPG Decompression Failed! %s", jd_errors[jres]);
+        return ESP_FAIL;
+    }
+    //check if all data has been consumed.
+    if (len && jpeg.index < len) {
+        _jpg_read(&decoder, NULL, len - jpeg.index);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jpg_decode_gray(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg)
+{
+    // one pool per call so that decodes running on both cores do not share it
+    uint8_t * work = (uint8_t *)malloc(JPG_SW_WORK_LEN);
+    if (!work) {
+        ESP_LOGE(TAG, "JPG work buffer malloc failed");
+        return ESP_FAIL;
+    }
+    esp_err_t err = _jpg_decode_gray(work, len, scale, reader, writer, arg);
+    free(work);
+    return err;
+}
+
+/*
+ * Split-frame decode
+ *
+ * When the stream has a restart interval (DRI), every RSTn marker resets the
+ * DC predictors, so the entropy-coded data after a marker can be decoded
+ * without the data before it. The picture is cut at the marker closest to
+ * its middle (preferring one that starts an MCU row) and the two halves are
+ * decoded by two software decoders, the second one on the other core.
+ * Each decoder parses the headers itself and then reads a virtual stream made
+ * of the headers followed by the entropy-coded data of its band.
+ */
+
+typedef struct {
+        const uint8_t * src;
+        size_t len;
+        size_t hdr_len;     // bytes up to the first entropy-coded byte
+        size_t data_ofs;    // offset of the first entropy-coded byte of the band
+        size_t index;       // read position in the virtual stream
+        jpg_scale_t scale;
+        uint8_t outfmt;
+        unsigned int mcu_first;
+        unsigned int mcu_count;
+        jpg_writer_cb writer;
+        void * arg;
+        JRESULT result;
+#ifdef ESP_PLATFORM
+        SemaphoreHandle_t done;
+#endif
+} jpg_band_t;
+
+static unsigned int _band_read(JDEC *decoder, uint8_t *buf, unsigned int len)
+{
+    jpg_band_t * band = (jpg_band_t *)decoder->device;
+    size_t vlen = band->hdr_len + (band->len - band->data_ofs);
+    if (len > vlen - band->index) {
+        len = vlen - band->index;
+    }
+    size_t done = 0;
+    while (done < len) {
+        size_t i = band->index + done;
+        // headers are shared, entropy-coded data starts at the band offset
+        size_t ofs = (i < band->hdr_len) ? i : band->data_ofs + (i - band->hdr_len);
+        size_t n = (i < band->hdr_len) ? band->hdr_len - i : len - done;
+        if (n > len - done) {
+            n = len - done;
+        }
+        if (buf) {
+            memcpy(buf + done, band->src + ofs, n);
+        }
+        done += n;
+    }
+    band->index += len;
+    return len;
+}
+
+static unsigned int _band_write(JDEC *decoder, void *bitmap, JRECT *rect)
+{
+    jpg_band_t * band = (jpg_band_t *)decoder->device;
+    return band->writer(band->arg, rect->left, rect->top, rect->right + 1 - rect->left, rect->bottom + 1 - rect->top, (uint8_t *)bitmap);
+}
+
+static void _band_decode(jpg_band_t * band)
+{
+    uint8_t * work = (uint8_t *)malloc(JPG_SW_WORK_LEN);
+    JDEC decoder;
+
+    if (!work) {
+        band->result = JDR_MEM1;
+        return;
+    }
+    band->index = 0;
+    band->result = jd_prepare(&decoder, _band_read, work, JPG_SW_WORK_LEN, band);
+    if (band->result == JDR_OK) {
+        decoder.outfmt = band->outfmt;
+        band->result = jd_decomp_part(&decoder, _band_write, (uint8_t)band->scale, band->mcu_first, band->mcu_count);
+    }
+    free(work);
+}
+
+#ifdef ESP_PLATFORM
+static void _band_task(void * arg)
+{
+    jpg_band_t * band = (jpg_band_t *)arg;
+    _band_decode(band);
+    xSemaphoreGive(band->done);
+    vTaskDelete(NULL);
+}
+#else
+static void * _band_thread(void * arg)
+{
+    _band_decode((jpg_band_t *)arg);
+    return NULL;
+}
+#endif
+
+// offset of the first entropy-coded byte (end of the SOS segment), 0 if not found
+static size_t _jpg_scan_offset(const uint8_t * src, size_t len)
+{
+    size_t i = 2;
+    while (i + 4 <= len) {
+        if (src[i] != 0xFF) {
+            return 0;
+        }
+        uint8_t marker = src[i + 1];
+        size_t seg_len = ((size_t)src[i + 2] << 8) | src[i + 3];
+        i += 2 + seg_len;
+        if (marker == 0xDA) {
+            return (i <= len) ? i : 0;
+        }
+    }
+    return 0;
+}
+
+// offset right after the n-th (1-based) RSTn marker of the entropy-coded data, 0 if not found
+static size_t _jpg_rst_offset(const uint8_t * src, size_t len, size_t start, unsigned int n)
+{
+    for (size_t i = start; i + 1 < len; i++) {
+        if (src[i] == 0xFF && (src[i + 1] & 0xF8) == 0xD0 && !--n) {
+            return i + 2;
+        }
+    }
+    return 0;
+}
+
+// restart segment (1-based) where the second band starts, 0 if the picture cannot be split.
+// The segment closest to the middle wins; on a tie the one starting an MCU row is preferred.
+static unsigned int _jpg_split_segment(unsigned int segments, unsigned int nrst, unsigned int nx)
+{
+    unsigned int best = 0, best_d = 0;
+    bool best_row = false;
+    for (unsigned int s = 1; s < segments; s++) {
+        unsigned int d = (s * 2 > segments) ? s * 2 - segments : segments - s * 2;
+        bool row = !((s * nrst) % nx);
+        if (!best || d < best_d || (d == best_d && row && !best_row)) {
+            best = s;
+            best_d = d;
+            best_row = row;
+        }
+    }
+    return best;
+}
+
+static esp_err_t _jpg_decode_split(uint8_t * work, const uint8_t * src, size_t len, jpg_scale_t scale, bool gray, jpg_writer_cb writer, void * arg)
+{
+    jpg_band_t bands[2];
+    JDEC decoder;
+
+    // parse the headers once to get the geometry and the restart interval
+    memset(bands, 0, sizeof(bands));
+    bands[0].src = src;
+    bands[0].len = len;
+    bands[0].hdr_len = _jpg_scan_offset(src, len);
+    bands[0].data_ofs = bands[0].hdr_len;
+    bands[0].scale = scale;
+    bands[0].outfmt = gray ? JD_OUT_GRAY : JD_OUT_COLOR;
+    bands[0].writer = writer;
+    bands[0].arg = arg;
+    if (!bands[0].hdr_len) {
+        ESP_LOGE(TAG, "JPG Header Parse Failed! No scan data");
+        return ESP_FAIL;
+    }
+    JRESULT jres = jd_prepare(&decoder, _band_read, work, JPG_SW_WORK_LEN, &bands[0]);
+    if (jres != JDR_OK) {
+        ESP_LOGE(TAG, "JPG Header Parse Failed! %s", jd_errors[jres]);
+        return ESP_FAIL;
+    }
+
+    unsigned int mcu_w = decoder.msx * 8, mcu_h = decoder.msy * 8;
+    unsigned int nx = (decoder.width + mcu_w - 1) / mcu_w;
+    unsigned int total = nx * ((decoder.height + mcu_h - 1) / mcu_h);
+    unsigned int segments = decoder.nrst ? (total + decoder.nrst - 1) / decoder.nrst : 1;
+    uint16_t output_width = decoder.width / (1 << (uint8_t)scale);
+    uint16_t output_height = decoder.height / (1 << (uint8_t)scale);
+    bands[0].mcu_count = total;
+
+    // cut at the restart segment closest to the middle of the picture
+    unsigned int split = _jpg_split_segment(segments, decoder.nrst, nx);
+    if (split) {
+        bands[1] = bands[0];
+        bands[1].data_ofs = _jpg_rst_offset(src, len, bands[0].hdr_len, split);
+        if (!bands[1].data_ofs) {
+            ESP_LOGW(TAG, "RST%u not found, decoding on one core", (split - 1) & 7);
+            split = 0;
+        }
+    }
+
+    //output start
+    if (!writer(arg, 0, 0, output_width, output_height, NULL)) {
+        ESP_LOGE(TAG, "JPG output rejected %ux%u", output_width, output_height);
+        return ESP_FAIL;
+    }
+
+    // the second band runs on the other core while this one decodes the first band
+    // with the decoder that already parsed the headers
+    bool threaded = false;
+#ifndef ESP_PLATFORM
+    pthread_t thread;
+#endif
+    bands[1].result = JDR_OK;
+    if (split) {
+        bands[0].mcu_count = split * decoder.nrst;
+        bands[1].mcu_first = bands[0].mcu_count;
+        bands[1].mcu_count = total - bands[0].mcu_count;
+#ifdef ESP_PLATFORM
+        bands[1].done = xSemaphoreCreateBinary();
+        if (bands[1].done) {
+            threaded = xTaskCreatePinnedToCore(_band_task, "jpg_band", JPG_BAND_TASK_STACK, &bands[1],
+                                               uxTaskPriorityGet(NULL), NULL, !xPortGetCoreID()) == pdPASS;
+        }
+#else
+        threaded = pthread_create(&thread, NULL, _band_thread, &bands[1]) == 0;
+#endif
+    }
+
+    decoder.outfmt = bands[0].outfmt;
+    bands[0].result = jd_decomp_part(&decoder, _band_write, (uint8_t)scale, 0, bands[0].mcu_count);
+
+    if (threaded) {
+#ifdef ESP_PLATFORM
+        xSemaphoreTake(bands[1].done, portMAX_DELAY);
+#else
+        pthread_join(thread, NULL);
+#endif
+    } else if (split) {
+        // no second decoder could be started, decode the bands one after the other
+        _band_decode(&bands[1]);
+    }
+#ifdef ESP_PLATFORM
+    if (bands[1].done) {
+        vSemaphoreDelete(bands[1].done);
+    }
+#endif
+
+    //output end
+    writer(arg, output_width, output_height, output_width, output_height, NULL);
+
+    for (int i = 0; i < 2; i++) {
+        if (bands[i].result != JDR_OK) {
+            ESP_LOGE(TAG, "JPG Decompression Failed! %s (band %d)", jd_errors[bands[i].result], i);
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_jpg_decode_split(const uint8_t * src, size_t len, jpg_scale_t scale, bool gray, jpg_writer_cb writer, void * arg)
+{
+    uint8_t * work = (uint8_t *)malloc(JPG_SW_WORK_LEN);
+    if (!work) {
+        ESP_LOGE(TAG, "JPG work buffer malloc failed");
+        return ESP_FAIL;
+    }
+    esp_err_t err = _jpg_decode_split(work, src, len, scale, gray, writer, arg);
+    free(work);
+    return err;
+}
+
+/*
+ * Patch decode
+ *
+ * The patches are turned into MCU regions for jd_decomp_rect, which only
+ * transforms the MCUs inside them. Each MCU written is copied to every patch
+ * it overlaps.
+ */
+
+typedef struct {
+        jpg_patch_t * patches;
+        size_t count;
+        size_t bpp;
+} jpg_patch_set_t;
+
+static unsigned int _patch_write(JDEC *decoder, void *bitmap, JRECT *rect)
+{
+    jpg_band_t * band = (jpg_band_t *)decoder->device;
+    jpg_patch_set_t * set = (jpg_patch_set_t *)band->arg;
+    const uint8_t * data = (const uint8_t *)bitmap;
+    size_t w = rect->right + 1 - rect->left;
+
+    for (size_t i = 0; i < set->count; i++) {
+        jpg_patch_t * p = &set->patches[i];
+        int x0 = (rect->left > p->x) ? rect->left : p->x;
+        int y0 = (rect->top > p->y) ? rect->top : p->y;
+        int x1 = (rect->right < p->x + p->w - 1) ? rect->right : p->x + p->w - 1;
+        int y1 = (rect->bottom < p->y + p->h - 1) ? rect->bottom : p->y + p->h - 1;
+        for (int y = y0; y <= y1 && x0 <= x1; y++) {
+            memcpy(p->buf + (y - p->y) * p->stride + (x0 - p->x) * set->bpp,
+                   data + ((y - rect->top) * w + (x0 - rect->left)) * set->bpp,
+                   (x1 - x0 + 1) * set->bpp);
+        }
+    }
+    return 1;
+}
+
+static esp_err_t _jpg_decode_patches(uint8_t * work, JRECT * regions, const uint8_t * src, size_t len, jpg_scale_t scale, bool gray, jpg_patch_t * patches, size_t count)
+{
+    jpg_patch_set_t set = { patches, count, gray ? 1 : 3 };
+    jpg_band_t band;
+    JDEC decoder;
+
+    memset(&band, 0, sizeof(band));
+    band.src = src;
+    band.len = len;
+    band.hdr_len = _jpg_scan_offset(src, len);
+    band.data_ofs = band.hdr_len;
+    band.arg = &set;
+    if (!band.hdr_len) {
+        ESP_LOGE(TAG, "JPG Header Parse Failed! No scan data");
+        return ESP_FAIL;
+    }
+    JRESULT jres = jd_prepare(&decoder, _band_read, work, JPG_SW_WORK_LEN, &band);
+    if (jres != JDR_OK) {
+        ESP_LOGE(TAG, "JPG Header Parse Failed! %s", jd_errors[jres]);
+        return ESP_FAIL;
+    }
+    decoder.outfmt = gray ? JD_OUT_GRAY : JD_OUT_COLOR;
+
+    // patches in input pixels, clipped to the picture; those outside it are dropped
+    unsigned int mcu_w = decoder.msx * 8, mcu_h = decoder.msy * 8;
+    unsigned int nx = (decoder.width + mcu_w - 1) / mcu_w;
+    unsigned int first = UINT32_MAX;
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned int left = (unsigned int)patches[i].x << scale, top = (unsigned int)patches[i].y << scale;
+        unsigned int right = ((unsigned int)(patches[i].x + patches[i].w) << scale) - 1;
+        unsigned int bottom = ((unsigned int)(patches[i].y + patches[i].h) << scale) - 1;
+        if (!patches[i].w || !patches[i].h || left >= decoder.width || top >= decoder.height) {
+            continue;
+        }
+        regions[n].left = left;
+        regions[n].top = top;
+        regions[n].right = (right < decoder.width) ? right : decoder.width - 1;
+        regions[n].bottom = (bottom < decoder.height) ? bottom : decoder.height - 1;
+        unsigned int mcu = (top / mcu_h) * nx + left / mcu_w;
+        if (mcu < first) {
+            first = mcu;
+        }
+        n++;
+    }
+    if (!n) {
+        return ESP_OK;
+    }
+
+    // with restart markers, skip the entropy-coded data before the first MCU needed
+    unsigned int mcu_first = 0;
+    unsigned int segment = decoder.nrst ? first / decoder.nrst : 0;
+    if (segment) {
+        band.data_ofs = _jpg_rst_offset(src, len, band.hdr_len, segment);
+        if (band.data_ofs) {
+            mcu_first = segment * decoder.nrst;
+            band.index = 0;
+            jres = jd_prepare(&decoder, _band_read, work, JPG_SW_WORK_LEN, &band);
+            decoder.outfmt = gray ? JD_OUT_GRAY : JD_OUT_COLOR;
+        } else {
+            ESP_LOGW(TAG, "RST%u not found, decoding from the start", (segment - 1) & 7);
+            band.data_ofs = band.hdr_len;
+        }
+    }
+
+    if (jres == JDR_OK) {
+        jres = jd_decomp_rect(&decoder, _patch_write, (uint8_t)scale, mcu_first, regions, n);
+    }
+    if (jres != JDR_OK) {
+        ESP_LOGE(TAG, "JPG Decompression Failed! %s", jd_errors[jres]);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_jpg_decode_patches(const uint8_t * src, size_t len, jpg_scale_t scale, bool gray, jpg_patch_t * patches, size_t count)
+{
+    uint8_t * work = (uint8_t *)malloc(JPG_SW_WORK_LEN);
+    JRECT * regions = (JRECT *)malloc(count * sizeof(JRECT) + 1);
+    if (!work || !regions) {
+        ESP_LOGE(TAG, "JPG work buffer malloc failed");
+        free(work);
+        free(regions);
+        return ESP_FAIL;
+    }
+    esp_err_t err = _jpg_decode_patches(work, regions, src, len, scale, gray, patches, count);
+    free(regions);
+    free(work);
+    return err;
+}
@@ -36,6 +36,57 @@ typedef bool (* jpg_writer_cb)(void * arg, uint16_t x, uint16_t y, uint16_t w, u
 
 esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg);
 
+/**
+ * @brief Decode a JPEG stream to 8-bit luma only
+ *
+ * Same contract as esp_jpg_decode, but the writer receives w*h grayscale bytes
+ * per rectangle instead of RGB888. Chroma is entropy-decoded and dropped without
+ * IDCT or colour conversion. Returning false from the start call (data == NULL,
+ * x == y == 0) aborts the decode before any MCU is processed.
+ */
+esp_err_t esp_jpg_decode_gray(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg);
+
+/**
+ * @brief Decode an in-memory JPEG on both cores using its restart markers
+ *
+ * If the stream has a restart interval, it is cut at the RSTn marker closest to
+ * the middle and the two halves are decoded concurrently into disjoint MCU bands
+ * (row bands when the interval is a whole number of MCU rows). Without restart
+ * markers the picture is decoded on the calling core. The output is identical to
+ * a single-threaded decode; the writer must accept concurrent calls for
+ * non-overlapping rectangles.
+ *
+ * @param gray  true for 8-bit luma output (as esp_jpg_decode_gray), false for RGB888
+ */
+esp_err_t esp_jpg_decode_split(const uint8_t * src, size_t len, jpg_scale_t scale, bool gray, jpg_writer_cb writer, void * arg);
+
+/**
+ * @brief Region of the decoded picture written by esp_jpg_decode_patches
+ *
+ * Coordinates are in output (scaled) pixels. buf receives h rows of w pixels,
+ * stride bytes apart; pixels falling outside the picture are left untouched.
+ */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint8_t * buf;
+    size_t stride;
+} jpg_patch_t;
+
+/**
+ * @brief Decode only the parts of an in-memory JPEG covered by some patches
+ *
+ * Only the MCUs intersecting a patch go through IDCT and colour conversion; the
+ * others are entropy-decoded to keep the stream position and DC predictors, and
+ * the decode stops after the last MCU needed. With a restart interval it starts
+ * at the RSTn marker preceding the first MCU needed.
+ *
+ * @param gray  true for 8-bit luma patches, false for RGB888
+ */
+esp_err_t esp_jpg_decode_patches(const uint8_t * src, size_t len, jpg_scale_t scale, bool gray, jpg_patch_t * patches, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
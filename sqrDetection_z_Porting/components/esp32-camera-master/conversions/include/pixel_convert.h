@@ -0,0 +1,94 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _PIXEL_CONVERT_H_
+#define _PIXEL_CONVERT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Line kernels converting between the pixel formats used by the camera and the
+ * converters. Byte orders:
+ *
+ *   RGB565    big-endian, as sent by the sensor (RRRRRGGG GGGBBBBB)
+ *   RGB565LE  little-endian, as expected by the LCD helpers
+ *   RGB888    R, G, B
+ *   BGR888    B, G, R (BMP and OpenCV order)
+ *   YUYV      Y0, U, Y1, V (PIXFORMAT_YUV422)
+ *   GRAY      8-bit luma, (R*4899 + G*9617 + B*1868 + 8192) >> 14 from RGB
+ *
+ * Every kernel converts `pixels` pixels from `src` to `dst`. Buffers of any
+ * alignment are accepted, but the word-at-a-time kernels only kick in when both
+ * are 32-bit aligned. Apart from pixconv_swap_rb the buffers must not overlap.
+ * All implementations produce the same bytes as the scalar reference.
+ */
+
+typedef enum {
+    PIXCONV_AUTO,       // fastest implementation supported by this CPU
+    PIXCONV_SCALAR,     // byte loops, the reference
+    PIXCONV_SWAR,       // 32-bit word at a time (default on Xtensa)
+    PIXCONV_SSSE3,      // x86 hosts
+    PIXCONV_NEON,       // ARM hosts
+} pixconv_impl_t;
+
+/**
+ * @brief Select the kernels used by the pixconv_* functions
+ *
+ * Done automatically (PIXCONV_AUTO) on the first conversion, so it only has to
+ * be called to compare implementations.
+ *
+ * @param impl  Implementation to use
+ *
+ * @return true if the CPU supports it (otherwise the selection is unchanged)
+ */
+bool pixconv_select(pixconv_impl_t impl);
+
+/**
+ * @brief Name of the selected implementation ("scalar", "swar", "ssse3", "neon")
+ */
+const char * pixconv_name(void);
+
+void pixconv_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+/**
+ * @brief Swap the R and B bytes of packed 24-bit pixels (RGB888 <-> BGR888)
+ *
+ * `src` and `dst` may be the same buffer.
+ */
+void pixconv_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+/*
+ * YUYV carries chroma per pair of pixels: the RGB kernels convert pixels / 2
+ * pairs and leave a trailing odd pixel untouched. The gray kernel converts all.
+ */
+void pixconv_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_yuyv_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void pixconv_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PIXEL_CONVERT_H_ */
@@ -22,6 +22,16 @@
 #define JPGE_MAX(a,b) (((a)>(b))?(a):(b))
 #define JPGE_MIN(a,b) (((a)<(b))?(a):(b))
 
+// Y_ONLY images go through a dedicated block coder (AAN DCT with the quantizer folded in,
+// combined Huffman entries, 32-bit bit accumulator). 0 uses the generic path for every image.
+#ifndef JPGE_FAST_GREY
+#define JPGE_FAST_GREY 1
+#endif
+// Above this quality the rounding of the fast DCT shows (PSNR at 100 drops ~7dB), use the accurate one.
+#ifndef JPGE_FAST_GREY_MAX_QUALITY
+#define JPGE_FAST_GREY_MAX_QUALITY 95
+#endif
+
 namespace jpge {
 
     static inline void *jpge_malloc(size_t nSize) {
@@ -70,6 +80,7 @@ namespace jpge {
 
     const int YR = 19595, YG = 38470, YB = 7471, CB_R = -11059, CB_G = -21709, CB_B = 32768, CR_R = 32768, CR_G = -27439, CR_B = -5329;
 
+    // Tables shared by every encoder: to_jpg.cpp runs one encoder at a time
     static int32 m_last_quality = 0;
     static int32 m_quantization_tables[2][64];
 
@@ -79,6 +90,15 @@ namespace jpge {
     static uint8 m_huff_bits[4][17];
     static uint8 m_huff_val[4][256];
 
+#if JPGE_FAST_GREY
+    // Grayscale fast path tables, in zigzag order: reciprocal of (luma quantizer * AAN output scale)
+    // as value and shift, and Huffman entries as (code << 8) | length.
+    static uint32 m_grey_recip[64];
+    static uint8 m_grey_shift[64];
+    static uint32 m_grey_dc_huff[DC_LUM_CODES];
+    static uint32 m_grey_ac_huff[AC_LUM_CODES];
+#endif
+
     static inline uint8 clamp(int i) {
         if (i < 0) {
             i = 0;
@@ -147,6 +167,70 @@ namespace jpge {
         }
     }
 
+#if JPGE_FAST_GREY
+    // Forward DCT - fixed-point AAN, derived from jfdctfst. The outputs are scaled by
+    // 8 * s[u] * s[v] (s[0] = 1, s[k] = cos(k*PI/16) * sqrt(2)), the quantizer removes that scale.
+    enum { AAN_BITS = 8 };
+#define AAN_MUL(var, c) (((var) * (c)) >> AAN_BITS)
+#define AAN_0_382683433 98
+#define AAN_0_541196100 139
+#define AAN_0_707106781 181
+#define AAN_1_306562965 334
+#define AAN1D(s0, s1, s2, s3, s4, s5, s6, s7) \
+    int32 t0 = s0 + s7, t7 = s0 - s7, t1 = s1 + s6, t6 = s1 - s6, t2 = s2 + s5, t5 = s2 - s5, t3 = s3 + s4, t4 = s3 - s4; \
+    int32 t10 = t0 + t3, t13 = t0 - t3, t11 = t1 + t2, t12 = t1 - t2; \
+    s0 = t10 + t11; s4 = t10 - t11; \
+    int32 z1 = AAN_MUL(t12 + t13, AAN_0_707106781); \
+    s2 = t13 + z1; s6 = t13 - z1; \
+    t10 = t4 + t5; t11 = t5 + t6; t12 = t6 + t7; \
+    int32 z5 = AAN_MUL(t10 - t12, AAN_0_382683433); \
+    int32 z2 = AAN_MUL(t10, AAN_0_541196100) + z5; \
+    int32 z4 = AAN_MUL(t12, AAN_1_306562965) + z5; \
+    int32 z3 = AAN_MUL(t11, AAN_0_707106781); \
+    int32 z11 = t7 + z3, z13 = t7 - z3; \
+    s5 = z13 + z2; s3 = z13 - z2; s1 = z11 + z4; s7 = z11 - z4;
+
+    static void DCT2D_AAN(int32 *p) {
+        int32 c, *q = p;
+        for (c = 7; c >= 0; c--, q += 8) {
+            int32 s0 = q[0], s1 = q[1], s2 = q[2], s3 = q[3], s4 = q[4], s5 = q[5], s6 = q[6], s7 = q[7];
+            AAN1D(s0, s1, s2, s3, s4, s5, s6, s7);
+            q[0] = s0; q[1] = s1; q[2] = s2; q[3] = s3; q[4] = s4; q[5] = s5; q[6] = s6; q[7] = s7;
+        }
+        for (q = p, c = 7; c >= 0; c--, q++) {
+            int32 s0 = q[0*8], s1 = q[1*8], s2 = q[2*8], s3 = q[3*8], s4 = q[4*8], s5 = q[5*8], s6 = q[6*8], s7 = q[7*8];
+            AAN1D(s0, s1, s2, s3, s4, s5, s6, s7);
+            q[0*8] = s0; q[1*8] = s1; q[2*8] = s2; q[3*8] = s3; q[4*8] = s4; q[5*8] = s5; q[6*8] = s6; q[7*8] = s7;
+        }
+    }
+
+    // Fold the AAN output scale into the luma quantizer. |DCT output| < 2^14, so reciprocals
+    // are kept below 2^17 with the largest shift that allows it: the product fits 32 bits.
+    static void compute_grey_quant(const int32 *pQuant)
+    {
+        static const double aan_scale[8] = { 1.0, 1.387039845, 1.306562965, 1.175875602, 1.0, 0.785694958, 0.541196100, 0.275899379 };
+        for (int i = 0; i < 64; i++) {
+            double d = pQuant[i] * 8.0 * aan_scale[s_zag[i] >> 3] * aan_scale[s_zag[i] & 7];
+            int shift = 0;
+            while (shift < 30 && (double)(1u << (shift + 1)) / d < 131072.0) {
+                shift++;
+            }
+            m_grey_recip[i] = static_cast<uint32>((double)(1u << shift) / d + 0.5);
+            m_grey_shift[i] = static_cast<uint8>(shift);
+        }
+    }
+
+    static void compute_grey_huffman()
+    {
+        for (int i = 0; i < DC_LUM_CODES; i++) {
+            m_grey_dc_huff[i] = (m_huff_codes[0+0][i] << 8) | m_huff_code_sizes[0+0][i];
+        }
+        for (int i = 0; i < AC_LUM_CODES; i++) {
+            m_grey_ac_huff[i] = (m_huff_codes[2+0][i] << 8) | m_huff_code_sizes[2+0][i];
+        }
+    }
+#endif
+
     // Compute the actual canonical Huffman codes/code sizes given the JPEG huff bits and val arrays.
     static void compute_huffman_table(uint *codes, uint8 *code_sizes, uint8 *bits, uint8 *val)
     {
@@ -477,10 +561,107 @@ namespace jpge {
         code_coefficients_pass_two(component_num);
     }
 
+#if JPGE_FAST_GREY
+    // Append len (<= 24) bits to the left-aligned accumulator and emit the complete bytes.
+#define GREY_PUT(bits, len) do { \
+        cnt += (len); acc |= (uint32)(bits) << (32 - cnt); \
+        while (cnt >= 8) { \
+            uint8 c_ = static_cast<uint8>(acc >> 24); \
+            emit_byte(c_); \
+            if (c_ == 0xFF) emit_byte(0); \
+            acc <<= 8; cnt -= 8; \
+        } \
+    } while (0)
+
+    void jpeg_encoder::code_block_grey(int x)
+    {
+        int32 ws[64];
+        int16 coef[64];
+        int i, last = 0;
+
+        // Load the block centred on 0
+        x <<= 3;
+        for (i = 0; i < 8; i++) {
+            const uint8 *pSrc = m_mcu_lines[i] + x;
+            int32 *pDst = ws + i * 8;
+            pDst[0] = pSrc[0] - 128; pDst[1] = pSrc[1] - 128; pDst[2] = pSrc[2] - 128; pDst[3] = pSrc[3] - 128;
+            pDst[4] = pSrc[4] - 128; pDst[5] = pSrc[5] - 128; pDst[6] = pSrc[6] - 128; pDst[7] = pSrc[7] - 128;
+        }
+
+        DCT2D_AAN(ws);
+
+        // Quantize in zigzag order (one multiply per coefficient), remembering the last non-zero one
+        for (i = 0; i < 64; i++) {
+            int32 c = ws[s_zag[i]];
+            uint32 a = (c < 0) ? -c : c;
+            int32 v = (a * m_grey_recip[i] + ((1u << m_grey_shift[i]) >> 1)) >> m_grey_shift[i];
+            if (v) {
+                // baseline AC values are 10 bits, rounding of the fast DCT must not go past them
+                if (i && v > 1023) v = 1023;
+                last = i;
+            }
+            coef[i] = static_cast<int16>((c < 0) ? -v : v);
+        }
+
+        // Huffman code: symbol and extra bits go out in one put whenever they fit
+        uint32 acc = m_bit_buffer << 8, e, nbits, bits;
+        uint cnt = m_bits_in;
+
+        int32 diff = coef[0] - m_last_dc_val[0];
+        m_last_dc_val[0] = coef[0];
+        nbits = diff ? 32 - __builtin_clz((diff < 0) ? -diff : diff) : 0;
+        bits = ((diff < 0) ? diff - 1 : diff) & ((1u << nbits) - 1);
+        e = m_grey_dc_huff[nbits];
+        GREY_PUT(((e >> 8) << nbits) | bits, (e & 0xFF) + nbits);
+
+        int run = 0;
+        for (i = 1; i <= last; i++) {
+            int32 v = coef[i];
+            if (!v) {
+                run++;
+                continue;
+            }
+            while (run >= 16) {
+                e = m_grey_ac_huff[0xF0];
+                GREY_PUT(e >> 8, e & 0xFF);
+                run -= 16;
+            }
+            nbits = 32 - __builtin_clz((v < 0) ? -v : v);
+            bits = ((v < 0) ? v - 1 : v) & ((1u << nbits) - 1);
+            e = m_grey_ac_huff[(run << 4) + nbits];
+            if ((e & 0xFF) + nbits <= 24) {
+                GREY_PUT(((e >> 8) << nbits) | bits, (e & 0xFF) + nbits);
+            } else {
+                GREY_PUT(e >> 8, e & 0xFF);
+                GREY_PUT(bits, nbits);
+            }
+            run = 0;
+        }
+        if (last < 63) {
+            e = m_grey_ac_huff[0];
+            GREY_PUT(e >> 8, e & 0xFF);
+        }
+
+        // back to the layout used by put_bits
+        m_bit_buffer = acc >> 8;
+        m_bits_in = cnt;
+    }
+#endif
+
     void jpeg_encoder::process_mcu_row()
     {
         if (m_num_components == 1)
         {
+#if JPGE_FAST_GREY
+            if (m_params.m_quality <= JPGE_FAST_GREY_MAX_QUALITY)
+            {
+                for (int i = 0; i < m_mcus_per_row; i++)
+                {
+                    code_block_grey(i);
+                }
+            }
+            else
+#endif
             for (int i = 0; i < m_mcus_per_row; i++)
             {
                 load_block_8_8_grey(i); code_block(0);
@@ -622,6 +803,9 @@ namespace jpge {
             m_last_quality = m_params.m_quality;
             compute_quant_table(m_quantization_tables[0], s_std_lum_quant);
             compute_quant_table(m_quantization_tables[1], s_std_croma_quant);
+#if JPGE_FAST_GREY
+            compute_grey_quant(m_quantization_tables[0]);
+#endif
         }
 
         if(!m_huff_initialized){
@@ -636,6 +820,9 @@ namespace jpge {
             compute_huffman_table(&m_huff_codes[2+0][0], &m_huff_code_sizes[2+0][0], m_huff_bits[2+0], m_huff_val[2+0]);
             compute_huffman_table(&m_huff_codes[0+1][0], &m_huff_code_sizes[0+1][0], m_huff_bits[0+1], m_huff_val[0+1]);
             compute_huffman_table(&m_huff_codes[2+1][0], &m_huff_code_sizes[2+1][0], m_huff_bits[2+1], m_huff_val[2+1]);
+#if JPGE_FAST_GREY
+            compute_grey_huffman();
+#endif
         }
 
         m_out_buf_left = JPGE_OUT_BUF_SIZE;
@@ -0,0 +1,1241 @@
+// Copyright 2015-2016 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "pixel_convert.h"
+#include <string.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "pixel_convert.c packs pixels into little-endian words"
+#endif
+
+// x86 hosts: SSSE3 kernels are compiled for that target only and picked at run time
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXCONV_HAS_SSSE3 1
+#include <tmmintrin.h>
+#define SSSE3_FN __attribute__((target("ssse3")))
+#endif
+
+// ARM hosts: NEON is part of the baseline whenever the compiler advertises it
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXCONV_HAS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// BT.601 luma in Q14, the same weights and rounding as cv::cvtColor(..., COLOR_BGR2GRAY)
+#define GRAY_R 4899
+#define GRAY_G 9617
+#define GRAY_B 1868
+#define GRAY_SHIFT 14
+
+// YUV -> RGB contributions, indexed by the Y, U or V byte
+typedef struct {
+        int16_t vY;
+        int16_t vVr;
+        int16_t vVg;
+        int16_t vUg;
+        int16_t vUb;
+} yuv_table_row;
+
+static const yuv_table_row yuv_table[256] = {
+    //  Y    Vr    Vg    Ug    Ub     // #
+    {  -18, -204,   50,  104, -258 }, // 0
+    {  -17, -202,   49,  103, -256 }, // 1
+    {  -16, -201,   49,  102, -254 }, // 2
+    {  -15, -199,   48,  101, -252 }, // 3
+    {  -13, -197,   48,  100, -250 }, // 4
+    {  -12, -196,   48,   99, -248 }, // 5
+    {  -11, -194,   47,   99, -246 }, // 6
+    {  -10, -193,   47,   98, -244 }, // 7
+    {   -9, -191,   46,   97, -242 }, // 8
+    {   -8, -189,   46,   96, -240 }, // 9
+    {   -6, -188,   46,   95, -238 }, // 10
+    {   -5, -186,   45,   95, -236 }, // 11
+    {   -4, -185,   45,   94, -234 }, // 12
+    {   -3, -183,   44,   93, -232 }, // 13
+    {   -2, -181,   44,   92, -230 }, // 14
+    {   -1, -180,   44,   91, -228 }, // 15
+    {    0, -178,   43,   91, -226 }, // 16
+    {    1, -177,   43,   90, -223 }, // 17
+    {    2, -175,   43,   89, -221 }, // 18
+    {    3, -173,   42,   88, -219 }, // 19
+    {    4, -172,   42,   87, -217 }, // 20
+    {    5, -170,   41,   86, -215 }, // 21
+    {    6, -169,   41,   86, -213 }, // 22
+    {    8, -167,   41,   85, -211 }, // 23
+    {    9, -165,   40,   84, -209 }, // 24
+    {   10, -164,   40,   83, -207 }, // 25
+    {   11, -162,   39,   82, -205 }, // 26
+    {   12, -161,   39,   82, -203 }, // 27
+    {   13, -159,   39,   81, -201 }, // 28
+    {   15, -158,   38,   80, -199 }, // 29
+    {   16, -156,   38,   79, -197 }, // 30
+    {   17, -154,   37,   78, -195 }, // 31
+    {   18, -153,   37,   78, -193 }, // 32
+    {   19, -151,   37,   77, -191 }, // 33
+    {   20, -150,   36,   76, -189 }, // 34
+    {   22, -148,   36,   75, -187 }, // 35
+    {   23, -146,   35,   74, -185 }, // 36
+    {   24, -145,   35,   73, -183 }, // 37
+    {   25, -143,   35,   73, -181 }, // 38
+    {   26, -142,   34,   72, -179 }, // 39
+    {   27, -140,   34,   71, -177 }, // 40
+    {   29, -138,   34,   70, -175 }, // 41
+    {   30, -137,   33,   69, -173 }, // 42
+    {   31, -135,   33,   69, -171 }, // 43
+    {   32, -134,   32,   68, -169 }, // 44
+    {   33, -132,   32,   67, -167 }, // 45
+    {   34, -130,   32,   66, -165 }, // 46
+    {   36, -129,   31,   65, -163 }, // 47
+    {   37, -127,   31,   65, -161 }, // 48
+    {   38, -126,   30,   64, -159 }, // 49
+    {   39, -124,   30,   63, -157 }, // 50
+    {   40, -122,   30,   62, -155 }, // 51
+    {   41, -121,   29,   61, -153 }, // 52
+    {   43, -119,   29,   60, -151 }, // 53
+    {   44, -118,   28,   60, -149 }, // 54
+    {   45, -116,   28,   59, -147 }, // 55
+    {   46, -114,   28,   58, -145 }, // 56
+    {   47, -113,   27,   57, -143 }, // 57
+    {   48, -111,   27,   56, -141 }, // 58
+    {   50, -110,   26,   56, -139 }, // 59
+    {   51, -108,   26,   55, -137 }, // 60
+    {   52, -106,   26,   54, -135 }, // 61
+    {   53, -105,   25,   53, -133 }, // 62
+    {   54, -103,   25,   52, -131 }, // 63
+    {   55, -102,   25,   52, -129 }, // 64
+    {   57, -100,   24,   51, -127 }, // 65
+    {   58,  -98,   24,   50, -125 }, // 66
+    {   59,  -97,   23,   49, -123 }, // 67
+    {   60,  -95,   23,   48, -121 }, // 68
+    {   61,  -94,   23,   47, -119 }, // 69
+    {   62,  -92,   22,   47, -117 }, // 70
+    {   64,  -90,   22,   46, -115 }, // 71
+    {   65,  -89,   21,   45, -113 }, // 72
+    {   66,  -87,   21,   44, -110 }, // 73
+    {   67,  -86,   21,   43, -108 }, // 74
+    {   68,  -84,   20,   43, -106 }, // 75
+    {   69,  -82,   20,   42, -104 }, // 76
+    {   71,  -81,   19,   41, -102 }, // 77
+    {   72,  -79,   19,   40, -100 }, // 78
+    {   73,  -78,   19,   39,  -98 }, // 79
+    {   74,  -76,   18,   39,  -96 }, // 80
+    {   75,  -75,   18,   38,  -94 }, // 81
+    {   76,  -73,   17,   37,  -92 }, // 82
+    {   77,  -71,   17,   36,  -90 }, // 83
+    {   79,  -70,   17,   35,  -88 }, // 84
+    {   80,  -68,   16,   34,  -86 }, // 85
+    {   81,  -67,   16,   34,  -84 }, // 86
+    {   82,  -65,   16,   33,  -82 }, // 87
+    {   83,  -63,   15,   32,  -80 }, // 88
+    {   84,  -62,   15,   31,  -78 }, // 89
+    {   86,  -60,   14,   30,  -76 }, // 90
+    {   87,  -59,   14,   30,  -74 }, // 91
+    {   88,  -57,   14,   29,  -72 }, // 92
+    {   89,  -55,   13,   28,  -70 }, // 93
+    {   90,  -54,   13,   27,  -68 }, // 94
+    {   91,  -52,   12,   26,  -66 }, // 95
+    {   93,  -51,   12,   26,  -64 }, // 96
+    {   94,  -49,   12,   25,  -62 }, // 97
+    {   95,  -47,   11,   24,  -60 }, // 98
+    {   96,  -46,   11,   23,  -58 }, // 99
+    {   97,  -44,   10,   22,  -56 }, // 100
+    {   98,  -43,   10,   21,  -54 }, // 101
+    {  100,  -41,   10,   21,  -52 }, // 102
+    {  101,  -39,    9,   20,  -50 }, // 103
+    {  102,  -38,    9,   19,  -48 }, // 104
+    {  103,  -36,    8,   18,  -46 }, // 105
+    {  104,  -35,    8,   17,  -44 }, // 106
+    {  105,  -33,    8,   17,  -42 }, // 107
+    {  107,  -31,    7,   16,  -40 }, // 108
+    {  108,  -30,    7,   15,  -38 }, // 109
+    {  109,  -28,    7,   14,  -36 }, // 110
+    {  110,  -27,    6,   13,  -34 }, // 111
+    {  111,  -25,    6,   13,  -32 }, // 112
+    {  112,  -23,    5,   12,  -30 }, // 113
+    {  114,  -22,    5,   11,  -28 }, // 114
+    {  115,  -20,    5,   10,  -26 }, // 115
+    {  116,  -19,    4,    9,  -24 }, // 116
+    {  117,  -17,    4,    8,  -22 }, // 117
+    {  118,  -15,    3,    8,  -20 }, // 118
+    {  119,  -14,    3,    7,  -18 }, // 119
+    {  121,  -12,    3,    6,  -16 }, // 120
+    {  122,  -11,    2,    5,  -14 }, // 121
+    {  123,   -9,    2,    4,  -12 }, // 122
+    {  124,   -7,    1,    4,  -10 }, // 123
+    {  125,   -6,    1,    3,   -8 }, // 124
+    {  126,   -4,    1,    2,   -6 }, // 125
+    {  128,   -3,    0,    1,   -4 }, // 126
+    {  129,   -1,    0,    0,   -2 }, // 127
+    {  130,    0,    0,    0,    0 }, // 128
+    {  131,    1,    0,    0,    2 }, // 129
+    {  132,    3,    0,   -1,    4 }, // 130
+    {  133,    4,   -1,   -2,    6 }, // 131
+    {  135,    6,   -1,   -3,    8 }, // 132
+    {  136,    7,   -1,   -4,   10 }, // 133
+    {  137,    9,   -2,   -4,   12 }, // 134
+    {  138,   11,   -2,   -5,   14 }, // 135
+    {  139,   12,   -3,   -6,   16 }, // 136
+    {  140,   14,   -3,   -7,   18 }, // 137
+    {  142,   15,   -3,   -8,   20 }, // 138
+    {  143,   17,   -4,   -8,   22 }, // 139
+    {  144,   19,   -4,   -9,   24 }, // 140
+    {  145,   20,   -5,  -10,   26 }, // 141
+    {  146,   22,   -5,  -11,   28 }, // 142
+    {  147,   23,   -5,  -12,   30 }, // 143
+    {  148,   25,   -6,  -13,   32 }, // 144
+    {  150,   27,   -6,  -13,   34 }, // 145
+    {  151,   28,   -7,  -14,   36 }, // 146
+    {  152,   30,   -7,  -15,   38 }, // 147
+    {  153,   31,   -7,  -16,   40 }, // 148
+    {  154,   33,   -8,  -17,   42 }, // 149
+    {  155,   35,   -8,  -17,   44 }, // 150
+    {  157,   36,   -8,  -18,   46 }, // 151
+    {  158,   38,   -9,  -19,   48 }, // 152
+    {  159,   39,   -9,  -20,   50 }, // 153
+    {  160,   41,  -10,  -21,   52 }, // 154
+    {  161,   43,  -10,  -21,   54 }, // 155
+    {  162,   44,  -10,  -22,   56 }, // 156
+    {  164,   46,  -11,  -23,   58 }, // 157
+    {  165,   47,  -11,  -24,   60 }, // 158
+    {  166,   49,  -12,  -25,   62 }, // 159
+    {  167,   51,  -12,  -26,   64 }, // 160
+    {  168,   52,  -12,  -26,   66 }, // 161
+    {  169,   54,  -13,  -27,   68 }, // 162
+    {  171,   55,  -13,  -28,   70 }, // 163
+    {  172,   57,  -14,  -29,   72 }, // 164
+    {  173,   59,  -14,  -30,   74 }, // 165
+    {  174,   60,  -14,  -30,   76 }, // 166
+    {  175,   62,  -15,  -31,   78 }, // 167
+    {  176,   63,  -15,  -32,   80 }, // 168
+    {  178,   65,  -16,  -33,   82 }, // 169
+    {  179,   67,  -16,  -34,   84 }, // 170
+    {  180,   68,  -16,  -34,   86 }, // 171
+    {  181,   70,  -17,  -35,   88 }, // 172
+    {  182,   71,  -17,  -36,   90 }, // 173
+    {  183,   73,  -17,  -37,   92 }, // 174
+    {  185,   75,  -18,  -38,   94 }, // 175
+    {  186,   76,  -18,  -39,   96 }, // 176
+    {  187,   78,  -19,  -39,   98 }, // 177
+    {  188,   79,  -19,  -40,  100 }, // 178
+    {  189,   81,  -19,  -41,  102 }, // 179
+    {  190,   82,  -20,  -42,  104 }, // 180
+    {  192,   84,  -20,  -43,  106 }, // 181
+    {  193,   86,  -21,  -43,  108 }, // 182
+    {  194,   87,  -21,  -44,  110 }, // 183
+    {  195,   89,  -21,  -45,  113 }, // 184
+    {  196,   90,  -22,  -46,  115 }, // 185
+    {  197,   92,  -22,  -47,  117 }, // 186
+    {  199,   94,  -23,  -47,  119 }, // 187
+    {  200,   95,  -23,  -48,  121 }, // 188
+    {  201,   97,  -23,  -49,  123 }, // 189
+    {  202,   98,  -24,  -50,  125 }, // 190
+    {  203,  100,  -24,  -51,  127 }, // 191
+    {  204,  102,  -25,  -52,  129 }, // 192
+    {  206,  103,  -25,  -52,  131 }, // 193
+    {  207,  105,  -25,  -53,  133 }, // 194
+    {  208,  106,  -26,  -54,  135 }, // 195
+    {  209,  108,  -26,  -55,  137 }, // 196
+    {  210,  110,  -26,  -56,  139 }, // 197
+    {  211,  111,  -27,  -56,  141 }, // 198
+    {  213,  113,  -27,  -57,  143 }, // 199
+    {  214,  114,  -28,  -58,  145 }, // 200
+    {  215,  116,  -28,  -59,  147 }, // 201
+    {  216,  118,  -28,  -60,  149 }, // 202
+    {  217,  119,  -29,  -60,  151 }, // 203
+    {  218,  121,  -29,  -61,  153 }, // 204
+    {  219,  122,  -30,  -62,  155 }, // 205
+    {  221,  124,  -30,  -63,  157 }, // 206
+    {  222,  126,  -30,  -64,  159 }, // 207
+    {  223,  127,  -31,  -65,  161 }, // 208
+    {  224,  129,  -31,  -65,  163 }, // 209
+    {  225,  130,  -32,  -66,  165 }, // 210
+    {  226,  132,  -32,  -67,  167 }, // 211
+    {  228,  134,  -32,  -68,  169 }, // 212
+    {  229,  135,  -33,  -69,  171 }, // 213
+    {  230,  137,  -33,  -69,  173 }, // 214
+    {  231,  138,  -34,  -70,  175 }, // 215
+    {  232,  140,  -34,  -71,  177 }, // 216
+    {  233,  142,  -34,  -72,  179 }, // 217
+    {  235,  143,  -35,  -73,  181 }, // 218
+    {  236,  145,  -35,  -73,  183 }, // 219
+    {  237,  146,  -35,  -74,  185 }, // 220
+    {  238,  148,  -36,  -75,  187 }, // 221
+    {  239,  150,  -36,  -76,  189 }, // 222
+    {  240,  151,  -37,  -77,  191 }, // 223
+    {  242,  153,  -37,  -78,  193 }, // 224
+    {  243,  154,  -37,  -78,  195 }, // 225
+    {  244,  156,  -38,  -79,  197 }, // 226
+    {  245,  158,  -38,  -80,  199 }, // 227
+    {  246,  159,  -39,  -81,  201 }, // 228
+    {  247,  161,  -39,  -82,  203 }, // 229
+    {  249,  162,  -39,  -82,  205 }, // 230
+    {  250,  164,  -40,  -83,  207 }, // 231
+    {  251,  165,  -40,  -84,  209 }, // 232
+    {  252,  167,  -41,  -85,  211 }, // 233
+    {  253,  169,  -41,  -86,  213 }, // 234
+    {  254,  170,  -41,  -86,  215 }, // 235
+    {  256,  172,  -42,  -87,  217 }, // 236
+    {  257,  173,  -42,  -88,  219 }, // 237
+    {  258,  175,  -43,  -89,  221 }, // 238
+    {  259,  177,  -43,  -90,  223 }, // 239
+    {  260,  178,  -43,  -91,  226 }, // 240
+    {  261,  180,  -44,  -91,  228 }, // 241
+    {  263,  181,  -44,  -92,  230 }, // 242
+    {  264,  183,  -44,  -93,  232 }, // 243
+    {  265,  185,  -45,  -94,  234 }, // 244
+    {  266,  186,  -45,  -95,  236 }, // 245
+    {  267,  188,  -46,  -95,  238 }, // 246
+    {  268,  189,  -46,  -96,  240 }, // 247
+    {  270,  191,  -46,  -97,  242 }, // 248
+    {  271,  193,  -47,  -98,  244 }, // 249
+    {  272,  194,  -47,  -99,  246 }, // 250
+    {  273,  196,  -48,  -99,  248 }, // 251
+    {  274,  197,  -48, -100,  250 }, // 252
+    {  275,  199,  -48, -101,  252 }, // 253
+    {  277,  201,  -49, -102,  254 }, // 254
+    {  278,  202,  -49, -103,  256 }  // 255
+};
+
+typedef void (* pixconv_fn)(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+typedef struct {
+    const char * name;
+    pixconv_fn rgb565_to_rgb888;
+    pixconv_fn rgb565_to_bgr888;
+    pixconv_fn rgb565_to_gray;
+    pixconv_fn rgb888_to_rgb565le;
+    pixconv_fn rgb888_to_gray;
+    pixconv_fn bgr888_to_gray;
+    pixconv_fn gray_to_rgb888;
+    pixconv_fn swap_rb;
+    pixconv_fn yuyv_to_rgb888;
+    pixconv_fn yuyv_to_bgr888;
+    pixconv_fn yuyv_to_gray;
+} pixconv_ops_t;
+
+static inline uint8_t _clamp8(int v)
+{
+    return (v < 0) ? 0 : ((v > 255) ? 255 : v);
+}
+
+static inline uint8_t _gray(uint32_t r, uint32_t g, uint32_t b)
+{
+    return (r * GRAY_R + g * GRAY_G + b * GRAY_B + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+}
+
+/*
+ * Scalar reference: the byte loops the converters used to carry inline
+ */
+
+static void _scalar_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint8_t hb, lb;
+    while(pixels--) {
+        hb = *src++;
+        lb = *src++;
+        *dst++ = hb & 0xF8;
+        *dst++ = (hb & 0x07) << 5 | (lb & 0xE0) >> 3;
+        *dst++ = (lb & 0x1F) << 3;
+    }
+}
+
+static void _scalar_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint8_t hb, lb;
+    while(pixels--) {
+        hb = *src++;
+        lb = *src++;
+        *dst++ = (lb & 0x1F) << 3;
+        *dst++ = (hb & 0x07) << 5 | (lb & 0xE0) >> 3;
+        *dst++ = hb & 0xF8;
+    }
+}
+
+static void _scalar_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint8_t hb, lb;
+    while(pixels--) {
+        hb = *src++;
+        lb = *src++;
+        *dst++ = _gray(hb & 0xF8, (hb & 0x07) << 5 | (lb & 0xE0) >> 3, (lb & 0x1F) << 3);
+    }
+}
+
+static void _scalar_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint16_t c;
+    while(pixels--) {
+        c = ((src[0] & 0xF8) << 8) | ((src[1] & 0xFC) << 3) | (src[2] >> 3);
+        *dst++ = c & 0xFF;
+        *dst++ = c >> 8;
+        src += 3;
+    }
+}
+
+static void _scalar_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    while(pixels--) {
+        *dst++ = _gray(src[0], src[1], src[2]);
+        src += 3;
+    }
+}
+
+static void _scalar_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    while(pixels--) {
+        *dst++ = _gray(src[2], src[1], src[0]);
+        src += 3;
+    }
+}
+
+static void _scalar_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint8_t g;
+    while(pixels--) {
+        g = *src++;
+        *dst++ = g;
+        *dst++ = g;
+        *dst++ = g;
+    }
+}
+
+static void _scalar_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint8_t r;
+    while(pixels--) {
+        r = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = r;
+        src += 3;
+        dst += 3;
+    }
+}
+
+// both pixels of a YUYV pair share the chroma terms
+static inline void _yuyv_pair(const uint8_t *src, uint8_t *dst, int r, int b)
+{
+    int vr = yuv_table[src[3]].vVr;
+    int guv = yuv_table[src[1]].vUg + yuv_table[src[3]].vVg;
+    int ub = yuv_table[src[1]].vUb;
+    int y0 = yuv_table[src[0]].vY;
+    int y1 = yuv_table[src[2]].vY;
+
+    dst[r] = _clamp8(y0 + vr);
+    dst[1] = _clamp8(y0 + guv);
+    dst[b] = _clamp8(y0 + ub);
+    dst[r + 3] = _clamp8(y1 + vr);
+    dst[4] = _clamp8(y1 + guv);
+    dst[b + 3] = _clamp8(y1 + ub);
+}
+
+static void _scalar_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for(pixels /= 2; pixels; pixels--, src += 4, dst += 6) {
+        _yuyv_pair(src, dst, 0, 2);
+    }
+}
+
+static void _scalar_yuyv_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for(pixels /= 2; pixels; pixels--, src += 4, dst += 6) {
+        _yuyv_pair(src, dst, 2, 0);
+    }
+}
+
+static void _scalar_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    while(pixels--) {
+        *dst++ = *src;
+        src += 2;
+    }
+}
+
+static const pixconv_ops_t _scalar_ops = {
+    "scalar",
+    _scalar_rgb565_to_rgb888,
+    _scalar_rgb565_to_bgr888,
+    _scalar_rgb565_to_gray,
+    _scalar_rgb888_to_rgb565le,
+    _scalar_rgb888_to_gray,
+    _scalar_bgr888_to_gray,
+    _scalar_gray_to_rgb888,
+    _scalar_swap_rb,
+    _scalar_yuyv_to_rgb888,
+    _scalar_yuyv_to_bgr888,
+    _scalar_yuyv_to_gray,
+};
+
+/*
+ * SWAR: whole 32-bit words are loaded and stored, four pixels per iteration
+ * (three words of 24-bit pixels, two of 16-bit pixels, one of 8-bit pixels).
+ * Xtensa faults on unaligned word access, so unaligned buffers take the scalar
+ * path, and so do the last (pixels % 4) pixels.
+ */
+
+typedef uint32_t __attribute__((__may_alias__)) pixconv_word_t;
+
+#define _WORD_ALIGNED(s, d) (((((uintptr_t)(s)) | ((uintptr_t)(d))) & 3) == 0)
+
+// one RGB565 pixel, as the low 16 bits of a word (lb << 8 | hb), to 24 bits R, G, B
+static inline uint32_t _565_to_rgb(uint32_t x)
+{
+    return (x & 0xF8) | ((x << 13) & 0xE000) | ((x >> 3) & 0x1C00) | ((x & 0x1F00) << 11);
+}
+
+// same, B, G, R
+static inline uint32_t _565_to_bgr(uint32_t x)
+{
+    return ((x & 0x1F00) >> 5) | ((x << 13) & 0xE000) | ((x >> 3) & 0x1C00) | ((x & 0xF8) << 16);
+}
+
+static inline uint32_t _rgb_to_565le(uint32_t p)
+{
+    return ((p & 0xF8) << 8) | ((p >> 5) & 0x7E0) | ((p >> 19) & 0x1F);
+}
+
+// three words of packed 24-bit pixels <-> four pixels
+#define _UNPACK24(s, p) do { \
+    uint32_t _w0 = (s)[0], _w1 = (s)[1], _w2 = (s)[2]; \
+    (p)[0] = _w0 & 0xFFFFFF; \
+    (p)[1] = (_w0 >> 24) | ((_w1 << 8) & 0xFFFFFF); \
+    (p)[2] = (_w1 >> 16) | ((_w2 << 16) & 0xFFFFFF); \
+    (p)[3] = _w2 >> 8; \
+} while(0)
+
+#define _PACK24(p, d) do { \
+    (d)[0] = (p)[0] | ((p)[1] << 24); \
+    (d)[1] = ((p)[1] >> 8) | ((p)[2] << 16); \
+    (d)[2] = ((p)[2] >> 16) | ((p)[3] << 8); \
+} while(0)
+
+static void _swar_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=2, d+=3) {
+        p[0] = _565_to_rgb(s[0]);
+        p[1] = _565_to_rgb(s[0] >> 16);
+        p[2] = _565_to_rgb(s[1]);
+        p[3] = _565_to_rgb(s[1] >> 16);
+        _PACK24(p, d);
+    }
+    _scalar_rgb565_to_rgb888(src + n * 8, dst + n * 12, pixels - n * 4);
+}
+
+static void _swar_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=2, d+=3) {
+        p[0] = _565_to_bgr(s[0]);
+        p[1] = _565_to_bgr(s[0] >> 16);
+        p[2] = _565_to_bgr(s[1]);
+        p[3] = _565_to_bgr(s[1] >> 16);
+        _PACK24(p, d);
+    }
+    _scalar_rgb565_to_bgr888(src + n * 8, dst + n * 12, pixels - n * 4);
+}
+
+static inline uint32_t _gray24(uint32_t p)
+{
+    return _gray(p & 0xFF, (p >> 8) & 0xFF, p >> 16);
+}
+
+static void _swar_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    for(i=0; i<n; i++, s+=2) {
+        *d++ = _gray24(_565_to_rgb(s[0]))
+            | (_gray24(_565_to_rgb(s[0] >> 16)) << 8)
+            | (_gray24(_565_to_rgb(s[1])) << 16)
+            | (_gray24(_565_to_rgb(s[1] >> 16)) << 24);
+    }
+    _scalar_rgb565_to_gray(src + n * 8, dst + n * 4, pixels - n * 4);
+}
+
+static void _swar_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=3, d+=2) {
+        _UNPACK24(s, p);
+        d[0] = _rgb_to_565le(p[0]) | (_rgb_to_565le(p[1]) << 16);
+        d[1] = _rgb_to_565le(p[2]) | (_rgb_to_565le(p[3]) << 16);
+    }
+    _scalar_rgb888_to_rgb565le(src + n * 12, dst + n * 8, pixels - n * 4);
+}
+
+static void _swar_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=3) {
+        _UNPACK24(s, p);
+        *d++ = _gray24(p[0]) | (_gray24(p[1]) << 8) | (_gray24(p[2]) << 16) | (_gray24(p[3]) << 24);
+    }
+    _scalar_rgb888_to_gray(src + n * 12, dst + n * 4, pixels - n * 4);
+}
+
+static inline uint32_t _gray24_bgr(uint32_t p)
+{
+    return _gray(p >> 16, (p >> 8) & 0xFF, p & 0xFF);
+}
+
+static void _swar_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=3) {
+        _UNPACK24(s, p);
+        *d++ = _gray24_bgr(p[0]) | (_gray24_bgr(p[1]) << 8) | (_gray24_bgr(p[2]) << 16) | (_gray24_bgr(p[3]) << 24);
+    }
+    _scalar_bgr888_to_gray(src + n * 12, dst + n * 4, pixels - n * 4);
+}
+
+static void _swar_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t g0, g1, g2, g3;
+    for(i=0; i<n; i++, d+=3) {
+        g0 = *s & 0xFF;
+        g1 = (*s >> 8) & 0xFF;
+        g2 = (*s >> 16) & 0xFF;
+        g3 = *s++ >> 24;
+        d[0] = (g0 * 0x010101) | (g1 << 24);
+        d[1] = (g1 * 0x0101) | (g2 * 0x01010000);
+        d[2] = g2 | (g3 * 0x01010100);
+    }
+    _scalar_gray_to_rgb888(src + n * 4, dst + n * 12, pixels - n * 4);
+}
+
+static void _swar_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t w0, w1, w2;
+    for(i=0; i<n; i++, s+=3, d+=3) {
+        // R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3
+        w0 = s[0];
+        w1 = s[1];
+        w2 = s[2];
+        // B0 G0 R0 B1 | G1 R1 B2 G2 | R2 B3 G3 R3
+        d[0] = ((w0 >> 16) & 0xFF) | (w0 & 0xFF00) | ((w0 & 0xFF) << 16) | ((w1 & 0xFF00) << 16);
+        d[1] = (w1 & 0xFF) | ((w0 >> 16) & 0xFF00) | ((w2 & 0xFF) << 16) | (w1 & 0xFF000000);
+        d[2] = ((w1 >> 16) & 0xFF) | ((w2 >> 16) & 0xFF00) | (w2 & 0xFF0000) | ((w2 & 0xFF00) << 16);
+    }
+    _scalar_swap_rb(src + n * 12, dst + n * 12, pixels - n * 4);
+}
+
+// one YUYV pair (a word) to two 24-bit pixels, R at byte r and B at byte b
+static inline void _yuyv_word(uint32_t w, uint32_t *p, int r, int b)
+{
+    int vr = yuv_table[w >> 24].vVr;
+    int guv = yuv_table[(w >> 8) & 0xFF].vUg + yuv_table[w >> 24].vVg;
+    int ub = yuv_table[(w >> 8) & 0xFF].vUb;
+    int y0 = yuv_table[w & 0xFF].vY;
+    int y1 = yuv_table[(w >> 16) & 0xFF].vY;
+
+    p[0] = (_clamp8(y0 + vr) << (r * 8)) | (_clamp8(y0 + guv) << 8) | (_clamp8(y0 + ub) << (b * 8));
+    p[1] = (_clamp8(y1 + vr) << (r * 8)) | (_clamp8(y1 + guv) << 8) | (_clamp8(y1 + ub) << (b * 8));
+}
+
+static void _swar_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=2, d+=3) {
+        _yuyv_word(s[0], p, 0, 2);
+        _yuyv_word(s[1], p + 2, 0, 2);
+        _PACK24(p, d);
+    }
+    _scalar_yuyv_to_rgb888(src + n * 8, dst + n * 12, pixels - n * 4);
+}
+
+static void _swar_yuyv_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    uint32_t p[4];
+    for(i=0; i<n; i++, s+=2, d+=3) {
+        _yuyv_word(s[0], p, 2, 0);
+        _yuyv_word(s[1], p + 2, 2, 0);
+        _PACK24(p, d);
+    }
+    _scalar_yuyv_to_bgr888(src + n * 8, dst + n * 12, pixels - n * 4);
+}
+
+static void _swar_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = _WORD_ALIGNED(src, dst) ? pixels / 4 : 0;
+    const pixconv_word_t *s = (const pixconv_word_t *)src;
+    pixconv_word_t *d = (pixconv_word_t *)dst;
+    for(i=0; i<n; i++, s+=2) {
+        // Y0 U Y1 V | Y2 U Y3 V
+        *d++ = (s[0] & 0xFF) | ((s[0] >> 8) & 0xFF00) | ((s[1] & 0xFF) << 16) | ((s[1] << 8) & 0xFF000000);
+    }
+    _scalar_yuyv_to_gray(src + n * 8, dst + n * 4, pixels - n * 4);
+}
+
+static const pixconv_ops_t _swar_ops = {
+    "swar",
+    _swar_rgb565_to_rgb888,
+    _swar_rgb565_to_bgr888,
+    _swar_rgb565_to_gray,
+    _swar_rgb888_to_rgb565le,
+    _swar_rgb888_to_gray,
+    _swar_bgr888_to_gray,
+    _swar_gray_to_rgb888,
+    _swar_swap_rb,
+    _swar_yuyv_to_rgb888,
+    _swar_yuyv_to_bgr888,
+    _swar_yuyv_to_gray,
+};
+
+#ifdef PIXCONV_HAS_SSSE3
+/*
+ * SSSE3: 16 pixels per iteration. Packed 24-bit pixels span three vectors, so
+ * every reordering of those 48 bytes (swap, packed <-> planar) is three pshufb
+ * per output vector, with the masks built once from the byte mapping.
+ * YUYV -> RGB is table driven and stays on the SWAR kernels.
+ */
+
+typedef enum {
+    PERM48_SWAP_RB,     // packed -> packed with R and B swapped
+    PERM48_TO_PACKED,   // three 16-byte planes -> packed
+    PERM48_TO_PLANAR,   // packed -> three 16-byte planes
+} perm48_t;
+
+static __m128i _perm48_masks[3][3][3];
+static volatile bool _perm48_ready = false;
+
+static int _perm48_source(perm48_t perm, int j)
+{
+    switch(perm) {
+    case PERM48_SWAP_RB:
+        return 3 * (j / 3) + 2 - j % 3;
+    case PERM48_TO_PACKED:
+        return (j % 3) * 16 + j / 3;
+    default:
+        return 3 * (j % 16) + j / 16;
+    }
+}
+
+static void _perm48_init(void)
+{
+    uint8_t bytes[16];
+    int perm, out, in, i, s;
+    if(_perm48_ready) {
+        return;
+    }
+    for(perm=0; perm<3; perm++) {
+        for(out=0; out<3; out++) {
+            for(in=0; in<3; in++) {
+                for(i=0; i<16; i++) {
+                    s = _perm48_source((perm48_t)perm, out * 16 + i);
+                    bytes[i] = (s / 16 == in) ? (s % 16) : 0x80;
+                }
+                memcpy(&_perm48_masks[perm][out][in], bytes, 16);
+            }
+        }
+    }
+    _perm48_ready = true;
+}
+
+SSSE3_FN static inline void _perm48(perm48_t perm, __m128i a, __m128i b, __m128i c, __m128i *o)
+{
+    const __m128i (*m)[3] = _perm48_masks[perm];
+    int k;
+    for(k=0; k<3; k++) {
+        o[k] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m[k][0]), _mm_shuffle_epi8(b, m[k][1])), _mm_shuffle_epi8(c, m[k][2]));
+    }
+}
+
+SSSE3_FN static inline void _ssse3_store48(uint8_t *dst, const __m128i *o)
+{
+    _mm_storeu_si128((__m128i *)dst, o[0]);
+    _mm_storeu_si128((__m128i *)(dst + 16), o[1]);
+    _mm_storeu_si128((__m128i *)(dst + 32), o[2]);
+}
+
+SSSE3_FN static inline void _ssse3_planes(const uint8_t *src, __m128i *o)
+{
+    _perm48(PERM48_TO_PLANAR, _mm_loadu_si128((const __m128i *)src), _mm_loadu_si128((const __m128i *)(src + 16)),
+            _mm_loadu_si128((const __m128i *)(src + 32)), o);
+}
+
+// 16 RGB565 pixels to R, G, B planes
+SSSE3_FN static inline void _ssse3_565_planes(const uint8_t *src, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i f8 = _mm_set1_epi16(0xF8), e0 = _mm_set1_epi16(0xE0), c1 = _mm_set1_epi16(0x1C);
+    __m128i x0 = _mm_loadu_si128((const __m128i *)src);
+    __m128i x1 = _mm_loadu_si128((const __m128i *)(src + 16));
+    *r = _mm_packus_epi16(_mm_and_si128(x0, f8), _mm_and_si128(x1, f8));
+    *g = _mm_packus_epi16(
+            _mm_or_si128(_mm_and_si128(_mm_slli_epi16(x0, 5), e0), _mm_and_si128(_mm_srli_epi16(x0, 11), c1)),
+            _mm_or_si128(_mm_and_si128(_mm_slli_epi16(x1, 5), e0), _mm_and_si128(_mm_srli_epi16(x1, 11), c1)));
+    *b = _mm_packus_epi16(_mm_and_si128(_mm_srli_epi16(x0, 5), f8), _mm_and_si128(_mm_srli_epi16(x1, 5), f8));
+}
+
+// luma of four pixels, r g b in the low 16 bits of each 32-bit lane pair
+SSSE3_FN static inline __m128i _ssse3_gray4(__m128i rg, __m128i b1)
+{
+    const __m128i crg = _mm_set1_epi32((GRAY_G << 16) | GRAY_R);
+    const __m128i cb = _mm_set1_epi32(((1 << (GRAY_SHIFT - 1)) << 16) | GRAY_B);
+    return _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(rg, crg), _mm_madd_epi16(b1, cb)), GRAY_SHIFT);
+}
+
+SSSE3_FN static inline __m128i _ssse3_gray8(__m128i r, __m128i g, __m128i b)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    return _mm_packs_epi32(_ssse3_gray4(_mm_unpacklo_epi16(r, g), _mm_unpacklo_epi16(b, one)),
+                           _ssse3_gray4(_mm_unpackhi_epi16(r, g), _mm_unpackhi_epi16(b, one)));
+}
+
+SSSE3_FN static inline __m128i _ssse3_gray16(__m128i r, __m128i g, __m128i b)
+{
+    const __m128i z = _mm_setzero_si128();
+    return _mm_packus_epi16(
+            _ssse3_gray8(_mm_unpacklo_epi8(r, z), _mm_unpacklo_epi8(g, z), _mm_unpacklo_epi8(b, z)),
+            _ssse3_gray8(_mm_unpackhi_epi8(r, z), _mm_unpackhi_epi8(g, z), _mm_unpackhi_epi8(b, z)));
+}
+
+SSSE3_FN static void _ssse3_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i r, g, b, o[3];
+    for(i=0; i<n; i++, src+=32, dst+=48) {
+        _ssse3_565_planes(src, &r, &g, &b);
+        _perm48(PERM48_TO_PACKED, r, g, b, o);
+        _ssse3_store48(dst, o);
+    }
+    _swar_rgb565_to_rgb888(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i r, g, b, o[3];
+    for(i=0; i<n; i++, src+=32, dst+=48) {
+        _ssse3_565_planes(src, &r, &g, &b);
+        _perm48(PERM48_TO_PACKED, b, g, r, o);
+        _ssse3_store48(dst, o);
+    }
+    _swar_rgb565_to_bgr888(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i r, g, b;
+    for(i=0; i<n; i++, src+=32, dst+=16) {
+        _ssse3_565_planes(src, &r, &g, &b);
+        _mm_storeu_si128((__m128i *)dst, _ssse3_gray16(r, g, b));
+    }
+    _swar_rgb565_to_gray(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static inline __m128i _ssse3_565le8(__m128i r, __m128i g, __m128i b)
+{
+    return _mm_or_si128(_mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(r, _mm_set1_epi16(0xF8)), 8),
+            _mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0xFC)), 3)),
+            _mm_srli_epi16(b, 3));
+}
+
+SSSE3_FN static void _ssse3_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m128i z = _mm_setzero_si128();
+    size_t i, n = pixels / 16;
+    __m128i p[3];
+    for(i=0; i<n; i++, src+=48, dst+=32) {
+        _ssse3_planes(src, p);
+        _mm_storeu_si128((__m128i *)dst,
+                _ssse3_565le8(_mm_unpacklo_epi8(p[0], z), _mm_unpacklo_epi8(p[1], z), _mm_unpacklo_epi8(p[2], z)));
+        _mm_storeu_si128((__m128i *)(dst + 16),
+                _ssse3_565le8(_mm_unpackhi_epi8(p[0], z), _mm_unpackhi_epi8(p[1], z), _mm_unpackhi_epi8(p[2], z)));
+    }
+    _swar_rgb888_to_rgb565le(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i p[3];
+    for(i=0; i<n; i++, src+=48, dst+=16) {
+        _ssse3_planes(src, p);
+        _mm_storeu_si128((__m128i *)dst, _ssse3_gray16(p[0], p[1], p[2]));
+    }
+    _swar_rgb888_to_gray(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i p[3];
+    for(i=0; i<n; i++, src+=48, dst+=16) {
+        _ssse3_planes(src, p);
+        _mm_storeu_si128((__m128i *)dst, _ssse3_gray16(p[2], p[1], p[0]));
+    }
+    _swar_bgr888_to_gray(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i g, o[3];
+    for(i=0; i<n; i++, src+=16, dst+=48) {
+        g = _mm_loadu_si128((const __m128i *)src);
+        _perm48(PERM48_TO_PACKED, g, g, g, o);
+        _ssse3_store48(dst, o);
+    }
+    _swar_gray_to_rgb888(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    __m128i o[3];
+    for(i=0; i<n; i++, src+=48, dst+=48) {
+        _perm48(PERM48_SWAP_RB, _mm_loadu_si128((const __m128i *)src), _mm_loadu_si128((const __m128i *)(src + 16)),
+                _mm_loadu_si128((const __m128i *)(src + 32)), o);
+        _ssse3_store48(dst, o);
+    }
+    _swar_swap_rb(src, dst, pixels - n * 16);
+}
+
+SSSE3_FN static void _ssse3_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m128i y = _mm_set1_epi16(0xFF);
+    size_t i, n = pixels / 16;
+    for(i=0; i<n; i++, src+=32, dst+=16) {
+        _mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(
+                _mm_and_si128(_mm_loadu_si128((const __m128i *)src), y),
+                _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 16)), y)));
+    }
+    _swar_yuyv_to_gray(src, dst, pixels - n * 16);
+}
+
+static const pixconv_ops_t _ssse3_ops = {
+    "ssse3",
+    _ssse3_rgb565_to_rgb888,
+    _ssse3_rgb565_to_bgr888,
+    _ssse3_rgb565_to_gray,
+    _ssse3_rgb888_to_rgb565le,
+    _ssse3_rgb888_to_gray,
+    _ssse3_bgr888_to_gray,
+    _ssse3_gray_to_rgb888,
+    _ssse3_swap_rb,
+    _swar_yuyv_to_rgb888,
+    _swar_yuyv_to_bgr888,
+    _ssse3_yuyv_to_gray,
+};
+
+static bool _ssse3_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+#endif /* PIXCONV_HAS_SSSE3 */
+
+#ifdef PIXCONV_HAS_NEON
+/*
+ * NEON: 16 pixels per iteration, the interleaving is done by vld2/vld3/vst3.
+ * YUYV -> RGB is table driven and stays on the SWAR kernels.
+ */
+
+static inline void _neon_565_planes(const uint8_t *src, uint8x16_t *r, uint8x16_t *g, uint8x16_t *b)
+{
+    uint8x16x2_t x = vld2q_u8(src); // val[0] = high bytes, val[1] = low bytes
+    *r = vandq_u8(x.val[0], vdupq_n_u8(0xF8));
+    *g = vorrq_u8(vshlq_n_u8(x.val[0], 5), vandq_u8(vshrq_n_u8(x.val[1], 3), vdupq_n_u8(0x1C)));
+    *b = vshlq_n_u8(x.val[1], 3);
+}
+
+static inline uint8x8_t _neon_gray8(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+    uint16x8_t r16 = vmovl_u8(r), g16 = vmovl_u8(g), b16 = vmovl_u8(b);
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(r16), GRAY_R);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(r16), GRAY_R);
+    lo = vmlal_n_u16(lo, vget_low_u16(g16), GRAY_G);
+    hi = vmlal_n_u16(hi, vget_high_u16(g16), GRAY_G);
+    lo = vmlal_n_u16(lo, vget_low_u16(b16), GRAY_B);
+    hi = vmlal_n_u16(hi, vget_high_u16(b16), GRAY_B);
+    return vmovn_u16(vcombine_u16(vrshrn_n_u32(lo, GRAY_SHIFT), vrshrn_n_u32(hi, GRAY_SHIFT)));
+}
+
+static inline uint8x16_t _neon_gray16(uint8x16_t r, uint8x16_t g, uint8x16_t b)
+{
+    return vcombine_u8(_neon_gray8(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b)),
+                       _neon_gray8(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b)));
+}
+
+static void _neon_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t o;
+    for(i=0; i<n; i++, src+=32, dst+=48) {
+        _neon_565_planes(src, &o.val[0], &o.val[1], &o.val[2]);
+        vst3q_u8(dst, o);
+    }
+    _swar_rgb565_to_rgb888(src, dst, pixels - n * 16);
+}
+
+static void _neon_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t o;
+    for(i=0; i<n; i++, src+=32, dst+=48) {
+        _neon_565_planes(src, &o.val[2], &o.val[1], &o.val[0]);
+        vst3q_u8(dst, o);
+    }
+    _swar_rgb565_to_bgr888(src, dst, pixels - n * 16);
+}
+
+static void _neon_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16_t r, g, b;
+    for(i=0; i<n; i++, src+=32, dst+=16) {
+        _neon_565_planes(src, &r, &g, &b);
+        vst1q_u8(dst, _neon_gray16(r, g, b));
+    }
+    _swar_rgb565_to_gray(src, dst, pixels - n * 16);
+}
+
+static void _neon_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t p;
+    uint8x16x2_t o;
+    for(i=0; i<n; i++, src+=48, dst+=32) {
+        p = vld3q_u8(src);
+        o.val[0] = vorrq_u8(vandq_u8(vshlq_n_u8(p.val[1], 3), vdupq_n_u8(0xE0)), vshrq_n_u8(p.val[2], 3));
+        o.val[1] = vorrq_u8(vandq_u8(p.val[0], vdupq_n_u8(0xF8)), vshrq_n_u8(p.val[1], 5));
+        vst2q_u8(dst, o);
+    }
+    _swar_rgb888_to_rgb565le(src, dst, pixels - n * 16);
+}
+
+static void _neon_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t p;
+    for(i=0; i<n; i++, src+=48, dst+=16) {
+        p = vld3q_u8(src);
+        vst1q_u8(dst, _neon_gray16(p.val[0], p.val[1], p.val[2]));
+    }
+    _swar_rgb888_to_gray(src, dst, pixels - n * 16);
+}
+
+static void _neon_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t p;
+    for(i=0; i<n; i++, src+=48, dst+=16) {
+        p = vld3q_u8(src);
+        vst1q_u8(dst, _neon_gray16(p.val[2], p.val[1], p.val[0]));
+    }
+    _swar_bgr888_to_gray(src, dst, pixels - n * 16);
+}
+
+static void _neon_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t o;
+    for(i=0; i<n; i++, src+=16, dst+=48) {
+        o.val[0] = o.val[1] = o.val[2] = vld1q_u8(src);
+        vst3q_u8(dst, o);
+    }
+    _swar_gray_to_rgb888(src, dst, pixels - n * 16);
+}
+
+static void _neon_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    uint8x16x3_t p;
+    uint8x16_t t;
+    for(i=0; i<n; i++, src+=48, dst+=48) {
+        p = vld3q_u8(src);
+        t = p.val[0];
+        p.val[0] = p.val[2];
+        p.val[2] = t;
+        vst3q_u8(dst, p);
+    }
+    _swar_swap_rb(src, dst, pixels - n * 16);
+}
+
+static void _neon_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i, n = pixels / 16;
+    for(i=0; i<n; i++, src+=32, dst+=16) {
+        vst1q_u8(dst, vld2q_u8(src).val[0]);
+    }
+    _swar_yuyv_to_gray(src, dst, pixels - n * 16);
+}
+
+static const pixconv_ops_t _neon_ops = {
+    "neon",
+    _neon_rgb565_to_rgb888,
+    _neon_rgb565_to_bgr888,
+    _neon_rgb565_to_gray,
+    _neon_rgb888_to_rgb565le,
+    _neon_rgb888_to_gray,
+    _neon_bgr888_to_gray,
+    _neon_gray_to_rgb888,
+    _neon_swap_rb,
+    _swar_yuyv_to_rgb888,
+    _swar_yuyv_to_bgr888,
+    _neon_yuyv_to_gray,
+};
+#endif /* PIXCONV_HAS_NEON */
+
+/*
+ * Dispatch
+ */
+
+static const pixconv_ops_t * _ops = NULL;
+
+bool pixconv_select(pixconv_impl_t impl)
+{
+    const pixconv_ops_t * ops = NULL;
+    switch(impl) {
+    case PIXCONV_AUTO:
+#if defined(PIXCONV_HAS_NEON)
+        ops = &_neon_ops;
+#else
+#if defined(PIXCONV_HAS_SSSE3)
+        if(_ssse3_supported()) {
+            _perm48_init();
+            ops = &_ssse3_ops;
+            break;
+        }
+#endif
+        ops = &_swar_ops;
+#endif
+        break;
+    case PIXCONV_SCALAR:
+        ops = &_scalar_ops;
+        break;
+    case PIXCONV_SWAR:
+        ops = &_swar_ops;
+        break;
+    case PIXCONV_SSSE3:
+#if defined(PIXCONV_HAS_SSSE3)
+        if(_ssse3_supported()) {
+            _perm48_init();
+            ops = &_ssse3_ops;
+        }
+#endif
+        break;
+    case PIXCONV_NEON:
+#if defined(PIXCONV_HAS_NEON)
+        ops = &_neon_ops;
+#endif
+        break;
+    }
+    if(!ops) {
+        return false;
+    }
+    // the SSSE3 masks are complete before the table that uses them is published
+    __atomic_store_n(&_ops, ops, __ATOMIC_RELEASE);
+    return true;
+}
+
+static inline const pixconv_ops_t * _get_ops(void)
+{
+    const pixconv_ops_t * ops = __atomic_load_n(&_ops, __ATOMIC_ACQUIRE);
+    if(!ops) {
+        pixconv_select(PIXCONV_AUTO);
+        ops = __atomic_load_n(&_ops, __ATOMIC_ACQUIRE);
+    }
+    return ops;
+}
+
+const char * pixconv_name(void)
+{
+    return _get_ops()->name;
+}
+
+void pixconv_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->rgb565_to_rgb888(src, dst, pixels);
+}
+
+void pixconv_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->rgb565_to_bgr888(src, dst, pixels);
+}
+
+void pixconv_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->rgb565_to_gray(src, dst, pixels);
+}
+
+void pixconv_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->rgb888_to_rgb565le(src, dst, pixels);
+}
+
+void pixconv_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->rgb888_to_gray(src, dst, pixels);
+}
+
+void pixconv_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->bgr888_to_gray(src, dst, pixels);
+}
+
+void pixconv_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->gray_to_rgb888(src, dst, pixels);
+}
+
+void pixconv_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->swap_rb(src, dst, pixels);
+}
+
+void pixconv_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->yuyv_to_rgb888(src, dst, pixels);
+}
+
+void pixconv_yuyv_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->yuyv_to_bgr888(src, dst, pixels);
+}
+
+void pixconv_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    _get_ops()->yuyv_to_gray(src, dst, pixels);
+}
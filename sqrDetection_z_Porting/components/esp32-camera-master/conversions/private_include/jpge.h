@@ -129,6 +129,7 @@ namespace jpge
 
             void code_coefficients_pass_two(int component_num);
             void code_block(int component_num);
+            void code_block_grey(int x);
 
             void process_mcu_row();
             bool process_end_of_image();
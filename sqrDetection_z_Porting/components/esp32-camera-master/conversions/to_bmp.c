@@ -16,7 +16,7 @@
 #include "img_converters.h"
 #include "soc/efuse_reg.h"
 #include "esp_heap_caps.h"
-#include "yuv.h"
+#include "pixel_convert.h"
 #include "sdkconfig.h"
 #include "esp_jpg_decode.h"
 
@@ -95,18 +95,12 @@ static bool _rgb_write(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16_t
     size_t l = x * 3;
     uint8_t *out = jpeg->output+jpeg->data_offset;
     uint8_t *o = out;
-    size_t iy, ix;
-
-    w = w * 3;
+    size_t iy;
 
     for(iy=t; iy<b; iy+=jw) {
         o = out+iy+l;
-        for(ix=0; ix<w; ix+= 3) {
-            o[ix] = data[ix+2];
-            o[ix+1] = data[ix+1];
-            o[ix+2] = data[ix];
-        }
-        data+=w;
+        pixconv_swap_rb(data, o, w);
+        data+=w*3;
     }
     return true;
 }
@@ -140,21 +134,12 @@ static bool _rgb565_write(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16
     size_t l = x * 2;
     uint8_t *out = jpeg->output+jpeg->data_offset;
     uint8_t *o = out;
-    size_t iy, iy2, ix, ix2;
-
-    w = w * 3;
+    size_t iy, iy2;
 
     for(iy=t, iy2=t2; iy<b; iy+=jw, iy2+=jw2) {
         o = out+iy2+l;
-        for(ix2=ix=0; ix<w; ix+= 3, ix2 +=2) {
-            uint16_t r = data[ix];
-            uint16_t g = data[ix+1];
-            uint16_t b = data[ix+2];
-            uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-            o[ix2+1] = c>>8;
-            o[ix2] = c&0xff;
-        }
-        data+=w;
+        pixconv_rgb888_to_rgb565le(data, o, w);
+        data+=w*3;
     }
     return true;
 }
@@ -247,47 +232,14 @@ bool fmt2rgb888(const uint8_t *src_buf, size_t src_len, pixformat_t format, uint
     } else if(format == PIXFORMAT_RGB888) {
         memcpy(rgb_buf, src_buf, src_len);
     } else if(format == PIXFORMAT_RGB565) {
-        int i;
-        uint8_t hb, lb;
         pix_count = src_len / 2;
-        for(i=0; i<pix_count; i++) {
-            hb = *src_buf++;
-            lb = *src_buf++;
-            *rgb_buf++ = (lb & 0x1F) << 3;
-            *rgb_buf++ = (hb & 0x07) << 5 | (lb & 0xE0) >> 3;
-            *rgb_buf++ = hb & 0xF8;
-        }
+        pixconv_rgb565_to_bgr888(src_buf, rgb_buf, pix_count);
     } else if(format == PIXFORMAT_GRAYSCALE) {
-        int i;
-        uint8_t b;
         pix_count = src_len;
-        for(i=0; i<pix_count; i++) {
-            b = *src_buf++;
-            *rgb_buf++ = b;
-            *rgb_buf++ = b;
-            *rgb_buf++ = b;
-        }
+        pixconv_gray_to_rgb888(src_buf, rgb_buf, pix_count);
     } else if(format == PIXFORMAT_YUV422) {
         pix_count = src_len / 2;
-        int i, maxi = pix_count / 2;
-        uint8_t y0, y1, u, v;
-        uint8_t r, g, b;
-        for(i=0; i<maxi; i++) {
-            y0 = *src_buf++;
-            u = *src_buf++;
-            y1 = *src_buf++;
-            v = *src_buf++;
-
-            yuv2rgb(y0, u, v, &r, &g, &b);
-            *rgb_buf++ = b;
-            *rgb_buf++ = g;
-            *rgb_buf++ = r;
-
-            yuv2rgb(y1, u, v, &r, &g, &b);
-            *rgb_buf++ = b;
-            *rgb_buf++ = g;
-            *rgb_buf++ = r;
-        }
+        pixconv_yuyv_to_bgr888(src_buf, rgb_buf, pix_count);
     }
     return true;
 }
@@ -354,37 +306,11 @@ bool fmt2bmp(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixf
     if(format == PIXFORMAT_RGB888) {
         memcpy(pix_buf, src_buf, pix_count*3);
     } else if(format == PIXFORMAT_RGB565) {
-        int i;
-        uint8_t hb, lb;
-        for(i=0; i<pix_count; i++) {
-            hb = *src_buf++;
-            lb = *src_buf++;
-            *pix_buf++ = (lb & 0x1F) << 3;
-            *pix_buf++ = (hb & 0x07) << 5 | (lb & 0xE0) >> 3;
-            *pix_buf++ = hb & 0xF8;
-        }
+        pixconv_rgb565_to_bgr888(src_buf, pix_buf, pix_count);
     } else if(format == PIXFORMAT_GRAYSCALE) {
         memcpy(pix_buf, src_buf, pix_count);
     } else if(format == PIXFORMAT_YUV422) {
-        int i, maxi = pix_count / 2;
-        uint8_t y0, y1, u, v;
-        uint8_t r, g, b;
-        for(i=0; i<maxi; i++) {
-            y0 = *src_buf++;
-            u = *src_buf++;
-            y1 = *src_buf++;
-            v = *src_buf++;
-
-            yuv2rgb(y0, u, v, &r, &g, &b);
-            *pix_buf++ = b;
-            *pix_buf++ = g;
-            *pix_buf++ = r;
-
-            yuv2rgb(y1, u, v, &r, &g, &b);
-            *pix_buf++ = b;
-            *pix_buf++ = g;
-            *pix_buf++ = r;
-        }
+        pixconv_yuyv_to_bgr888(src_buf, pix_buf, pix_count);
     }
     *out = out_buf;
     *out_len = out_size;
@@ -19,7 +19,9 @@
 #include "esp_camera.h"
 #include "img_converters.h"
 #include "jpge.h"
-#include "yuv.h"
+#include "pixel_convert.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -43,48 +45,35 @@ static void *_malloc(size_t size)
     return NULL;
 }
 
+// jpge keeps its quantization and Huffman tables in statics, rebuilt when the quality changes: the
+// encoders of different tasks (archive, flight recorder) take turns, from init to deinit
+class encoder_lock {
+public:
+    encoder_lock()
+    {
+        // thread-safe static initialization, the mutex is created by the first encoder
+        static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+        lock = mutex;
+        xSemaphoreTake(lock, portMAX_DELAY);
+    }
+    ~encoder_lock()
+    {
+        xSemaphoreGive(lock);
+    }
+private:
+    SemaphoreHandle_t lock;
+};
+
 static IRAM_ATTR void convert_line_format(uint8_t * src, pixformat_t format, uint8_t * dst, size_t width, size_t in_channels, size_t line)
 {
-    int i=0, o=0, l=0;
     if(format == PIXFORMAT_GRAYSCALE) {
         memcpy(dst, src + line * width, width);
     } else if(format == PIXFORMAT_RGB888) {
-        l = width * 3;
-        src += l * line;
-        for(i=0; i<l; i+=3) {
-            dst[o++] = src[i+2];
-            dst[o++] = src[i+1];
-            dst[o++] = src[i];
-        }
+        pixconv_swap_rb(src + line * width * 3, dst, width);
     } else if(format == PIXFORMAT_RGB565) {
-        l = width * 2;
-        src += l * line;
-        for(i=0; i<l; i+=2) {
-            dst[o++] = src[i] & 0xF8;
-            dst[o++] = (src[i] & 0x07) << 5 | (src[i+1] & 0xE0) >> 3;
-            dst[o++] = (src[i+1] & 0x1F) << 3;
-        }
+        pixconv_rgb565_to_rgb888(src + line * width * 2, dst, width);
     } else if(format == PIXFORMAT_YUV422) {
-        uint8_t y0, y1, u, v;
-        uint8_t r, g, b;
-        l = width * 2;
-        src += l * line;
-        for(i=0; i<l; i+=4) {
-            y0 = src[i];
-            u = src[i+1];
-            y1 = src[i+2];
-            v = src[i+3];
-
-            yuv2rgb(y0, u, v, &r, &g, &b);
-            dst[o++] = r;
-            dst[o++] = g;
-            dst[o++] = b;
-
-            yuv2rgb(y1, u, v, &r, &g, &b);
-            dst[o++] = r;
-            dst[o++] = g;
-            dst[o++] = b;
-        }
+        pixconv_yuyv_to_rgb888(src + line * width * 2, dst, width);
     }
 }
 
@@ -108,6 +97,8 @@ bool convert_image(uint8_t *src, uint16_t width, uint16_t height, pixformat_t fo
     comp_params.m_subsampling = subsampling;
     comp_params.m_quality = quality;
 
+    // held until dst_image is destroyed
+    encoder_lock lock;
     jpge::jpeg_encoder dst_image;
 
     if (!dst_image.init(dst_stream, width, height, num_channels, comp_params)) {
@@ -10,9 +10,25 @@
 #define JD_FORMAT		0	/* Output pixel format 0:RGB888 (3 BYTE/pix), 1:RGB565 (1 WORD/pix) */
 #define	JD_USE_SCALE	1	/* Use descaling feature for output */
 #define JD_TBLCLIP		1	/* Use table for saturation (might be a bit faster but increases 1K bytes of code size) */
+#ifndef JD_FASTDECODE
+#define JD_FASTDECODE	1	/* Huffman decoding 0:Bit by bit with a linear table search, 1:Lookahead tables and a 32-bit bit buffer */
+#endif
+#ifndef JD_HUFFLOOKAHEAD
+#define JD_HUFFLOOKAHEAD	9	/* Code length resolved by a single table lookup when JD_FASTDECODE (longer codes use the search) */
+#endif
+
+/* Extra bytes of memory pool needed by the lookahead tables (two tables per Huffman table ID) */
+#define JD_SZLUT		(JD_FASTDECODE ? 2 * 2 * (1 << JD_HUFFLOOKAHEAD) * 2 : 0)
+
+/* The software decoder is linked next to the ROM copy on chips that have one,
+   so its entry points are renamed to keep both available */
+#define jd_prepare		jd_prepare_sw
+#define jd_decomp		jd_decomp_sw
 
 /*---------------------------------------------------------------------------*/
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,10 +48,10 @@ typedef unsigned short	USHORT;
 typedef unsigned short	WORD;
 typedef unsigned short	WCHAR;
 
-/* These types must be 32-bit integer */
-typedef long			LONG;
-typedef unsigned long	ULONG;
-typedef unsigned long	DWORD;
+/* These types must be 32-bit integer (long is 64-bit on the host builds of the tests) */
+typedef int32_t			LONG;
+typedef uint32_t		ULONG;
+typedef uint32_t		DWORD;
 
 
 /* Error code */
@@ -52,6 +68,11 @@ typedef enum {
 } JRESULT;
 
 
+/* Output mode (set JDEC.outfmt after jd_prepare) */
+#define JD_OUT_COLOR	0	/* Output pixels in JD_FORMAT */
+#define JD_OUT_GRAY		1	/* Output luma only (1 BYTE/pix), chroma is decoded but not transformed */
+
+
 
 /* Rectangular structure */
 typedef struct {
@@ -67,7 +88,14 @@ struct JDEC {
 	BYTE* dptr;				/* Current data read ptr */
 	BYTE* inbuf;			/* Bit stream input buffer */
 	BYTE dmsk;				/* Current bit in the current read byte */
+#if JD_FASTDECODE
+	ULONG wreg;				/* Bit buffer, the dbit valid bits are right-aligned */
+	BYTE dbit;				/* Number of valid bits in the bit buffer */
+	BYTE marker;			/* Marker found while filling the bit buffer (0:None) */
+	WORD* hufflut[2][2];	/* Huffman lookahead tables [id][dcac], entry = (code length << 8) | data, 0:longer code */
+#endif
 	BYTE scale;				/* Output scaling ratio */
+	BYTE outfmt;			/* Output mode (JD_OUT_COLOR or JD_OUT_GRAY) */
 	BYTE msx, msy;			/* MCU size in unit of block (width, height) */
 	BYTE qtid[3];			/* Quantization table ID of each component */
 	SHORT dcv[3];			/* Previous DC element of each component */
@@ -90,6 +118,8 @@ struct JDEC {
 /* TJpgDec API functions */
 JRESULT jd_prepare (JDEC*, UINT(*)(JDEC*,BYTE*,UINT), void*, UINT, void*);
 JRESULT jd_decomp (JDEC*, UINT(*)(JDEC*,void*,JRECT*), BYTE);
+JRESULT jd_decomp_part (JDEC*, UINT(*)(JDEC*,void*,JRECT*), BYTE, UINT, UINT);
+JRESULT jd_decomp_rect (JDEC*, UINT(*)(JDEC*,void*,JRECT*), BYTE, UINT, JRECT*, UINT);
 
 
 #ifdef __cplusplus
@@ -239,6 +239,20 @@ UINT create_huffman_tbl (	/* 0:OK, !0:Failed */
 			if (!cls && d > 11) return JDR_FMT1;
 			*pd++ = d;
 		}
+
+#if JD_FASTDECODE
+		ph = alloc_pool(jd, (1 << JD_HUFFLOOKAHEAD) * sizeof (WORD));	/* Allocate a memory block for the lookahead table */
+		if (!ph) return JDR_MEM1;			/* Err: not enough memory */
+		jd->hufflut[num][cls] = ph;
+		for (i = 0; i < (1 << JD_HUFFLOOKAHEAD); i++) ph[i] = 0;	/* Longer codes are left to the table search */
+		pd = jd->huffdata[num][cls];
+		for (j = i = 0; i < JD_HUFFLOOKAHEAD; i++) {	/* Every code word up to JD_HUFFLOOKAHEAD bits fills the entries it prefixes */
+			for (b = pb[i]; b; b--, j++) {
+				hc = jd->huffcode[num][cls][j] << (JD_HUFFLOOKAHEAD - 1 - i);
+				for (np = 1 << (JD_HUFFLOOKAHEAD - 1 - i); np; np--) ph[hc++] = (WORD)(((i + 1) << 8) | pd[j]);
+			}
+		}
+#endif
 	}
 
 	return JDR_OK;
@@ -247,6 +261,152 @@ UINT create_huffman_tbl (	/* 0:OK, !0:Failed */
 
 
 
+#if JD_FASTDECODE
+/*-----------------------------------------------------------------------*/
+/* Get a byte from input stream                                          */
+/*-----------------------------------------------------------------------*/
+
+static
+INT getbyte (	/* >=0: data byte, <0: error code */
+	JDEC* jd	/* Pointer to the decompressor object */
+)
+{
+	if (!jd->dctr) {	/* No input data is available, re-fill input buffer */
+		jd->dptr = jd->inbuf;
+		jd->dctr = jd->infunc(jd, jd->dptr, JD_SZBUF);
+		if (!jd->dctr) return 0 - (INT)JDR_INP;	/* Err: read error or wrong stream termination */
+	} else {
+		jd->dptr++;		/* Next data ptr */
+	}
+	jd->dctr--;			/* Decrement number of available bytes */
+
+	return *jd->dptr;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Fill the bit buffer with more than 24 bits                            */
+/*-----------------------------------------------------------------------*/
+
+static
+INT fillbits (	/* 0:OK, <0: error code */
+	JDEC* jd,	/* Pointer to the decompressor object */
+	UINT nbit	/* Number of bits required in the bit buffer */
+)
+{
+	INT d;
+
+
+	while (jd->dbit <= 24) {
+		if (jd->marker) {		/* The entropy-coded segment ended at a marker */
+			if (jd->dbit >= nbit) break;
+			return 0 - (INT)JDR_FMT1;	/* Err: unexpected flag is detected (may be collapted data) */
+		}
+		d = getbyte(jd);
+		if (d == 0xFF) {		/* Flag sequence */
+			d = getbyte(jd);
+			if (d > 0) {		/* A marker, keep it for restart() */
+				jd->marker = (BYTE)d;
+				continue;
+			}
+			if (d == 0) d = 0xFF;	/* The flag is a data 0xFF */
+		}
+		if (d < 0) {			/* Input ended: an error only if the required bits are missing */
+			if (jd->dbit >= nbit) break;
+			return d;
+		}
+		jd->wreg = (jd->wreg << 8) | (ULONG)d;
+		jd->dbit += 8;
+	}
+
+	return 0;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Extract N bits from input stream                                      */
+/*-----------------------------------------------------------------------*/
+
+static
+INT bitext (	/* >=0: extracted data, <0: error code */
+	JDEC* jd,	/* Pointer to the decompressor object */
+	UINT nbit	/* Number of bits to extract (1 to 11) */
+)
+{
+	INT rc;
+
+
+	if (jd->dbit < nbit) {
+		rc = fillbits(jd, nbit);
+		if (rc) return rc;
+	}
+	jd->dbit -= nbit;
+
+	return (INT)(jd->wreg >> jd->dbit) & ((1 << nbit) - 1);
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Extract a huffman decoded data from input stream                      */
+/*-----------------------------------------------------------------------*/
+
+static
+INT huffext (	/* >=0: decoded data, <0: error code */
+	JDEC* jd,	/* Pointer to the decompressor object */
+	UINT id,	/* Huffman table ID */
+	UINT cls	/* Table class 0:DC, 1:AC */
+)
+{
+	const BYTE *hb, *hd;
+	const WORD *hc;
+	UINT dbit, v, bl, nd;
+	INT rc;
+
+
+	if (jd->dbit < 16) {	/* Get the longest code word into the bit buffer if the input has it */
+		rc = fillbits(jd, 1);
+		if (rc) return rc;
+	}
+	dbit = jd->dbit;
+
+	/* Look up the next JD_HUFFLOOKAHEAD bits (zero padded at the end of input) */
+	v = (dbit >= JD_HUFFLOOKAHEAD) ? (UINT)(jd->wreg >> (dbit - JD_HUFFLOOKAHEAD)) : (UINT)(jd->wreg << (JD_HUFFLOOKAHEAD - dbit));
+	v = jd->hufflut[id][cls][v & ((1 << JD_HUFFLOOKAHEAD) - 1)];
+	if (v) {
+		if ((v >> 8) > dbit) return 0 - (INT)(jd->marker ? JDR_FMT1 : JDR_INP);	/* Err: the code word is cut by a marker or the end of input */
+		jd->dbit = (BYTE)(dbit - (v >> 8));
+		return (INT)(v & 0xFF);
+	}
+
+	/* Longer code word: search the code word tables from JD_HUFFLOOKAHEAD + 1 bits */
+	hb = jd->huffbits[id][cls]; hc = jd->huffcode[id][cls]; hd = jd->huffdata[id][cls];
+	for (bl = 1; bl <= 16; bl++) {
+		nd = *hb++;
+		if (bl <= JD_HUFFLOOKAHEAD) {
+			hc += nd; hd += nd;
+			continue;
+		}
+		if (bl > dbit) return 0 - (INT)(jd->marker ? JDR_FMT1 : JDR_INP);	/* Err: the code word is cut by a marker or the end of input */
+		v = (UINT)(jd->wreg >> (dbit - bl)) & ((1 << bl) - 1);
+		for ( ; nd; nd--, hc++, hd++) {
+			if (v == *hc) {		/* Matched? */
+				jd->dbit = (BYTE)(dbit - bl);
+				return *hd;		/* Return the decoded data */
+			}
+		}
+	}
+
+	return 0 - (INT)JDR_FMT1;	/* Err: code not found (may be collapted data) */
+}
+
+#else	/* JD_FASTDECODE */
+
 /*-----------------------------------------------------------------------*/
 /* Extract N bits from input stream                                      */
 /*-----------------------------------------------------------------------*/
@@ -357,6 +517,8 @@ INT huffext (			/* >=0: decoded data, <0: error code */
 	return 0 - (INT)JDR_FMT1;	/* Err: code not found (may be collapted data) */
 }
 
+#endif	/* JD_FASTDECODE */
+
 
 
 
@@ -479,15 +641,18 @@ void block_idct (
 
 static
 JRESULT mcu_load (
-	JDEC* jd		/* Pointer to the decompressor object */
+	JDEC* jd,		/* Pointer to the decompressor object */
+	BYTE skip		/* 1:Only parse the MCU to advance the stream and DC values */
 )
 {
 	LONG *tmp = (LONG*)jd->workbuf;	/* Block working buffer for de-quantize and IDCT */
-	UINT blk, nby, nbc, i, z, id, cmp;
+	UINT blk, nby, nbc, i, z, id, cmp, ac;
 	INT b, d, e;
 	BYTE *bp;
+#if !JD_FASTDECODE
 	const BYTE *hb, *hd;
 	const WORD *hc;
+#endif
 	const LONG *dqf;
 
 
@@ -500,10 +665,14 @@ JRESULT mcu_load (
 		id = cmp ? 1 : 0;						/* Huffman table ID of the component */
 
 		/* Extract a DC element from input stream */
+#if JD_FASTDECODE
+		b = huffext(jd, id, 0);					/* Extract a huffman coded data (bit length) */
+#else
 		hb = jd->huffbits[id][0];				/* Huffman table for the DC element */
 		hc = jd->huffcode[id][0];
 		hd = jd->huffdata[id][0];
 		b = huffext(jd, hb, hc, hd);			/* Extract a huffman coded data (bit length) */
+#endif
 		if (b < 0) return 0 - b;				/* Err: invalid code or input */
 		d = jd->dcv[cmp];						/* DC value of previous block */
 		if (b) {								/* If there is any difference from previous block */
@@ -518,13 +687,22 @@ JRESULT mcu_load (
 		tmp[0] = d * dqf[0] >> 8;				/* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
 
 		/* Extract following 63 AC elements from input stream */
-		for (i = 1; i < 64; i++) tmp[i] = 0;	/* Clear rest of elements */
+		if (!skip) {
+			for (i = 1; i < 64; i++) tmp[i] = 0;	/* Clear rest of elements */
+		}
+#if !JD_FASTDECODE
 		hb = jd->huffbits[id][1];				/* Huffman table for the AC elements */
 		hc = jd->huffcode[id][1];
 		hd = jd->huffdata[id][1];
+#endif
 		i = 1;					/* Top of the AC elements */
+		ac = 0;					/* No AC element found yet */
 		do {
+#if JD_FASTDECODE
+			b = huffext(jd, id, 1);				/* Extract a huffman coded value (zero runs and bit length) */
+#else
 			b = huffext(jd, hb, hc, hd);		/* Extract a huffman coded value (zero runs and bit length) */
+#endif
 			if (b == 0) break;					/* EOB? */
 			if (b < 0) return 0 - b;			/* Err: invalid code or input error */
 			z = (UINT)b >> 4;					/* Number of leading zero elements */
@@ -539,13 +717,23 @@ JRESULT mcu_load (
 				if (!(d & b)) d -= (b << 1) - 1;/* Restore negative value if needed */
 				z = ZIG(i);						/* Zigzag-order to raster-order converted index */
 				tmp[z] = d * dqf[z] >> 8;		/* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
+				ac = 1;
 			}
 		} while (++i < 64);		/* Next AC element */
 
-		if (JD_USE_SCALE && jd->scale == 3)
+		if (skip || (jd->outfmt == JD_OUT_GRAY && cmp)) {
+			bp += 64;			/* Skipped MCUs and chroma blocks of luma-only output are not transformed */
+			continue;
+		}
+
+		if (JD_USE_SCALE && jd->scale == 3) {
 			*bp = (*tmp / 256) + 128;	/* If scale ratio is 1/8, IDCT can be ommited and only DC element is used */
-		else
+		} else if (!ac) {
+			b = BYTECLIP((*tmp >> 8) + 128);	/* If there is no AC element, IDCT output is the flat DC level */
+			for (i = 0; i < 64; i++) bp[i] = (BYTE)b;
+		} else {
 			block_idct(tmp, bp);		/* Apply IDCT and store the block to the MCU buffer */
+		}
 
 		bp += 64;				/* Next block */
 	}
@@ -707,6 +895,86 @@ JRESULT mcu_output (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Output an MCU: Copy (and descale) the Y blocks as a grayscale rectangle */
+/*-----------------------------------------------------------------------*/
+
+static
+JRESULT mcu_output_gray (
+	JDEC* jd,	/* Pointer to the decompressor object */
+	UINT (*outfunc)(JDEC*, void*, JRECT*),	/* Grayscale output function */
+	UINT x,		/* MCU position in the image (left of the MCU) */
+	UINT y		/* MCU position in the image (top of the MCU) */
+)
+{
+	UINT ix, iy, mx, my, rx, ry, bx, by, s, w, v;
+	BYTE *py, *op;
+	JRECT rect;
+
+
+	mx = jd->msx * 8; my = jd->msy * 8;					/* MCU size (pixel) */
+	rx = (x + mx <= jd->width) ? mx : jd->width - x;	/* Output rectangular size (it may be clipped at right/bottom end) */
+	ry = (y + my <= jd->height) ? my : jd->height - y;
+	if (JD_USE_SCALE) {
+		rx >>= jd->scale; ry >>= jd->scale;
+		if (!rx || !ry) return JDR_OK;					/* Skip this MCU if all pixel is to be rounded off */
+		x >>= jd->scale; y >>= jd->scale;
+	}
+	rect.left = x; rect.right = x + rx - 1;				/* Rectangular area in the frame buffer */
+	rect.top = y; rect.bottom = y + ry - 1;
+
+	op = (BYTE*)jd->workbuf;
+	if (!JD_USE_SCALE || !jd->scale) {	/* Full size: gather Y block rows into raster order */
+		for (iy = 0; iy < my; iy++) {
+			py = jd->mcubuf + (iy >> 3) * jd->msx * 64 + (iy & 7) * 8;
+			for (bx = 0; bx < jd->msx; bx++) {
+				for (ix = 0; ix < 8; ix++) *op++ = py[ix];
+				py += 64;
+			}
+		}
+	} else if (jd->scale != 3) {		/* 1/2 and 1/4: average each square inside its block */
+		s = jd->scale * 2;	/* Number of shifts for averaging */
+		w = 1 << jd->scale;	/* Width of square */
+		for (iy = 0; iy < my; iy += w) {
+			for (ix = 0; ix < mx; ix += w) {
+				py = jd->mcubuf + ((iy >> 3) * jd->msx + (ix >> 3)) * 64 + (iy & 7) * 8 + (ix & 7);
+				v = 0;
+				for (by = 0; by < w; by++) {
+					for (bx = 0; bx < w; bx++) v += py[bx];
+					py += 8;
+				}
+				*op++ = (BYTE)(v >> s);
+			}
+		}
+	} else {							/* 1/8: the DC value of each block is a pixel */
+		py = jd->mcubuf;
+		for (by = 0; by < jd->msy; by++) {
+			for (bx = 0; bx < jd->msx; bx++) {
+				*op++ = *py;
+				py += 64;
+			}
+		}
+	}
+
+	/* Squeeze up pixel table if a part of MCU is to be truncated */
+	mx >>= jd->scale;
+	if (rx < mx) {
+		BYTE *s, *d;
+
+		s = d = (BYTE*)jd->workbuf;
+		for (iy = 0; iy < ry; iy++) {
+			for (ix = 0; ix < rx; ix++) *d++ = *s++;	/* Copy effective pixels */
+			s += mx - rx;	/* Skip truncated pixels */
+		}
+	}
+
+	/* Output the grayscale rectangular */
+	return outfunc(jd, jd->workbuf, &rect) ? JDR_OK : JDR_INTR;
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Process restart interval                                              */
 /*-----------------------------------------------------------------------*/
@@ -723,20 +991,30 @@ JRESULT restart (
 
 
 	/* Discard padding bits and get two bytes from the input stream */
-	dp = jd->dptr; dc = jd->dctr;
-	d = 0;
-	for (i = 0; i < 2; i++) {
-		if (!dc) {	/* No input data is available, re-fill input buffer */
-			dp = jd->inbuf;
-			dc = jd->infunc(jd, dp, JD_SZBUF);
-			if (!dc) return JDR_INP;
-		} else {
-			dp++;
+#if JD_FASTDECODE
+	jd->wreg = 0; jd->dbit = 0;		/* The marker may have been read already by the bit buffer */
+	if (jd->marker) {
+		d = 0xFF00 | jd->marker;
+		jd->marker = 0;
+	} else
+#endif
+	{
+		dp = jd->dptr; dc = jd->dctr;
+		d = 0;
+		for (i = 0; i < 2; i++) {
+			if (!dc) {	/* No input data is available, re-fill input buffer */
+				dp = jd->inbuf;
+				dc = jd->infunc(jd, dp, JD_SZBUF);
+				if (!dc) return JDR_INP;
+			} else {
+				dp++;
+			}
+			dc--;
+			d = (d << 8) | *dp;	/* Get a byte */
 		}
-		dc--;
-		d = (d << 8) | *dp;	/* Get a byte */
+		jd->dptr = dp; jd->dctr = dc;
 	}
-	jd->dptr = dp; jd->dctr = dc; jd->dmsk = 0;
+	jd->dmsk = 0;
 
 	/* Check the marker */
 	if ((d & 0xFFD8) != 0xFFD0 || (d & 7) != (rstn & 7))
@@ -780,12 +1058,16 @@ JRESULT jd_prepare (
 	jd->infunc = infunc;	/* Stream input function */
 	jd->device = dev;		/* I/O device identifier */
 	jd->nrst = 0;			/* No restart interval (default) */
+	jd->outfmt = JD_OUT_COLOR;	/* Color output (default) */
 
 	for (i = 0; i < 2; i++) {	/* Nulls pointers */
 		for (j = 0; j < 2; j++) {
 			jd->huffbits[i][j] = 0;
 			jd->huffcode[i][j] = 0;
 			jd->huffdata[i][j] = 0;
+#if JD_FASTDECODE
+			jd->hufflut[i][j] = 0;
+#endif
 		}
 	}
 	for (i = 0; i < 4; i++) jd->qttbl[i] = 0;
@@ -892,6 +1174,9 @@ JRESULT jd_prepare (
 
 			/* Pre-load the JPEG data to extract it from the bit stream */
 			jd->dptr = seg; jd->dctr = 0; jd->dmsk = 0;	/* Prepare to read bit stream */
+#if JD_FASTDECODE
+			jd->wreg = 0; jd->dbit = 0; jd->marker = 0;	/* Empty bit buffer */
+#endif
 			if (ofs %= JD_SZBUF) {						/* Align read offset to JD_SZBUF */
 				jd->dctr = jd->infunc(jd, seg + ofs, JD_SZBUF - (UINT)ofs);
 				jd->dptr = seg + ofs - 1;
@@ -926,45 +1211,144 @@ JRESULT jd_prepare (
 
 
 /*-----------------------------------------------------------------------*/
-/* Start to decompress the JPEG picture                                  */
+/* Decompress a run of MCUs, optionally only those inside some regions   */
 /*-----------------------------------------------------------------------*/
 
-JRESULT jd_decomp (
-	JDEC* jd,								/* Initialized decompression object */
+static
+JRESULT decomp_run (
+	JDEC* jd,								/* Initialized decompression object, stream positioned at the first MCU of the run */
 	UINT (*outfunc)(JDEC*, void*, JRECT*),	/* RGB output function */
-	BYTE scale								/* Output de-scaling factor (0 to 3) */
+	BYTE scale,								/* Output de-scaling factor (0 to 3) */
+	UINT mcu_first,							/* Index of the first MCU to decode (raster order, multiple of the restart interval) */
+	UINT mcu_count,							/* Number of MCUs to decode */
+	const JRECT* rect,						/* Regions to output in MCU units (inclusive), 0:Output every MCU */
+	UINT nrect								/* Number of regions */
 )
 {
-	UINT x, y, mx, my;
+	UINT x, y, mx, my, nx, n, i;
 	WORD rst, rsc;
+	BYTE skip;
 	JRESULT rc;
 
 
 	if (scale > (JD_USE_SCALE ? 3 : 0)) return JDR_PAR;
+	if (mcu_first && (!jd->nrst || mcu_first % jd->nrst)) return JDR_PAR;	/* Err: a run can only start after a RSTn marker */
 	jd->scale = scale;
 
 	mx = jd->msx * 8; my = jd->msy * 8;			/* Size of the MCU (pixel) */
+	nx = (jd->width + mx - 1) / mx;				/* Number of MCUs in a row */
 
 	jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;	/* Initialize DC values */
-	rst = rsc = 0;
+	rst = 0;
+	rsc = jd->nrst ? (WORD)(mcu_first / jd->nrst) : 0;	/* Sequence number of the next RSTn marker */
 
 	rc = JDR_OK;
-	for (y = 0; y < jd->height; y += my) {		/* Vertical loop of MCUs */
-		for (x = 0; x < jd->width; x += mx) {	/* Horizontal loop of MCUs */
-			if (jd->nrst && rst++ == jd->nrst) {	/* Process restart interval if enabled */
-				rc = restart(jd, rsc++);
-				if (rc != JDR_OK) return rc;
-				rst = 1;
-			}
-			rc = mcu_load(jd);					/* Load an MCU (decompress huffman coded stream and apply IDCT) */
+	x = (mcu_first % nx) * mx; y = (mcu_first / nx) * my;
+	for (n = 0; n < mcu_count && y < jd->height; n++) {
+		if (jd->nrst && rst++ == jd->nrst) {	/* Process restart interval if enabled */
+			rc = restart(jd, rsc++);
 			if (rc != JDR_OK) return rc;
-			rc = mcu_output(jd, outfunc, x, y);	/* Output the MCU (color space conversion, scaling and output) */
+			rst = 1;
+		}
+		skip = 0;
+		if (rect) {							/* Is the MCU in any of the regions? */
+			for (i = 0; i < nrect; i++) {
+				if (x / mx >= rect[i].left && x / mx <= rect[i].right && y / my >= rect[i].top && y / my <= rect[i].bottom) break;
+			}
+			skip = (i == nrect);
+		}
+		rc = mcu_load(jd, skip);			/* Load an MCU (decompress huffman coded stream and apply IDCT) */
+		if (rc != JDR_OK) return rc;
+		if (!skip) {
+			if (jd->outfmt == JD_OUT_GRAY)
+				rc = mcu_output_gray(jd, outfunc, x, y);	/* Output the MCU (luma only, scaling and output) */
+			else
+				rc = mcu_output(jd, outfunc, x, y);	/* Output the MCU (color space conversion, scaling and output) */
 			if (rc != JDR_OK) return rc;
 		}
+		x += mx;							/* Next MCU, wrapping to the next row */
+		if (x >= jd->width) {
+			x = 0; y += my;
+		}
 	}
 
 	return rc;
 }
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decompress a run of MCUs starting at a restart interval boundary      */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_decomp_part (
+	JDEC* jd,								/* Initialized decompression object, stream positioned at the first MCU of the run */
+	UINT (*outfunc)(JDEC*, void*, JRECT*),	/* RGB output function */
+	BYTE scale,								/* Output de-scaling factor (0 to 3) */
+	UINT mcu_first,							/* Index of the first MCU to decode (raster order, multiple of the restart interval) */
+	UINT mcu_count							/* Number of MCUs to decode */
+)
+{
+	return decomp_run(jd, outfunc, scale, mcu_first, mcu_count, 0, 0);
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decompress only the MCUs intersecting some regions of the picture     */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_decomp_rect (
+	JDEC* jd,								/* Initialized decompression object, stream positioned at the first MCU of the run */
+	UINT (*outfunc)(JDEC*, void*, JRECT*),	/* RGB output function */
+	BYTE scale,								/* Output de-scaling factor (0 to 3) */
+	UINT mcu_first,							/* Index of the first MCU of the run (raster order, multiple of the restart interval) */
+	JRECT* rect,							/* Regions in input pixels (inclusive), converted to MCU units in place */
+	UINT nrect								/* Number of regions */
+)
+{
+	UINT mx, my, nx, i, last;
+
+
+	mx = jd->msx * 8; my = jd->msy * 8;			/* Size of the MCU (pixel) */
+	nx = (jd->width + mx - 1) / mx;				/* Number of MCUs in a row */
+
+	last = 0;
+	for (i = 0; i < nrect; i++) {
+		if (rect[i].left > rect[i].right || rect[i].top > rect[i].bottom) return JDR_PAR;
+		rect[i].left /= mx; rect[i].right /= mx;	/* Pixels to MCUs */
+		rect[i].top /= my; rect[i].bottom /= my;
+		if (rect[i].right >= nx) rect[i].right = nx - 1;
+		if ((UINT)rect[i].bottom * nx + rect[i].right > last) last = (UINT)rect[i].bottom * nx + rect[i].right;
+	}
+	if (!nrect || last < mcu_first) return JDR_OK;	/* Nothing to output in this run */
+
+	return decomp_run(jd, outfunc, scale, mcu_first, last + 1 - mcu_first, rect, nrect);	/* Stop after the last MCU needed */
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Start to decompress the JPEG picture                                  */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_decomp (
+	JDEC* jd,								/* Initialized decompression object */
+	UINT (*outfunc)(JDEC*, void*, JRECT*),	/* RGB output function */
+	BYTE scale								/* Output de-scaling factor (0 to 3) */
+)
+{
+	UINT nx, ny;
+
+
+	nx = (jd->width + jd->msx * 8 - 1) / (jd->msx * 8);	/* Number of MCUs in the picture */
+	ny = (jd->height + jd->msy * 8 - 1) / (jd->msy * 8);
+
+	return jd_decomp_part(jd, outfunc, scale, 0, nx * ny);
+}
 #endif//SUPPORT_JPEG
 
 
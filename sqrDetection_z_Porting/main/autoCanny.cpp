@@ -0,0 +1,99 @@
+/**
+ * @file autoCanny.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the choice of the Canny thresholds frame by frame.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <autoCanny.hpp>
+#include <stdlib.h>
+
+
+// Largest |dx|+|dy| of a 3x3 Sobel on 8-bit pixels
+#define MAX_MAGNITUDE 2040
+
+// Bounds of the contour feedback on the fractions
+#define MIN_SCALE 0.25f
+#define SCALE_DOWN 0.8f
+#define SCALE_UP 1.1f
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sobelHistogram(const Mat & gray, Mat & dx, Mat & dy, vector<uint32_t> & histogram)
+{
+  int cols = gray.cols;
+
+  dx.create(gray.rows, cols, CV_16SC1);
+  dy.create(gray.rows, cols, CV_16SC1);
+  histogram.assign(MAX_MAGNITUDE + 1, 0);
+
+  // Vertical smoothing and difference of the three rows, one column at a time, with a replicated
+  // column at both ends: the horizontal part of the kernels is then applied on them
+  vector<int16_t> smooth(cols + 2), diff(cols + 2);
+
+  for(int y = 0; y < gray.rows; y++)
+  {
+    const uint8_t * above = gray.ptr<uint8_t>(max(y - 1, 0));
+    const uint8_t * row = gray.ptr<uint8_t>(y);
+    const uint8_t * below = gray.ptr<uint8_t>(min(y + 1, gray.rows - 1));
+    int16_t * gx = dx.ptr<int16_t>(y);
+    int16_t * gy = dy.ptr<int16_t>(y);
+
+    for(int x = 0; x < cols; x++)
+    {
+      smooth[x + 1] = above[x] + 2 * row[x] + below[x];
+      diff[x + 1] = below[x] - above[x];
+    }
+    smooth[0] = smooth[1];
+    diff[0] = diff[1];
+    smooth[cols + 1] = smooth[cols];
+    diff[cols + 1] = diff[cols];
+
+    for(int x = 0; x < cols; x++)
+    {
+      int16_t sx = smooth[x + 2] - smooth[x];
+      int16_t sy = diff[x] + 2 * diff[x + 1] + diff[x + 2];
+      gx[x] = sx;
+      gy[x] = sy;
+      histogram[abs(sx) + abs(sy)]++;
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Smallest magnitude with at most `above` pixels over it
+static int percentile(const vector<uint32_t> & histogram, uint32_t above)
+{
+  uint32_t count = 0;
+  int m = MAX_MAGNITUDE;
+  while(m > 0 && count + histogram[m] <= above)
+    count += histogram[m--];
+  return m;
+}
+
+void autoCannyThresholds(AutoCanny & canny, const vector<uint32_t> & histogram)
+{
+  uint32_t pixels = 0;
+  for(unsigned int m = 0; m < histogram.size(); m++)
+    pixels += histogram[m];
+
+  canny.high = max(percentile(histogram, (uint32_t)(pixels * canny.highFraction * canny.scale)), canny.minHigh);
+  canny.low = max(percentile(histogram, (uint32_t)(pixels * canny.lowFraction * canny.scale)), canny.minLow);
+  canny.low = min(canny.low, canny.high);
+}
+
+void autoCannyTrack(AutoCanny & canny, unsigned int contours)
+{
+  canny.contours = contours;
+
+  // Too many contours: fewer edges on the next frames, then back to the settings little by little
+  if(contours > canny.maxContours)
+    canny.scale = max(canny.scale * SCALE_DOWN, MIN_SCALE);
+  else
+    canny.scale = min(canny.scale * SCALE_UP, 1.0f);
+}
@@ -0,0 +1,431 @@
+/**
+ * @file benchmark.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the benchmark of the detection stages.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <benchmark.hpp>
+#include <sqrDetection.hpp>
+#include <edgeRuns.hpp>
+#include <squareVerifier.hpp>
+#include <autoCanny.hpp>
+#include <frameArena.hpp>
+#include <bitmapUtils.h>
+#include <pixel_convert.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#ifdef ESP_PLATFORM
+#include <sdkconfig.h>
+#include <esp_mac.h>
+#include <esp_psram.h>
+#endif
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "benchmark";
+
+// Time each stage runs for (us), and largest number of iterations
+#ifndef BENCHMARK_MIN_TIME
+#define BENCHMARK_MIN_TIME 200000
+#endif
+#ifndef BENCHMARK_MAX_ITERATIONS
+#define BENCHMARK_MAX_ITERATIONS 1000
+#endif
+
+// Self-test: scene, and buffers of the copies (the PSRAM ones are larger than the cache)
+#define SELFTEST_WIDTH 640
+#define SELFTEST_HEIGHT 480
+#define SELFTEST_CLUTTER 20
+#ifndef SELFTEST_INTERNAL_BUFFER
+#define SELFTEST_INTERNAL_BUFFER (32 * 1024)
+#endif
+#ifndef SELFTEST_PSRAM_BUFFER
+#define SELFTEST_PSRAM_BUFFER (1024 * 1024)
+#endif
+#ifndef SELFTEST_COPY_RUNS
+#define SELFTEST_COPY_RUNS 5
+#endif
+
+// Bytes per pixel of the buffers alive at the same time (gray, dx, dy and edges at most)
+#define BYTES_PER_PIXEL 6
+
+// Markers of the scenes: side and grid step in pixels (the area fits the fitQuad limits)
+#define MARKER_SIDE 64
+#define MARKER_STEP 128
+
+struct Resolution
+{
+  const char * name;
+  int width;
+  int height;
+};
+
+static const Resolution RESOLUTIONS[] = {{"QVGA", 320, 240}, {"VGA", 640, 480}, {"SVGA", 800, 600}, {"UXGA", 1600, 1200}};
+
+// Number of distractor shapes of the scenes
+static const int CLUTTER[] = {0, 20, 80};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Grid of dark markers on a light background, distractor shapes (outlines, filled shapes, lines)
+// and sensor noise
+static void renderScene(Mat & gray, int clutter, uint64_t seed)
+{
+  RNG rng(seed);
+
+  gray.setTo(Scalar(180));
+  for(int y = MARKER_STEP / 2; y + MARKER_SIDE < gray.rows; y += MARKER_STEP)
+  {
+    for(int x = MARKER_STEP / 2; x + MARKER_SIDE < gray.cols; x += MARKER_STEP)
+      rectangle(gray, Rect(x, y, MARKER_SIDE, MARKER_SIDE), Scalar(30), FILLED);
+  }
+
+  for(int i = 0; i < clutter; i++)
+  {
+    Point p(rng.uniform(0, gray.cols), rng.uniform(0, gray.rows));
+    int size = rng.uniform(8, 120);
+    Scalar shade(rng.uniform(0, 256));
+    switch(rng.uniform(0, 3))
+    {
+      case 0:
+        rectangle(gray, Rect(p.x, p.y, size, rng.uniform(8, 120)), shade, rng.uniform(0, 2) ? FILLED : 2);
+        break;
+      case 1:
+        circle(gray, p, size / 2, shade, rng.uniform(0, 2) ? FILLED : 2);
+        break;
+      default:
+        line(gray, p, Point(p.x + rng.uniform(-size, size), p.y + rng.uniform(-size, size)), shade, 2);
+        break;
+    }
+  }
+
+  Mat noise(gray.size(), CV_16SC1);
+  rng.fill(noise, RNG::NORMAL, 0, 4);
+  add(gray, noise, gray, noArray(), CV_8U);
+}
+
+// Run a stage count times, or until it has run for BENCHMARK_MIN_TIME if count is 0, and record its
+// time per iteration
+template<class Stage>
+static void measure(vector<BenchmarkResult> & results, const char * filter, unsigned int count, const string & stage, const string & scene, unsigned int items, Stage body)
+{
+  // Stages filtered out still run once, the next ones work on their output
+  if(filter != NULL && stage.find(filter) == string::npos)
+  {
+    body();
+    return;
+  }
+
+  vector<int64_t> times;
+  times.reserve(count > 0 ? count : 64);
+  int64_t start = esp_timer_get_time(), last = start, elapsed = 0;
+  do
+  {
+    body();
+    int64_t now = esp_timer_get_time();
+    times.push_back(now - last);
+    last = now;
+    elapsed = now - start;
+  }
+  while(count > 0 ? times.size() < count : elapsed < BENCHMARK_MIN_TIME && times.size() < BENCHMARK_MAX_ITERATIONS);
+
+  unsigned int iterations = times.size();
+  sort(times.begin(), times.end());
+  BenchmarkResult result = {stage + "/" + scene, iterations, (double)elapsed / iterations, items,
+                            (double)times.front(), (double)times[iterations / 2], (double)times.back()};
+  ESP_LOGI(TAG, "%-40s %10.1f us (%.0f/%.0f/%.0f) %6u iterations", result.name.c_str(), result.realTime, result.minTime,
+           result.medianTime, result.maxTime, iterations);
+  results.push_back(result);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// All the stages on one scene, each one on the output of the previous one
+static void benchmarkScene(vector<BenchmarkResult> & results, const char * filter, unsigned int count, const Mat & gray, const string & scene)
+{
+  int pixels = gray.cols * gray.rows;
+  Mat out, median, blurred, dx, dy, edges;
+
+  // Colour conversions, from the frames the camera would give for this scene
+  {
+    Mat rgb565, yuyv(gray.rows, gray.cols, CV_8UC2);
+    cvtColor(gray, rgb565, COLOR_GRAY2BGR565);
+    for(int i = 0; i < pixels; i++)
+    {
+      yuyv.data[2 * i] = gray.data[i];
+      yuyv.data[2 * i + 1] = 128;
+    }
+    out.create(gray.size(), CV_8UC1);
+    measure(results, filter, count, "cvtColor_BGR5652GRAY", scene, 0, [&]{ cvtColor(rgb565, out, COLOR_BGR5652GRAY); });
+    measure(results, filter, count, "yuyvToGray", scene, 0, [&]{ pixconv_yuyv_to_gray(yuyv.data, out.data, pixels); });
+    out.release();
+  }
+
+  // Filters and edges (the buffers are released as soon as possible, to fit larger frames)
+  EdgeMap runs, regions;
+  measure(results, filter, count, "medianBlur", scene, 0, [&]{ medianBlur(gray, median, 3); });
+  measure(results, filter, count, "binarize", scene, 0, [&]{ binarize(median, runs, 30, 5); });
+  measure(results, filter, count, "GaussianBlur", scene, 0, [&]{ GaussianBlur(median, blurred, Size(3,3), 0); });
+  median.release();
+
+  AutoCanny canny = {0.03f, 0.07f, 24, 10, 200};
+  vector<uint32_t> histogram;
+  measure(results, filter, count, "sobelHistogram", scene, 0, [&]{ sobelHistogram(blurred, dx, dy, histogram); });
+  blurred.release();
+  autoCannyThresholds(canny, histogram);
+  measure(results, filter, count, "Canny", scene, 0, [&]{ Canny(dx, dy, edges, canny.low, canny.high); });
+  dx.release();
+  dy.release();
+
+  measure(results, filter, count, "encodeEdges", scene, 0, [&]{ encodeEdges(edges, runs); });
+  edges.release();
+  measure(results, filter, count, "dilate", scene, runs.runs.size(), [&]{ dilateEdges(runs, regions); });
+
+  // Contours, in an arena as in the detection
+  FrameArena arena(256 * 1024);
+  measure(results, filter, count, "findContours", scene, 0, [&]{
+    arena.reset();
+    ContourList found(&arena);
+    findEdgeContours(regions, found);
+  });
+  arena.reset();
+  ContourList contours(&arena);
+  findEdgeContours(regions, contours);
+  unsigned int contourCount = contours.size();
+
+  // Quadrilateral fit and verification of all the contours
+  QuadBatch batch;
+  vector<unsigned int> accepted;
+  measure(results, filter, count, "approxFilter", scene, contourCount, [&]{
+    clearQuads(batch);
+    for(unsigned int i = 0; i < contours.size(); i++)
+    {
+      QuadFit quad;
+      if(fitQuad(contours[i], quad, 1700, 17000))
+        addQuad(batch, quad.corners);
+    }
+    scoreQuads(batch);
+    verifyQuads(batch, 0.7f, accepted);
+  });
+
+  vector<Square> squares;
+  for(unsigned int k = 0; k < accepted.size(); k++)
+  {
+    Square square;
+    square.subCenter = Point2f(batch.cx[accepted[k]], batch.cy[accepted[k]]);
+    square.center = Point(cvRound(square.subCenter.x), cvRound(square.subCenter.y));
+    squares.push_back(square);
+  }
+
+  // Removal of the overlapping squares (on a copy of the list, as it is changed)
+  measure(results, filter, count, "dedupe", scene, squares.size(), [&]{
+    vector<Square> list(squares);
+    for(unsigned int i = 0; i < list.size(); i++)
+    {
+      for(unsigned int j = i + 1; j < list.size(); j++)
+      {
+        if(areOverlapping(list[i], list[j], 10))
+        {
+          list.erase(list.begin() + j);
+          j--;
+        }
+      }
+    }
+  });
+
+  // Colours of the squares from a BGR image of the scene
+  {
+    Mat bgr;
+    cvtColor(gray, bgr, COLOR_GRAY2BGR);
+    measure(results, filter, count, "getColour", scene, squares.size(), [&]{
+      for(unsigned int i = 0; i < squares.size(); i++)
+        getColour(bgr, squares[i], true);
+    });
+  }
+
+  // BMP of the grayscale frame, as saved for the archive
+  measure(results, filter, count, "bmpEncode", scene, 0, [&]{
+    uint8_t * bmp = NULL;
+    size_t length = 0;
+    if(frm2bmp(gray.data, pixels, gray.cols, gray.rows, PIXFORMAT_GRAYSCALE, &bmp, &length))
+      free(bmp);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void runBenchmarks(vector<BenchmarkResult> & results, const char * filter)
+{
+  if(filter != NULL && filter[0] == 0)
+    filter = NULL;
+
+  results.clear();
+  for(const Resolution & resolution : RESOLUTIONS)
+  {
+    size_t needed = (size_t)resolution.width * resolution.height * BYTES_PER_PIXEL;
+    if(heap_caps_get_free_size(MALLOC_CAP_8BIT) < needed)
+    {
+      ESP_LOGW(TAG, "%s skipped: %u bytes needed", resolution.name, (unsigned int)needed);
+      continue;
+    }
+
+    for(int clutter : CLUTTER)
+    {
+      Mat gray(resolution.height, resolution.width, CV_8UC1);
+      renderScene(gray, clutter, resolution.width + clutter);
+      benchmarkScene(results, filter, 0, gray, string(resolution.name) + "/clutter:" + to_string(clutter));
+    }
+  }
+}
+
+// Build and clock settings of the firmware, opening the "context" object of the JSON files
+static void writeContext(FILE * fp)
+{
+  fprintf(fp, "{\n  \"context\": {\n");
+  fprintf(fp, "    \"executable\": \"sqrDetection\",\n");
+  fprintf(fp, "    \"build\": \"%s %s\",\n", __DATE__, __TIME__);
+#ifdef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+  fprintf(fp, "    \"mhz_per_cpu\": %d,\n", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+}
+
+bool saveBenchmarks(const vector<BenchmarkResult> & results, const string & path)
+{
+  FILE * fp = fopen(path.c_str(), "w");
+  if(fp == NULL)
+  {
+    ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+    return false;
+  }
+
+  writeContext(fp);
+  fprintf(fp, "    \"min_time_us\": %d\n  },\n  \"benchmarks\": [\n", BENCHMARK_MIN_TIME);
+  for(unsigned int i = 0; i < results.size(); i++)
+  {
+    const BenchmarkResult & r = results[i];
+    fprintf(fp, "    {\"name\": \"%s\", \"iterations\": %u, \"real_time\": %.3f, \"time_unit\": \"us\", \"items\": %u}%s\n",
+            r.name.c_str(), r.iterations, r.realTime, r.items, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+
+  bool ok = ferror(fp) == 0;
+  fclose(fp);
+  return ok;
+}
+
+// ============================================= SELF-TEST =========================================
+/*------------------------------------------------------------------------------------------------*/
+
+// Copy srcSize bytes of src memory into dstSize bytes of dst memory, the smaller buffer taken again
+// and again until the larger one is covered, and record the fastest of the runs
+static void measureCopy(vector<BandwidthResult> & copies, const char * name, uint32_t srcCaps, size_t srcSize, uint32_t dstCaps, size_t dstSize)
+{
+  uint8_t * src = (uint8_t *)heap_caps_malloc(srcSize, srcCaps | MALLOC_CAP_8BIT);
+  uint8_t * dst = (uint8_t *)heap_caps_malloc(dstSize, dstCaps | MALLOC_CAP_8BIT);
+  size_t total = max(srcSize, dstSize), chunk = min(srcSize, dstSize);
+  BandwidthResult result = {name, total, 0};
+
+  if(src != NULL && dst != NULL)
+  {
+    memset(src, 0x5a, srcSize);
+    int64_t best = INT64_MAX;
+    for(int run = 0; run < SELFTEST_COPY_RUNS; run++)
+    {
+      int64_t start = esp_timer_get_time();
+      for(size_t offset = 0; offset < total; offset += chunk)
+        memcpy(dst + offset % dstSize, src + offset % srcSize, chunk);
+      best = min(best, esp_timer_get_time() - start);
+    }
+    result.bandwidth = (double)total / max(best, (int64_t)1);
+    ESP_LOGI(TAG, "%-40s %10.1f MB/s", name, result.bandwidth);
+  }
+  else
+  {
+    ESP_LOGW(TAG, "%s skipped: buffers not allocated", name);
+  }
+  heap_caps_free(src);
+  heap_caps_free(dst);
+  copies.push_back(result);
+}
+
+void runSelfTest(vector<BenchmarkResult> & stages, vector<BandwidthResult> & copies, unsigned int iterations)
+{
+  stages.clear();
+  copies.clear();
+  if(iterations == 0)
+    iterations = 1;
+
+  // Always the same scene, so the boards can be compared
+  Mat gray(SELFTEST_HEIGHT, SELFTEST_WIDTH, CV_8UC1);
+  renderScene(gray, SELFTEST_CLUTTER, SELFTEST_WIDTH + SELFTEST_CLUTTER);
+  benchmarkScene(stages, NULL, iterations, gray, "VGA/clutter:" + to_string(SELFTEST_CLUTTER));
+  gray.release();
+
+  measureCopy(copies, "internal->internal", MALLOC_CAP_INTERNAL, SELFTEST_INTERNAL_BUFFER, MALLOC_CAP_INTERNAL, SELFTEST_INTERNAL_BUFFER);
+  measureCopy(copies, "internal->psram", MALLOC_CAP_INTERNAL, SELFTEST_INTERNAL_BUFFER, MALLOC_CAP_SPIRAM, SELFTEST_PSRAM_BUFFER);
+  measureCopy(copies, "psram->internal", MALLOC_CAP_SPIRAM, SELFTEST_PSRAM_BUFFER, MALLOC_CAP_INTERNAL, SELFTEST_INTERNAL_BUFFER);
+  measureCopy(copies, "psram->psram", MALLOC_CAP_SPIRAM, SELFTEST_PSRAM_BUFFER, MALLOC_CAP_SPIRAM, SELFTEST_PSRAM_BUFFER);
+}
+
+bool saveSelfTest(const vector<BenchmarkResult> & stages, const vector<BandwidthResult> & copies, const string & path)
+{
+  FILE * fp = fopen(path.c_str(), "w");
+  if(fp == NULL)
+  {
+    ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+    return false;
+  }
+
+  // The settings that make the boards differ: PSRAM clock and cache workaround, flash mode
+  writeContext(fp);
+#ifdef ESP_PLATFORM
+  uint8_t mac[6] = {0};
+  esp_efuse_mac_get_default(mac);
+  fprintf(fp, "    \"mac\": \"%02x:%02x:%02x:%02x:%02x:%02x\",\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  fprintf(fp, "    \"psram_bytes\": %u,\n", (unsigned int)esp_psram_get_size());
+#endif
+#ifdef CONFIG_SPIRAM_SPEED
+  fprintf(fp, "    \"psram_mhz\": %d,\n", CONFIG_SPIRAM_SPEED);
+#endif
+#ifdef CONFIG_SPIRAM_CACHE_WORKAROUND
+  fprintf(fp, "    \"psram_cache_workaround\": true,\n");
+#else
+  fprintf(fp, "    \"psram_cache_workaround\": false,\n");
+#endif
+#ifdef CONFIG_ESPTOOLPY_FLASHMODE
+  fprintf(fp, "    \"flash_mode\": \"%s\",\n", CONFIG_ESPTOOLPY_FLASHMODE);
+#endif
+#ifdef CONFIG_ESPTOOLPY_FLASHFREQ
+  fprintf(fp, "    \"flash_freq\": \"%s\",\n", CONFIG_ESPTOOLPY_FLASHFREQ);
+#endif
+  fprintf(fp, "    \"iterations\": %u\n  },\n  \"stages\": [\n", stages.empty() ? 0 : stages[0].iterations);
+  for(unsigned int i = 0; i < stages.size(); i++)
+  {
+    const BenchmarkResult & r = stages[i];
+    fprintf(fp, "    {\"name\": \"%s\", \"min\": %.0f, \"median\": %.0f, \"max\": %.0f, \"time_unit\": \"us\"}%s\n",
+            r.name.c_str(), r.minTime, r.medianTime, r.maxTime, i + 1 < stages.size() ? "," : "");
+  }
+  fprintf(fp, "  ],\n  \"copies\": [\n");
+  for(unsigned int i = 0; i < copies.size(); i++)
+  {
+    const BandwidthResult & c = copies[i];
+    fprintf(fp, "    {\"name\": \"%s\", \"bytes\": %u, \"mb_per_s\": %.1f}%s\n", c.name.c_str(), (unsigned int)c.bytes,
+            c.bandwidth, i + 1 < copies.size() ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+
+  bool ok = ferror(fp) == 0;
+  fclose(fp);
+  if(ok)
+    ESP_LOGI(TAG, "Self-test saved as %s", path.c_str());
+  return ok;
+}
@@ -12,6 +12,8 @@
 
 #include <bitmapUtils.h>
 #include <esp_jpg_decode.h>
+#include <pixel_convert.h>
+#include <stdlib.h>
 #include <string.h>
 
 //============================================ IMPORTANT ===========================================
@@ -102,7 +104,7 @@ typedef struct {
 
 /*------------------------------------------------------------------------------------------------*/
 // static function used to read the JPG image.
-static unsigned int _jpg_read(void * arg, size_t index, uint8_t *buf, size_t len)
+static size_t _jpg_read(void * arg, size_t index, uint8_t *buf, size_t len)
 {
 	// create a pointer to the decoder struct 
 	rgb_jpg_decoder * jpeg = (rgb_jpg_decoder *)arg;
@@ -114,6 +116,47 @@ static unsigned int _jpg_read(void * arg, size_t index, uint8_t *buf, size_t len
 	return len;
 }
 
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief struct used to decode the JPG image straight into a caller-owned grayscale buffer.
+ */
+typedef struct {
+	uint16_t width; // expected output width
+	uint16_t height; // expected output height
+	size_t stride; // bytes between two rows of the output
+	uint8_t *output; // output data (first pixel of the first row)
+} gray_jpg_decoder;
+
+/*------------------------------------------------------------------------------------------------*/
+// static function used to write the luma rectangles of the image.
+// The two decoding cores call it concurrently, but always for different rectangles.
+static bool _gray_write(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
+{
+	// create a pointer to the decoder struct
+	gray_jpg_decoder * jpeg = (gray_jpg_decoder *)arg;
+	// if data is null, this is the start or end of the image
+	if(!data)
+	{
+		// at the start the decoded size must match the buffer given by the caller
+		if(x == 0 && y == 0 && (w != jpeg->width || h != jpeg->height))
+		{
+			ESP_LOGE(TAG, "JPG is %ux%u but the output is %ux%u", w, h, jpeg->width, jpeg->height);
+			return false;
+		}
+		return true;
+	}
+
+	// copy the rectangle row by row (data is packed, the output may have padding)
+	uint8_t *o = jpeg->output + y * jpeg->stride + x;
+	for(uint16_t iy = 0; iy < h; iy++)
+	{
+		memcpy(o, data, w);
+		o += jpeg->stride;
+		data += w;
+	}
+	return true;
+}
+
 /*------------------------------------------------------------------------------------------------*/
 // static function used to write the RGB image.
 static bool _rgb_write(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
@@ -155,20 +198,14 @@ static bool _rgb_write(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16_t
 	// create a pointer to the output image
 	uint8_t *out = jpeg->output+jpeg->data_offset;
 	uint8_t *o = out;
-	size_t iy, ix;
-	w = w * 3;
+	size_t iy;
 
-	// loop through the image and copy the data to the output image
+	// loop through the rows and copy them to the output image as BGR
 	for(iy=t; iy<b; iy+=jw) 
 	{
 		o = out+iy+l;
-		for(ix=0; ix<w; ix+= 3) 
-		{
-			o[ix] = data[ix+2];
-			o[ix+1] = data[ix+1];
-			o[ix+2] = data[ix];
-		}
-		data+=w;
+		pixconv_swap_rb(data, o, w);
+		data+=w*3;
 	}
 	return true;
 }
@@ -214,24 +251,14 @@ static bool _rgb565_write(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16
 	// create a pointer to the output image
 	uint8_t *out = jpeg->output+jpeg->data_offset;
 	uint8_t *o = out;
-	size_t iy, iy2, ix, ix2;
-
-	w = w * 3;
+	size_t iy, iy2;
 
-	// loop through the image and copy the data to the output image
+	// loop through the rows and pack them to the output image as little-endian RGB565
 	for(iy=t, iy2=t2; iy<b; iy+=jw, iy2+=jw2) 
 	{
 		o = out+iy2+l;
-		for(ix2=ix=0; ix<w; ix+= 3, ix2 +=2) 
-		{
-			uint16_t r = data[ix];
-			uint16_t g = data[ix+1];
-			uint16_t b = data[ix+2];
-			uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-			o[ix2+1] = c>>8;
-			o[ix2] = c&0xff;
-		}
-		data+=w;
+		pixconv_rgb888_to_rgb565le(data, o, w);
+		data+=w*3;
 	}
 	return true;
 }
@@ -292,6 +319,26 @@ bool jpg2rgb_888(const uint8_t *src, size_t src_len, uint8_t ** out, size_t * ou
 
 /*------------------------------------------------------------------------------------------------*/
 
+bool jpg2gray(const uint8_t *src, size_t src_len, uint8_t * out, size_t out_stride, uint16_t out_width, uint16_t out_height, jpg_scale_t scale)
+{
+	// create a struct to decode the JPG image and set the values
+	gray_jpg_decoder jpeg;
+	jpeg.width = out_width;
+	jpeg.height = out_height;
+	jpeg.stride = out_stride;
+	jpeg.output = out;
+
+	// decode only the luma of the JPG image (on both cores if it has restart markers)
+	// and return false if it fails
+	if(esp_jpg_decode_split(src, src_len, scale, true, _gray_write, (void*)&jpeg) != ESP_OK)
+	{
+		return false;
+	}
+	return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 bool jpg2bmp(const uint8_t *src, size_t src_len, uint8_t ** out, size_t * out_len)
 {
 	// create a struct to decode the JPG image and set the values
@@ -418,28 +465,17 @@ bool frm2bmp(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixf
 	// if the format is RGB565, convert the data to RGB888 and copy it to the pixel buffer
 	else if(format == PIXFORMAT_RGB565) 
 	{
-		int i;
-		uint8_t hb, lb;
-		for(i=0; i<pix_count; i++) 
-		{
-			hb = *src_buf++;
-			lb = *src_buf++;
-			*pix_buf++ = (lb & 0x1F) << 3;
-			*pix_buf++ = (hb & 0x07) << 5 | (lb & 0xE0) >> 3;
-			*pix_buf++ = hb & 0xF8;
-		}
+		pixconv_rgb565_to_bgr888(src_buf, pix_buf, pix_count);
 	}
 	// if the format is GRAYSCALE, copy the data to the pixel buffer
 	else if(format == PIXFORMAT_GRAYSCALE) 
 	{
 		memcpy(pix_buf, src_buf, pix_count);
 	} 
-	// YUV422 is not supported yet so if the format is YUV422, return false
+	// if the format is YUV422, convert the data to BGR888 and copy it to the pixel buffer
 	else if(format == PIXFORMAT_YUV422) 
 	{
-		ESP_LOGE(TAG, "YUV422 not supported yet!");
-		free(out_buf);
-		return false;
+		pixconv_yuyv_to_bgr888(src_buf, pix_buf, pix_count);
 	}
 	// no other formats are supported so return false
 	else 
@@ -0,0 +1,97 @@
+/**
+ * @file corpusReader.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the reader of the frame corpus (Linux only, it is not part of the
+ *         firmware).
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <corpusReader.hpp>
+#include <esp_log.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "corpusReader";
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool CorpusReader::open(const string & path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  struct stat info;
+  if(fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CorpusFileHeader))
+  {
+    ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+    if(fd >= 0)
+      ::close(fd);
+    return false;
+  }
+
+  length = info.st_size;
+  void * mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(mapping == MAP_FAILED)
+  {
+    ESP_LOGE(TAG, "Failed to map %s", path.c_str());
+    length = 0;
+    return false;
+  }
+  base = (uint8_t *)mapping;
+  madvise(base, length, MADV_SEQUENTIAL);
+
+  const CorpusFileHeader * fileHeader = (const CorpusFileHeader *)base;
+  if(memcmp(fileHeader->magic, CORPUS_MAGIC, 8) != 0 || fileHeader->version != CORPUS_VERSION ||
+     fileHeader->headerSize != sizeof(CorpusFileHeader))
+  {
+    ESP_LOGE(TAG, "%s is not a frame corpus", path.c_str());
+    close();
+    return false;
+  }
+
+  // Index of the frames, up to the first one that does not follow or is not complete
+  size_t offset = fileHeader->headerSize;
+  const CorpusFrameHeader * previous = NULL;
+  while(offset + sizeof(CorpusFrameHeader) <= length)
+  {
+    CorpusFrameHeader * header = (CorpusFrameHeader *)(base + offset);
+    if(!corpusRecordFollows(*fileHeader, previous, *header, offset, length))
+      break;
+    const CorpusFrameTrailer * trailer =
+        (const CorpusFrameTrailer *)(base + offset + header->recordSize - sizeof(CorpusFrameTrailer));
+    if(!corpusRecordComplete(*header, *trailer))
+      break;
+    records.push_back(header);
+    previous = header;
+    offset += header->recordSize;
+  }
+  if(offset < length)
+    ESP_LOGW(TAG, "%s: %u bytes after the last complete frame ignored", path.c_str(), (unsigned int)(length - offset));
+  return true;
+}
+
+void CorpusReader::close()
+{
+  if(base != NULL)
+    munmap(base, length);
+  base = NULL;
+  length = 0;
+  records.clear();
+}
+
+Mat CorpusReader::frame(size_t index) const
+{
+  const CorpusFrameHeader & h = header(index);
+  if(h.step == 0)
+    return Mat(1, (int)h.payloadSize, CV_8UC1, payload(index));
+  return Mat(h.height, h.width, h.cvType, payload(index), h.step);
+}
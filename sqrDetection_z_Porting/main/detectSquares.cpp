@@ -15,12 +15,140 @@
 #include <saveUtils.hpp>
 #include <esp_camera.h>
 #include <string.h>
+#include <type_traits>
 #include <esp_timer.h>
+#include <pixel_convert.h>
+#include <esp_jpg_decode.h>
+#include <edgeRuns.hpp>
+#include <squareVerifier.hpp>
+#include <markerDecoder.hpp>
+#include <autoCanny.hpp>
+#include <matAllocator.hpp>
+#include <frameArena.hpp>
+#include <flightRecorder.hpp>
 
 
 // tag used for ESP_LOGx functions
 static const char *TAG = "detectSquares";
 
+// JPEG quality (1..100) of each archived stage when ARCHIVE_JPEG is enabled: the edge images are
+// binary and ringing would hide them, the smooth filtered images compress well
+#ifndef ARCHIVE_QUALITY_INPUT
+#define ARCHIVE_QUALITY_INPUT 90
+#endif
+#ifndef ARCHIVE_QUALITY_MEDIAN
+#define ARCHIVE_QUALITY_MEDIAN 80
+#endif
+#ifndef ARCHIVE_QUALITY_BLUR
+#define ARCHIVE_QUALITY_BLUR 80
+#endif
+#ifndef ARCHIVE_QUALITY_CANNY
+#define ARCHIVE_QUALITY_CANNY 95
+#endif
+#ifndef ARCHIVE_QUALITY_MARK
+#define ARCHIVE_QUALITY_MARK 90
+#endif
+
+// Scale applied when decoding JPEG frames (JPG_SCALE_NONE, JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X)
+#ifndef JPEG_DECODE_SCALE
+#define JPEG_DECODE_SCALE JPG_SCALE_NONE
+#endif
+
+// Lowest squareness (side ratio * (1 - largest |cos| of the corners)) of a quadrilateral kept as a
+// square: the printed squares score above 0.78 even when seen at an angle, rectangles below 0.7
+#ifndef SQUARE_MIN_SCORE
+#define SQUARE_MIN_SCORE 0.7f
+#endif
+
+// Sub-pixel refinement of the corners of the squares: the Sobel derivatives computed for Canny are
+// kept (4 bytes per pixel) until the squares are found, then a window of REFINE_RADIUS pixels
+// around each corner is searched for the point where the edges meet
+#ifndef REFINE_CORNERS
+#define REFINE_CORNERS 1
+#endif
+#ifndef REFINE_RADIUS
+#define REFINE_RADIUS 5
+#endif
+
+// Decoding of binary markers (MARKERS_4X4_32) inside the squares: a copy of the blurred image is
+// kept until the squares are found
+#ifndef DECODE_MARKERS
+#define DECODE_MARKERS 0
+#endif
+
+// Front-end giving the regions whose borders are searched for squares. BINARIZE 0: Gaussian blur,
+// Canny and dilation of the median output. BINARIZE 1: the pixels of the median output darker than
+// the mean of the (2*BINARIZE_RADIUS+1)^2 pixels around them by more than BINARIZE_OFFSET, in a
+// single pass with no hysteresis (meant for high-contrast printed markers, the window must be
+// larger than a square)
+#ifndef BINARIZE
+#define BINARIZE 0
+#endif
+#ifndef BINARIZE_RADIUS
+#define BINARIZE_RADIUS 30
+#endif
+#ifndef BINARIZE_OFFSET
+#define BINARIZE_OFFSET 5
+#endif
+
+// Canny thresholds: CANNY_LOW and CANNY_HIGH, or with CANNY_AUTO chosen on every frame from the
+// histogram of the gradient magnitude, computed with the derivatives: the high threshold leaves
+// CANNY_HIGH_FRACTION of the pixels above it and the low one CANNY_LOW_FRACTION (30/80 on well
+// exposed pictures of the strips), never below CANNY_MIN_HIGH and CANNY_MIN_LOW. A frame with more
+// than CANNY_MAX_CONTOURS contours makes the next ones keep fewer edges, so the contour stage
+// takes about the same time whatever the lighting.
+#ifndef CANNY_LOW
+#define CANNY_LOW 30
+#endif
+#ifndef CANNY_HIGH
+#define CANNY_HIGH 80
+#endif
+#ifndef CANNY_AUTO
+#define CANNY_AUTO 1
+#endif
+#ifndef CANNY_HIGH_FRACTION
+#define CANNY_HIGH_FRACTION 0.03f
+#endif
+#ifndef CANNY_LOW_FRACTION
+#define CANNY_LOW_FRACTION 0.07f
+#endif
+#ifndef CANNY_MIN_HIGH
+#define CANNY_MIN_HIGH 24
+#endif
+#ifndef CANNY_MIN_LOW
+#define CANNY_MIN_LOW 10
+#endif
+#ifndef CANNY_MAX_CONTOURS
+#define CANNY_MAX_CONTOURS 200
+#endif
+
+// Default front-end of extractSquares: BINARIZE 0 the Canny pipelines, BINARIZE 1 the binarize
+// ones. The corner refinement and the automatic thresholds work on the Canny derivatives, so the
+// binarize pipelines never refine the corners.
+
+// Size of the frame arena holding the contours, the square list and a byte per edge run for the
+// contour search (66-81KB used on the sample strips with 100-300 contours before the marks moved
+// in): frames needing more spill to the heap and are counted
+#ifndef FRAME_ARENA_SIZE
+#define FRAME_ARENA_SIZE (128 * 1024)
+#endif
+
+// Temporaries of the detection, released all together at the start of every frame
+static FrameArena frameArena(FRAME_ARENA_SIZE);
+
+// Containers of the detection kept from frame to frame: they are cleared, not released, so once
+// they have grown to the largest frame the detection no longer allocates them
+static EdgeMap frameEdges;                 // Canny output, before the dilation
+static EdgeMap frameRegions;               // regions whose borders are searched for squares
+static QuadBatch frameQuads;               // quadrilaterals fitted to the contours
+static vector<unsigned int> frameAccepted; // the ones verified as squares
+static vector<uint32_t> frameHistogram;    // gradient magnitudes of the automatic thresholds
+static vector<Rect> patchRegions;          // JPEG: regions decoded around the squares
+static vector<Mat> colourPatches;          // and their pixels
+
+// Threshold settings and state, kept from frame to frame
+static AutoCanny autoCanny = {CANNY_HIGH_FRACTION, CANNY_LOW_FRACTION, CANNY_MIN_HIGH, CANNY_MIN_LOW, CANNY_MAX_CONTOURS};
+
 /*
 The camera_fb_t * fb is a pointer to a struct that contains the following fields:
 uint8_t * buf;        // Pointer to the pixel data
@@ -30,193 +158,488 @@ size_t height;        // Height of the buffer in pixels
 pixformat_t format;   // Format of the pixel data
 
 Considering that the ESP32-CAM has a OV2640 sensor, the used formats are:
-PIXFORMAT_JPEG, PIXFORMAT_GRAYSCALE, PIXFORMAT_RGB565
+PIXFORMAT_JPEG, PIXFORMAT_GRAYSCALE, PIXFORMAT_RGB565, PIXFORMAT_YUV422
+
+YUV422 gives both planes from a single exposure: the luma is the grayscale image used for the
+detection and the frame buffer is kept until the end, so the colour of the squares is read from it
+(converted only at the sampled points). JPEG frames are kept as well: once the squares are known,
+only the small patches around their centers are decoded in colour. The other formats return the
+frame buffer right away.
 
 So in order to create a Mat object from the frame buffer is necessary to know the format of the
-image. This is done by checking the pixformat_t format field of the camera_fb_t * fb struct.
+image. Every format has its own input stage below, and every pipeline of the registry is compiled
+for a single format: extractSquares picks the pipeline from the pixformat_t format field of the
+camera_fb_t * fb struct, so the other formats cost nothing in the detection itself.
 */
 
-void extractSquares(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, string resultFileTag, bool onlyCanny)
+// ============================================= STAGES ============================================
+
+// State of a frame, passed from stage to stage
+struct FrameState
 {
-  // log
-  ESP_LOGI(TAG, "Starting square detection...");
-  
-  // Create a Mat object
-  Mat img;
+  camera_fb_t * fb;
+  uint8_t picNumber;
+  Mat img;         // grayscale image, then edges, then marked output
+  Mat yuyv;        // YUYV view of the frame buffer, used for the colour of the squares (YUV422 only)
+  Mat dx, dy;      // Sobel derivatives, kept for the corner refinement
+  Mat blurred;     // image the markers are decoded from
+  EdgeMap & regions = frameRegions; // regions whose borders are searched for squares
+  bool offline;    // frame not from the camera: no stage is saved, the buffer is not given back
+  DetectionStage stage;             // stage running
+  int64_t stageStart;               // when it started
+  uint32_t stageTime[STAGE_COUNT];  // microseconds per stage
+};
+
+const char * const STAGE_NAMES[STAGE_COUNT] = {"input", "median", "edges", "contours", "squares", "colour"};
+
+// Start timing a stage: the time since the previous one started is added to it, and the buffers
+// allocated from now on are tagged with its name. STAGE_COUNT stops the timing (the tag is kept).
+static void enterStage(FrameState & frame, DetectionStage stage)
+{
+  int64_t now = esp_timer_get_time();
+  if(frame.stage < STAGE_COUNT)
+    frame.stageTime[frame.stage] += now - frame.stageStart;
+  frame.stage = stage;
+  frame.stageStart = now;
+  if(stage < STAGE_COUNT)
+    setPlacementTag(STAGE_NAMES[stage]);
+}
+
+// Save a stage of the frame ("<name><picNumber>" on the SD card)
+static void saveFrameStage(FrameState & frame, Mat & img, const char * name, uint8_t quality)
+{
+  if(!frame.offline)
+    saveStage(img, "/sdcard/", name + to_string(frame.picNumber), quality);
+}
 
-  // The first step is to convert the frame buffer in a Mat object and convert it to grayscale
-  // In order to do so it is necessary to know the format of the image
-
-  // JPEG format is available but is not useful for this project
-  if(fb->format == PIXFORMAT_JPEG){
-    ESP_LOGI(TAG, "Image format: JPEG");
-
-    // Convert to a rgb565 image using jpg2rgb888 function
-    uint8_t *rgb_image = NULL;
-    size_t rgb_image_len = 0;
-    size_t w = 0, h = 0;
-    if(!jpg2rgb_888(fb->buf, fb->len, &rgb_image, &rgb_image_len, &w, &h, JPG_SCALE_NONE)){
-      ESP_LOGE(TAG, "Conversion to rgb888 failed");
-      return;
-    }
-    esp_camera_fb_return(fb);
-    ESP_LOGI(TAG, "Image converted to rgb888");
-    ESP_LOGI(TAG, "Image width: %d", w);
-    ESP_LOGI(TAG, "Image height: %d", h);
-
-    // Create a Mat object from the rgb888 image
-    img.create(h, w, CV_8UC3);
-    memcpy(img.data, rgb_image, rgb_image_len);
-    free(rgb_image);
-    ESP_LOGI(TAG, "Mat created");
-    Mat2bmp(img, "/sdcard/", "mat" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "mat" + to_string(picNumber));
-
-    // Convert image to greyscale
-    cvtColor(img, img, COLOR_BGR2GRAY);
-    ESP_LOGI(TAG, "Image converted to greyscale");
-    Mat2bmp(img, "/sdcard/", "gray" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "gray" + to_string(picNumber));
-  }
-
-  // RGB565 is the default format for this project --> bmp header creation is available
-  else if(fb->format == PIXFORMAT_RGB565){
-    ESP_LOGI(TAG, "Image format: RGB565");
-
-    // Create a Mat object from the frame buffer
-    img.create(fb->height, fb->width, CV_8UC2);
-    img.data = fb->buf;
-    esp_camera_fb_return(fb);
-    ESP_LOGI(TAG, "Mat created");
-    Mat2bmp(img, "/sdcard/", "mat" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "mat" + to_string(picNumber)); 
+// Give the frame buffer back to the camera driver
+static void returnFrame(FrameState & frame)
+{
+  if(!frame.offline)
+    esp_camera_fb_return(frame.fb);
+}
 
-    // Convert image to greyscale
-    cvtColor(img, img, COLOR_BGR5652GRAY);
-    ESP_LOGI(TAG, "Image converted to greyscale");
-    Mat2bmp(img, "/sdcard/", "gray" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "gray" + to_string(picNumber));
-  }
+/*------------------------------------------------------------------------------------------------*/
+// Input stages: the frame buffer is turned into the grayscale img. keepsFrame is true when the
+// frame buffer is needed for the colour of the squares (YUV422 and JPEG), otherwise it is given
+// back here. On failure the frame buffer is given back and false is returned.
 
-  // GRAYSCALE format doesn't need conversion to greyscale 
-  else if(fb->format == PIXFORMAT_GRAYSCALE){
-    ESP_LOGI(TAG, "Image format: GRAYSCALE");
+// JPEG is the fastest sensor mode: only the luma is decoded, directly into the grayscale Mat
+struct JpegInput
+{
+  static constexpr pixformat_t format = PIXFORMAT_JPEG;
+  static constexpr bool keepsFrame = true;
+  static bool toGray(FrameState & frame);
+};
 
-    // Create a Mat object from the frame buffer
-    img.create(fb->height, fb->width, CV_8UC1);
-    img.data = fb->buf;
-    esp_camera_fb_return(fb);
-    ESP_LOGI(TAG, "Mat created");
-    Mat2bmp(img, "/sdcard/", "mat" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "mat" + to_string(picNumber));
-  }
+// RGB565 is the default format for this project --> bmp header creation is available
+struct Rgb565Input
+{
+  static constexpr pixformat_t format = PIXFORMAT_RGB565;
+  static constexpr bool keepsFrame = false;
+  static bool toGray(FrameState & frame);
+};
 
-  // RGB888 bmp header cration is not complete (OV2640 does not support this format)
-  else if(fb->format == PIXFORMAT_RGB888){
-    ESP_LOGI(TAG, "Image format: RGB888");
+// YUV422: the luma is extracted to the grayscale Mat, the frame is kept for the colours
+struct Yuv422Input
+{
+  static constexpr pixformat_t format = PIXFORMAT_YUV422;
+  static constexpr bool keepsFrame = true;
+  static bool toGray(FrameState & frame);
+};
 
-    // Create a Mat object from the frame buffer
-    img.create(fb->height, fb->width, CV_8UC3);
-    img.data = fb->buf;
-    esp_camera_fb_return(fb);
-    ESP_LOGI(TAG, "Mat created");
-    Mat2bmp(img, "/sdcard/", "mat" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "mat" + to_string(picNumber)); 
+// GRAYSCALE format doesn't need conversion to greyscale
+struct GrayInput
+{
+  static constexpr pixformat_t format = PIXFORMAT_GRAYSCALE;
+  static constexpr bool keepsFrame = false;
+  static bool toGray(FrameState & frame);
+};
 
-    // Convert image to greyscale
-    cvtColor(img, img, COLOR_BGR2GRAY);
-    ESP_LOGI(TAG, "Image converted to greyscale");
-    Mat2bmp(img, "/sdcard/", "gray" + to_string(picNumber));
-    saveRawMat(img, "/sdcard/", "gray" + to_string(picNumber));
-  }
+// RGB888 bmp header cration is not complete (OV2640 does not support this format)
+struct Rgb888Input
+{
+  static constexpr pixformat_t format = PIXFORMAT_RGB888;
+  static constexpr bool keepsFrame = false;
+  static bool toGray(FrameState & frame);
+};
 
-  else{
-    ESP_LOGE(TAG, "Image format: UNKNOWN");
-    esp_camera_fb_return(fb);
-    return;
+bool JpegInput::toGray(FrameState & frame)
+{
+  camera_fb_t * fb = frame.fb;
+  Mat & img = frame.img;
+  ESP_LOGI(TAG, "Image format: JPEG");
+
+  // Create the grayscale Mat with the decoded size and let the decoder fill its rows
+  img.create(fb->height >> JPEG_DECODE_SCALE, fb->width >> JPEG_DECODE_SCALE, CV_8UC1);
+  if(!jpg2gray(fb->buf, fb->len, img.data, img.step, img.cols, img.rows, JPEG_DECODE_SCALE)){
+    ESP_LOGE(TAG, "Conversion to greyscale failed");
+    returnFrame(frame);
+    return false;
   }
+  ESP_LOGI(TAG, "Image decoded to greyscale");
+  ESP_LOGI(TAG, "Image width: %d", img.cols);
+  ESP_LOGI(TAG, "Image height: %d", img.rows);
+  saveFrameStage(frame, img, "gray", ARCHIVE_QUALITY_INPUT);
+  return true;
+}
+
+bool Rgb565Input::toGray(FrameState & frame)
+{
+  camera_fb_t * fb = frame.fb;
+  Mat & img = frame.img;
+  ESP_LOGI(TAG, "Image format: RGB565");
+
+  // Create a Mat object from the frame buffer
+  img.create(fb->height, fb->width, CV_8UC2);
+  img.data = fb->buf;
+  returnFrame(frame);
+  ESP_LOGI(TAG, "Mat created");
+  saveFrameStage(frame, img, "mat", ARCHIVE_QUALITY_INPUT);
+
+  // Convert image to greyscale
+  cvtColor(img, img, COLOR_BGR5652GRAY);
+  ESP_LOGI(TAG, "Image converted to greyscale");
+  saveFrameStage(frame, img, "gray", ARCHIVE_QUALITY_INPUT);
+  return true;
+}
+
+bool Yuv422Input::toGray(FrameState & frame)
+{
+  camera_fb_t * fb = frame.fb;
+  Mat & img = frame.img;
+  ESP_LOGI(TAG, "Image format: YUV422");
+
+  // Create the grayscale Mat and fill it with the Y bytes of the frame
+  img.create(fb->height, fb->width, CV_8UC1);
+  pixconv_yuyv_to_gray(fb->buf, img.data, fb->width * fb->height);
+  frame.yuyv = Mat(fb->height, fb->width, CV_8UC2, fb->buf);
+  ESP_LOGI(TAG, "Luma extracted");
+  saveFrameStage(frame, img, "gray", ARCHIVE_QUALITY_INPUT);
+  return true;
+}
+
+bool GrayInput::toGray(FrameState & frame)
+{
+  camera_fb_t * fb = frame.fb;
+  Mat & img = frame.img;
+  ESP_LOGI(TAG, "Image format: GRAYSCALE");
+
+  // Create a Mat object from the frame buffer
+  img.create(fb->height, fb->width, CV_8UC1);
+  img.data = fb->buf;
+  returnFrame(frame);
+  ESP_LOGI(TAG, "Mat created");
+  saveFrameStage(frame, img, "mat", ARCHIVE_QUALITY_INPUT);
+  return true;
+}
+
+bool Rgb888Input::toGray(FrameState & frame)
+{
+  camera_fb_t * fb = frame.fb;
+  Mat & img = frame.img;
+  ESP_LOGI(TAG, "Image format: RGB888");
+
+  // Create a Mat object from the frame buffer
+  img.create(fb->height, fb->width, CV_8UC3);
+  img.data = fb->buf;
+  returnFrame(frame);
+  ESP_LOGI(TAG, "Mat created");
+  saveFrameStage(frame, img, "mat", ARCHIVE_QUALITY_INPUT);
+
+  // Convert image to greyscale
+  cvtColor(img, img, COLOR_BGR2GRAY);
+  ESP_LOGI(TAG, "Image converted to greyscale");
+  saveFrameStage(frame, img, "gray", ARCHIVE_QUALITY_INPUT);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// Pre-processing stage: median blur to remove noise, with the kernel size fixed at compile time
+
+template<int KSIZE>
+struct MedianPreproc
+{
+  static void apply(FrameState & frame);
+};
 
-  // Apply median blur to remove noise
-  medianBlur(img, img, 3);
+template<int KSIZE>
+void MedianPreproc<KSIZE>::apply(FrameState & frame)
+{
+  medianBlur(frame.img, frame.img, KSIZE);
   ESP_LOGI(TAG, "Median blur applied");
   // Save median output
-  Mat2bmp(img, "/sdcard/", "med" + to_string(picNumber));
-  saveRawMat(img, "/sdcard/", "med" + to_string(picNumber));
+  saveFrameStage(frame, frame.img, "med", ARCHIVE_QUALITY_MEDIAN);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// Edge stages: the regions whose borders are searched for squares are found in img, which is left
+// with the decoded regions for the saved stages and the marked output. derivatives is true when
+// the Sobel derivatives are kept in dx and dy. track gets the number of contours of the frame.
+
+// Gaussian blur, Canny and dilation. AUTO chooses the thresholds on every frame (CANNY_AUTO),
+// KEEP_DERIVATIVES keeps the derivatives computed for Canny (the automatic thresholds compute them
+// anyway, they are released right away if they are not kept)
+template<bool AUTO, bool KEEP_DERIVATIVES>
+struct CannyEdges
+{
+  static constexpr bool derivatives = KEEP_DERIVATIVES;
+  static void detect(FrameState & frame, bool keepBlurred);
+  static void track(unsigned int contours);
+};
+
+template<bool AUTO, bool KEEP_DERIVATIVES>
+void CannyEdges<AUTO, KEEP_DERIVATIVES>::detect(FrameState & frame, bool keepBlurred)
+{
+  Mat & img = frame.img;
 
   // Blur image for better edge detection --> was(3,3)
   GaussianBlur(img, img, Size(3,3), 0);
   ESP_LOGI(TAG, "Image blurred");
   // Save blur output
-  Mat2bmp(img, "/sdcard/", "blur" + to_string(picNumber));
-  saveRawMat(img, "/sdcard/", "blur" + to_string(picNumber));
+  saveFrameStage(frame, img, "blur", ARCHIVE_QUALITY_BLUR);
+
+  // The blurred image is kept for the marker decoding
+  if(keepBlurred)
+    frame.blurred = img.clone();
 
   // Apply canny edge detection --> was 30,60,3,false
-  Canny(img, img, 30, 80, 3);
+  if constexpr(AUTO)
+  {
+    // The derivatives are computed here, as Canny does with aperture 3, together with the
+    // histogram the thresholds are taken from
+    sobelHistogram(img, frame.dx, frame.dy, frameHistogram);
+    autoCannyThresholds(autoCanny, frameHistogram);
+    ESP_LOGI(TAG, "Canny thresholds %d/%d (scale %.2f)", autoCanny.low, autoCanny.high, autoCanny.scale);
+    Canny(frame.dx, frame.dy, img, autoCanny.low, autoCanny.high);
+    if constexpr(!KEEP_DERIVATIVES)
+    {
+      frame.dx.release();
+      frame.dy.release();
+    }
+  }
+  else if constexpr(KEEP_DERIVATIVES)
+  {
+    // The derivatives are computed here, as Canny does with aperture 3, so they are kept afterwards
+    Sobel(img, frame.dx, CV_16S, 1, 0, 3, 1, 0, BORDER_REPLICATE);
+    Sobel(img, frame.dy, CV_16S, 0, 1, 3, 1, 0, BORDER_REPLICATE);
+    Canny(frame.dx, frame.dy, img, CANNY_LOW, CANNY_HIGH);
+  }
+  else
+  {
+    Canny(img, img, CANNY_LOW, CANNY_HIGH, 3);
+  }
   ESP_LOGI(TAG, "Canny edge detection applied");
+
+  // The edges are kept as runs: the following steps only cost in proportion to the edges
+  encodeEdges(img, frameEdges);
   // Dilate canny output to remove potential holes between edge segments
-  dilate(img, img, Mat(), Point(-1,-1));
-  ESP_LOGI(TAG, "Canny dilated");
+  dilateEdges(frameEdges, frame.regions);
+  ESP_LOGI(TAG, "Canny dilated (%u edge runs)", (unsigned int)frame.regions.runs.size());
+  // The image is only needed for the saved stages and the marked output
+  decodeEdges(frame.regions, img);
   // Save canny output
-  Mat2bmp(img, "/sdcard/", "canny" + to_string(picNumber));
-  saveRawMat(img, "/sdcard/", "canny" + to_string(picNumber));
+  saveFrameStage(frame, img, "canny", ARCHIVE_QUALITY_CANNY);
+}
 
-  // Check if only canny is used
-  if(onlyCanny){
-    return;
+template<bool AUTO, bool KEEP_DERIVATIVES>
+void CannyEdges<AUTO, KEEP_DERIVATIVES>::track(unsigned int contours)
+{
+  if constexpr(AUTO)
+    autoCannyTrack(autoCanny, contours);
+}
+
+// Local-mean binarization of the median output (see binarize)
+template<int RADIUS, int OFFSET>
+struct BinarizeEdges
+{
+  static constexpr bool derivatives = false;
+  static void detect(FrameState & frame, bool keepBlurred);
+  static void track(unsigned int) {}
+};
+
+template<int RADIUS, int OFFSET>
+void BinarizeEdges<RADIUS, OFFSET>::detect(FrameState & frame, bool keepBlurred)
+{
+  // The median output is kept for the marker decoding
+  if(keepBlurred)
+    frame.blurred = frame.img.clone();
+
+  // The dark regions are found as runs, their borders are the contours searched for squares
+  binarize(frame.img, frame.regions, RADIUS, OFFSET);
+  ESP_LOGI(TAG, "Image binarized (%u runs)", (unsigned int)frame.regions.runs.size());
+  // The image is only needed for the saved stages and the marked output
+  decodeEdges(frame.regions, frame.img);
+  // Save binarized output
+  saveFrameStage(frame, frame.img, "bin", ARCHIVE_QUALITY_CANNY);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// Classifier stage: the verified squares get their corners refined on the derivatives of the edge
+// stage (REFINE) and their binary markers decoded from the blurred image (MARKERS)
+
+template<bool REFINE, bool MARKERS>
+struct SquareClassifier
+{
+  static constexpr bool refine = REFINE;
+  static constexpr bool markers = MARKERS;
+  static void identify(const FrameState & frame, Square & square);
+};
+
+template<bool REFINE, bool MARKERS>
+void SquareClassifier<REFINE, MARKERS>::identify(const FrameState & frame, Square & square)
+{
+  // id stays -1 if no marker is found
+  if constexpr(MARKERS)
+    decodeMarker(frame.blurred, square.corners, MARKERS_4X4_32, square.id, square.rotation);
+}
+
+// ============================================= PIPELINE ==========================================
+
+template<class Input, class Preproc, class Edges, class Classifier>
+struct Pipeline
+{
+  static_assert(!Classifier::refine || Edges::derivatives, "the corner refinement needs the derivatives of the edge stage");
+
+  static void run(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, string resultFileTag, bool onlyCanny);
+  static bool detect(camera_fb_t * fb, vector<Square> & squares);
+
+private:
+  static bool process(FrameState & frame, pmr::vector<Square> & sqrList, bool onlyCanny);
+};
+
+// Detection on a frame, up to the list of squares (in the frame arena). Returns false if the frame
+// could not be read or only the edges were wanted.
+template<class Input, class Preproc, class Edges, class Classifier>
+bool Pipeline<Input, Preproc, Edges, Classifier>::process(FrameState & frame, pmr::vector<Square> & sqrList, bool onlyCanny)
+{
+  // log
+  ESP_LOGI(TAG, "Starting square detection...");
+  // The buffers of the frame are counted per stage, from the bytes still in use
+  resetPlacementPeaks();
+  frame.stage = STAGE_COUNT;
+  memset(frame.stageTime, 0, sizeof(frame.stageTime));
+  enterStage(frame, STAGE_INPUT);
+
+  camera_fb_t * fb = frame.fb;
+  Mat & img = frame.img;
+
+  // The first step is to convert the frame buffer in a Mat object and convert it to grayscale
+  if(!Input::toGray(frame)){
+    enterStage(frame, STAGE_COUNT);
+    setPlacementTag(NULL);
+    return false;
   }
 
-  // Allocate memory for contours
-  vector<vector<Point>>* contours = new vector<vector<Point>>();
+  // The grayscale frame goes to the flight recorder (out of the timings), its result follows in run
+  if(!frame.offline && flightRecorderRunning()){
+    enterStage(frame, STAGE_COUNT);
+    flightRecordFrame(img, frame.picNumber);
+  }
 
-  // Find image contours using dedicated function
-  findContours(img, *contours, RETR_TREE, CHAIN_APPROX_SIMPLE);
-  ESP_LOGI(TAG, "Find contours done");
+  enterStage(frame, STAGE_MEDIAN);
+  Preproc::apply(frame);
 
-  // Convert the image back to rgb in order to draw the contours in red
-  cvtColor(img, img, COLOR_GRAY2BGR);
+  enterStage(frame, STAGE_EDGES);
+  Edges::detect(frame, Classifier::markers);
 
-  // Allocate memory for sqrList
-  vector<Square>* sqrList = new vector<Square>();
+  // Check if only canny is used
+  if(onlyCanny){
+    if(Input::keepsFrame)
+      returnFrame(frame);
+    enterStage(frame, STAGE_COUNT);
+    setPlacementTag(NULL);
+    return false;
+  }
 
-  // Loop through all the contours and get the approximate polygonal curves for each contour
-  for (unsigned int i = 0; i < contours->size(); i++)
-  {
-    // Vector approx will contain the vertices of the polygonal approximation for the contour
-    vector<Point> approx;
+  // Contours in the frame arena
+  enterStage(frame, STAGE_CONTOURS);
+  ContourList contours(&frameArena);
 
-    // Approximate contour with accuracy proportional to the contour perimeter --> was 0.02
-    approxPolyDP(Mat((*contours)[i]), approx, 0.02 * arcLength((*contours)[i], true), true);
+  // Find image contours on the edge runs (same contours as findContours with RETR_TREE)
+  findEdgeContours(frame.regions, contours);
+  Edges::track(contours.size());
+  ESP_LOGI(TAG, "Find contours done (%u contours)", (unsigned int)contours.size());
 
-    // Skip small or non-convex objects
-    if (fabs(contourArea((*contours)[i])) < 1700 || !isContourConvex(approx) ||
-      fabs(contourArea((*contours)[i])) > 17000)
+  // Loop through all the contours and fit a quadrilateral to each one (integer, no allocation)
+  QuadBatch & batch = frameQuads;
+  clearQuads(batch);
+  for (unsigned int i = 0; i < contours.size(); i++)
+  {
+    QuadFit quad;
+
+    // Skip small, big, non-convex and non-quadrilateral contours (tolerance 2% of the perimeter)
+    if (!fitQuad(contours[i], quad, 1700, 17000))
     {
       continue;
     }
-    
-    // Possible square
-    if (approx.size() == 4)
-    {      
-      // Draw square contours
-      polylines(img, approx, true, Scalar(0,0,255), 1);
-
-      // Get square from approximated contour
-      sqrList->push_back(getSquare(approx, img, true));
-    }
+
+    // The candidates are collected and scored together
+    addQuad(batch, quad.corners);
   } 
-  // Free memory
-  delete contours;
+
+  // Keep only the quadrilaterals that look like squares
+  vector<unsigned int> & accepted = frameAccepted;
+  scoreQuads(batch);
+  verifyQuads(batch, SQUARE_MIN_SCORE, accepted);
+  ESP_LOGI(TAG, "%u of %u quadrilaterals verified", (unsigned int)accepted.size(), (unsigned int)batch.size());
+
+  if constexpr(Classifier::refine)
+  {
+    // Sub-pixel corners of the squares only
+    unsigned int refined = refineQuads(batch, accepted, frame.dx, frame.dy, REFINE_RADIUS);
+    ESP_LOGI(TAG, "%u of %u corners refined", refined, (unsigned int)accepted.size() * 4);
+  }
+  // The derivatives are not needed anymore
+  frame.dx.release();
+  frame.dy.release();
+
+  // Convert the image back to rgb in order to draw the contours in red
+  enterStage(frame, STAGE_SQUARES);
+  cvtColor(img, img, COLOR_GRAY2BGR);
+
+  // Draw the rejected quadrilaterals in blue and the squares in red
+  for(unsigned int i=0, k=0; i<batch.size(); i++)
+  {
+    bool square = k < accepted.size() && accepted[k] == i;
+    Point corners[4];
+    for(int c=0; c<4; c++)
+      corners[c] = Point(cvRound(batch.x[c][i]), cvRound(batch.y[c][i]));
+    const Point * polygon = corners;
+    int count = 4;
+    polylines(img, &polygon, &count, 1, true, square ? Scalar(0,0,255) : Scalar(255,0,0), 1);
+    k += square;
+  }
+
+  // Get the squares: center from the centroid, colour from the YUYV frame when available
+  sqrList.reserve(accepted.size());
+  for(unsigned int k=0; k<accepted.size(); k++)
+  {
+    unsigned int i = accepted[k];
+    Square square;
+    for(int c=0; c<4; c++)
+      square.corners[c] = Point2f(batch.x[c][i], batch.y[c][i]);
+    square.subCenter = Point2f(batch.cx[i], batch.cy[i]);
+    square.center = Point(cvRound(square.subCenter.x), cvRound(square.subCenter.y));
+    if constexpr(Input::format == PIXFORMAT_YUV422)
+      getColourYUYV(frame.yuyv, square, true);
+    else
+      getColour(img, square, true);
+    Classifier::identify(frame, square);
+    sqrList.push_back(square);
+  }
+  frame.blurred.release();
 
 
   // Check if some squares are overlapped
-  for(unsigned int i=0; i<sqrList->size(); i++)
+  for(unsigned int i=0; i<sqrList.size(); i++)
   {
-    for(unsigned int j=i+1; j<sqrList->size(); j++)
+    for(unsigned int j=i+1; j<sqrList.size(); j++)
     {
       // If two squares are in the same spot, one is deleted
-      if(areOverlapping((*sqrList)[i],(*sqrList)[j],10))
+      if(areOverlapping(sqrList[i],sqrList[j],10))
       {
-        sqrList->erase(sqrList->begin()+j);
+        sqrList.erase(sqrList.begin()+j);
         j--;
       }
     }
@@ -226,29 +649,214 @@ void extractSquares(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, st
   //vector<Square> missedSquares;
   //findMissingSquares(sqrList, missedSquares, expectedSquares, 10, 100);
 
+  // JPEG: the colours are read from patches of the picture decoded only around the squares
+  if constexpr(Input::format == PIXFORMAT_JPEG){
+    if(!sqrList.empty()){
+      enterStage(frame, STAGE_COLOUR);
+      patchRegions.clear();
+      for(unsigned int i=0; i<sqrList.size(); i++)
+      {
+        patchRegions.push_back(Rect(sqrList[i].center.x - 2, sqrList[i].center.y - 2, 5, 5));
+      }
+      if(jpg2patches(fb->buf, fb->len, patchRegions, colourPatches, true, JPEG_DECODE_SCALE)){
+        for(unsigned int i=0; i<sqrList.size(); i++)
+        {
+          Point center(2, 2);
+          getColour(colourPatches[i], center, sqrList[i].colour, true);
+        }
+      }
+      else{
+        ESP_LOGW(TAG, "Colour patches not decoded");
+      }
+    }
+  }
+
+  // The colours have been read, so the YUV422 or JPEG frame buffer can be given back
+  if(Input::keepsFrame){
+    frame.yuyv.release();
+    returnFrame(frame);
+  }
+  enterStage(frame, STAGE_COUNT);
+  return true;
+}
+
+template<class Input, class Preproc, class Edges, class Classifier>
+void Pipeline<Input, Preproc, Edges, Classifier>::run(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, string resultFileTag, bool onlyCanny)
+{
+  // The containers of the previous frame are gone, so its temporaries are released in one go
+  frameArena.reset();
+
+  FrameState frame;
+  frame.fb = fb;
+  frame.picNumber = picNumber;
+  frame.offline = false;
+  Mat & img = frame.img;
+
+  pmr::vector<Square> sqrList(&frameArena);
+  if(!process(frame, sqrList, onlyCanny))
+    return;
+
+  string timings;
+  for(int s = 0; s < STAGE_COUNT; s++)
+    timings += string(s ? ", " : "") + STAGE_NAMES[s] + " " + to_string(frame.stageTime[s]);
+  ESP_LOGI(TAG, "Stage times (us): %s", timings.c_str());
+  flightRecordResult(sqrList.data(), sqrList.size(), expectedSquares, frame.stageTime);
+
   // Write the list of square centers to a file
   string fileName = "/sdcard/squares" + to_string(picNumber) + ".txt";
   FILE *fp = fopen((char*)fileName.c_str(), "w");
   if(fp == NULL){
     ESP_LOGE(TAG, "Failed to open file for writing");
+    setPlacementTag(NULL);
     return;
   }
 
-  // Print the list of square centers
-  for(unsigned int i=0; i<sqrList->size(); i++)
+  // Print the list of square centers (sub-pixel)
+  for(unsigned int i=0; i<sqrList.size(); i++)
   {
-    fprintf(fp, "%d %d\n", (*sqrList)[i].center.x, (*sqrList)[i].center.y);
+    if constexpr(Classifier::markers)
+      fprintf(fp, "%.2f %.2f %d %d\n", sqrList[i].subCenter.x, sqrList[i].subCenter.y, sqrList[i].id, sqrList[i].rotation);
+    else
+      fprintf(fp, "%.2f %.2f\n", sqrList[i].subCenter.x, sqrList[i].subCenter.y);
   }
   fclose(fp);
 
-  // Free memory
-  delete sqrList;
+  ESP_LOGI(TAG, "Frame arena: %u of %u bytes used (%u overflows so far)", (unsigned int)frameArena.used(),
+           (unsigned int)frameArena.capacity(), frameArena.overflows());
 
   // save image with contours
-  Mat2bmp(img, "/sdcard/", "mark" + to_string(picNumber));
-  saveRawMat(img, "/sdcard/", "mark" + to_string(picNumber));
+  saveStage(img, "/sdcard/", "mark" + to_string(picNumber), ARCHIVE_QUALITY_MARK);
   ESP_LOGI(TAG, "Approximation done");
 
   // Release image memory
   img.release();
-}
\ No newline at end of file
+  setPlacementTag(NULL);
+}
+
+template<class Input, class Preproc, class Edges, class Classifier>
+bool Pipeline<Input, Preproc, Edges, Classifier>::detect(camera_fb_t * fb, vector<Square> & squares)
+{
+  frameArena.reset();
+
+  // Nothing is saved and the frame buffer stays with the caller
+  FrameState frame;
+  frame.fb = fb;
+  frame.picNumber = 0;
+  frame.offline = true;
+
+  pmr::vector<Square> sqrList(&frameArena);
+  bool done = process(frame, sqrList, false);
+  squares.assign(sqrList.begin(), sqrList.end());
+  setPlacementTag(NULL);
+  return done;
+}
+
+// ============================================= REGISTRY ==========================================
+
+// Stages of the production pipelines, from the settings above
+typedef MedianPreproc<3> Preproc;
+typedef CannyEdges<(CANNY_AUTO != 0), (CANNY_AUTO != 0 || REFINE_CORNERS != 0)> CannyFrontEnd;
+typedef BinarizeEdges<BINARIZE_RADIUS, BINARIZE_OFFSET> BinarizeFrontEnd;
+typedef SquareClassifier<(REFINE_CORNERS != 0), (DECODE_MARKERS != 0)> CannyClassifier;
+typedef SquareClassifier<false, (DECODE_MARKERS != 0)> BinarizeClassifier;
+
+// Pipelines the settings use: the front-end of BINARIZE on the format of the detection, both
+// front-ends on the formats of the scene generator with RUN_SCENES, everything with PIPELINES_ALL
+static constexpr bool pipelineCompiled(pixformat_t format, bool binarize)
+{
+  return PIPELINES_ALL || (format == DETECTION_PIXEL_FORMAT && binarize == (BINARIZE != 0)) ||
+         (RUN_SCENES && (format == PIXFORMAT_YUV422 || format == PIXFORMAT_GRAYSCALE || format == PIXFORMAT_RGB565));
+}
+
+// Entry of the registry: the pipeline is only instantiated if it is compiled, otherwise the entry
+// has no functions
+template<class Input, class Edges, class Classifier>
+static constexpr PipelineEntry pipelineEntry(const char * name, const char * frontEnd)
+{
+  if constexpr(pipelineCompiled(Input::format, is_same<Edges, BinarizeFrontEnd>::value))
+    return {name, Input::format, frontEnd, Pipeline<Input, Preproc, Edges, Classifier>::run, Pipeline<Input, Preproc, Edges, Classifier>::detect};
+  else
+    return {name, Input::format, frontEnd, NULL, NULL};
+}
+
+// Every combination, compiled or not
+const PipelineEntry PIPELINES[] =
+{
+  pipelineEntry<JpegInput, CannyFrontEnd, CannyClassifier>("jpeg/canny", "canny"),
+  pipelineEntry<JpegInput, BinarizeFrontEnd, BinarizeClassifier>("jpeg/binarize", "binarize"),
+  pipelineEntry<Yuv422Input, CannyFrontEnd, CannyClassifier>("yuv422/canny", "canny"),
+  pipelineEntry<Yuv422Input, BinarizeFrontEnd, BinarizeClassifier>("yuv422/binarize", "binarize"),
+  pipelineEntry<GrayInput, CannyFrontEnd, CannyClassifier>("gray/canny", "canny"),
+  pipelineEntry<GrayInput, BinarizeFrontEnd, BinarizeClassifier>("gray/binarize", "binarize"),
+  pipelineEntry<Rgb565Input, CannyFrontEnd, CannyClassifier>("rgb565/canny", "canny"),
+  pipelineEntry<Rgb565Input, BinarizeFrontEnd, BinarizeClassifier>("rgb565/binarize", "binarize"),
+  pipelineEntry<Rgb888Input, CannyFrontEnd, CannyClassifier>("rgb888/canny", "canny"),
+  pipelineEntry<Rgb888Input, BinarizeFrontEnd, BinarizeClassifier>("rgb888/binarize", "binarize"),
+};
+const unsigned int PIPELINE_COUNT = sizeof(PIPELINES) / sizeof(PIPELINES[0]);
+
+const PipelineEntry * findPipeline(pixformat_t format, const char * frontEnd)
+{
+  for(unsigned int i=0; i<PIPELINE_COUNT; i++)
+  {
+    if(PIPELINES[i].run != NULL && PIPELINES[i].format == format && strcmp(PIPELINES[i].frontEnd, frontEnd) == 0)
+      return &PIPELINES[i];
+  }
+  return NULL;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void extractSquares(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, string resultFileTag, bool onlyCanny)
+{
+  // The pipeline compiled for the format of the frame
+  const PipelineEntry * pipeline = findPipeline(fb->format, BINARIZE ? "binarize" : "canny");
+  if(pipeline == NULL){
+    ESP_LOGE(TAG, "No %s pipeline compiled for format %d (see DETECTION_PIXEL_FORMAT)", BINARIZE ? "binarize" : "canny", (int)fb->format);
+    esp_camera_fb_return(fb);
+    return;
+  }
+  pipeline->run(fb, expectedSquares, picNumber, resultFileTag, onlyCanny);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool jpg2patches(const uint8_t * src, size_t len, const vector<Rect> & regions, vector<Mat> & patches, bool colour, jpg_scale_t scale)
+{
+  // Kept from call to call, like the Mat objects of patches (their pixels are reused when the size
+  // does not change)
+  static vector<jpg_patch_t> jpgPatches;
+  jpgPatches.resize(regions.size());
+
+  // One Mat per region, the parts outside the picture stay black
+  patches.resize(regions.size());
+  for(unsigned int i=0; i<regions.size(); i++)
+  {
+    // Regions partially above or left of the picture are decoded from its edge
+    Rect r = regions[i] & Rect(0, 0, 0xFFFF, 0xFFFF);
+    patches[i].create(regions[i].height, regions[i].width, colour ? CV_8UC3 : CV_8UC1);
+    patches[i].setTo(Scalar::all(0));
+    jpgPatches[i].x = r.x;
+    jpgPatches[i].y = r.y;
+    jpgPatches[i].w = r.width;
+    jpgPatches[i].h = r.height;
+    jpgPatches[i].buf = r.empty() ? NULL : patches[i].ptr<uint8_t>(r.y - regions[i].y, r.x - regions[i].x);
+    jpgPatches[i].stride = patches[i].step;
+  }
+
+  if(esp_jpg_decode_patches(src, len, scale, !colour, jpgPatches.data(), jpgPatches.size()) != ESP_OK){
+    ESP_LOGE(TAG, "JPEG patch decode failed");
+    return false;
+  }
+
+  // The decoder writes RGB, OpenCV works in BGR
+  if(colour){
+    for(unsigned int i=0; i<patches.size(); i++)
+    {
+      for(int y=0; y<patches[i].rows; y++)
+        pixconv_swap_rb(patches[i].ptr<uint8_t>(y), patches[i].ptr<uint8_t>(y), patches[i].cols);
+    }
+  }
+
+  return true;
+}
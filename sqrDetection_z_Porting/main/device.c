@@ -11,6 +11,11 @@
 // ============================================= CODE ==============================================
 
 #include "device.h"
+#include <esp_heap_caps.h>
+#include <esp_freertos_hooks.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
 
 #define TAG "Device"
 
@@ -36,8 +41,108 @@ void disp_infos() {
   /* Print memory information */
   // Print stack high watermark 
   ESP_LOGI(TAG, "task %s stack high watermark: %d Bytes", pcTaskGetName(NULL), (int)uxTaskGetStackHighWaterMark(NULL));
-  // Print heap left
-  ESP_LOGI(TAG, "heap left: %d MBytes", (int)esp_get_free_heap_size()/1024/1024);
+  // Print heap left (internal RAM and PSRAM)
+  ESP_LOGI(TAG, "heap left: %d KBytes internal, %d KBytes PSRAM",
+           (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL)/1024, (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM)/1024);
   // Print PSRAM infos
-  ESP_LOGI(TAG, "PSRAM size: %d MBytes", esp_psram_get_size()/1024/1024);
-}
\ No newline at end of file
+  ESP_LOGI(TAG, "PSRAM size: %d MBytes", (int)esp_psram_get_size()/1024/1024);
+}
+
+//============================================= TELEMETRY ==========================================
+/*------------------------------------------------------------------------------------------------*/
+
+static const char * const telemetry_tasks[] = TELEMETRY_TASKS;
+#define TELEMETRY_TASK_COUNT (sizeof(telemetry_tasks) / sizeof(telemetry_tasks[0]))
+_Static_assert(TELEMETRY_TASK_COUNT <= TELEMETRY_MAX_TASKS, "too many TELEMETRY_TASKS");
+
+// The idle task calls its hooks, then waits for the next interrupt: an idle core calls its hook
+// about once per tick, a busy one never
+static volatile uint32_t idle_calls[2] = {0, 0};
+static uint32_t last_idle_calls[2] = {0, 0};
+static TickType_t last_tick = 0;
+static uint16_t telemetry_period = 0;
+static uint32_t telemetry_frames = 0;
+
+static bool idle_hook_core0(void) {
+  idle_calls[0]++;
+  return true;
+}
+
+static bool idle_hook_core1(void) {
+  idle_calls[1]++;
+  return true;
+}
+
+esp_err_t start_telemetry(uint16_t period) {
+  if(period == 0 || telemetry_period != 0) {
+    return ESP_OK;
+  }
+  esp_err_t err = esp_register_freertos_idle_hook_for_cpu(idle_hook_core0, 0);
+#ifndef CONFIG_FREERTOS_UNICORE
+  if(err == ESP_OK) {
+    err = esp_register_freertos_idle_hook_for_cpu(idle_hook_core1, 1);
+  }
+#endif
+  if(err != ESP_OK) {
+    ESP_LOGE(TAG, "telemetry idle hooks not registered");
+    return err;
+  }
+  last_tick = xTaskGetTickCount();
+  telemetry_period = period;
+  return ESP_OK;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool sample_telemetry(uint32_t frame_id, telemetry_t *record) {
+  if(telemetry_period == 0 || telemetry_frames++ % telemetry_period != 0) {
+    return false;
+  }
+
+  telemetry_t t;
+  memset(&t, 0, sizeof(t));
+  t.frame_id = frame_id;
+  t.uptime_ms = esp_timer_get_time() / 1000;
+  t.internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  t.internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  t.internal_min = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  t.psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  t.psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  t.psram_min = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+
+  // Load: ticks the idle hook did not see (other interrupts wake the idle task too, hence the clamp)
+  TickType_t now = xTaskGetTickCount();
+  uint32_t ticks = now - last_tick;
+  last_tick = now;
+  for(int core = 0; core < 2; core++) {
+    uint32_t calls = idle_calls[core] - last_idle_calls[core];
+    last_idle_calls[core] += calls;
+    t.cpu_load[core] = ticks == 0 ? 0 : 100 - MIN(calls, ticks) * 100 / ticks;
+  }
+#ifdef CONFIG_FREERTOS_UNICORE
+  t.cpu_load[1] = 0;
+#endif
+
+  // One line per record: frame, uptime, internal and PSRAM free/largest/min in KB, load, stacks
+  char line[256];
+  int len = snprintf(line, sizeof(line), "f=%u t=%u int=%u/%u/%u psram=%u/%u/%u cpu=%u/%u stack=",
+                     (unsigned)t.frame_id, (unsigned)t.uptime_ms, (unsigned)t.internal_free / 1024,
+                     (unsigned)t.internal_largest / 1024, (unsigned)t.internal_min / 1024, (unsigned)t.psram_free / 1024,
+                     (unsigned)t.psram_largest / 1024, (unsigned)t.psram_min / 1024, t.cpu_load[0], t.cpu_load[1]);
+  for(unsigned int i = 0; i < TELEMETRY_TASK_COUNT; i++) {
+    TaskHandle_t task = xTaskGetHandle(telemetry_tasks[i]);
+    if(task == NULL) {
+      continue;
+    }
+    t.stack_free[i] = uxTaskGetStackHighWaterMark(task);
+    if(len > 0 && len < (int)sizeof(line)) {
+      len += snprintf(line + len, sizeof(line) - len, "%s%s:%u", line[len - 1] == '=' ? "" : ",", telemetry_tasks[i], t.stack_free[i]);
+    }
+  }
+  ESP_LOGI(TAG, "telemetry %s", line);
+
+  if(record != NULL) {
+    *record = t;
+  }
+  return true;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file edgeRuns.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the run-length encoded edge map.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <edgeRuns.hpp>
+#include <string.h>
+
+
+// Neighbours of a pixel in the order used by the border following (counter-clockwise from the right)
+static const int dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int dy[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+
+// Marks left on a run by the border following: its first pixel belongs to a followed border,
+// its last pixel belongs to a followed border that passed on its right side
+#define RUN_START_MARKED 0x01
+#define RUN_END_CLOSED 0x02
+
+// ============================================= ENCODE ============================================
+
+void encodeEdges(const Mat & edges, EdgeMap & map)
+{
+  map.cols = edges.cols;
+  map.rows = edges.rows;
+  map.runs.clear();
+  map.rowRuns.clear();
+  map.rowRuns.push_back(0);
+
+  for(int y = 0; y < map.rows; y++)
+  {
+    const uint8_t * row = edges.ptr<uint8_t>(y);
+    int x = 0;
+
+    while(x < map.cols)
+    {
+      // Skip the background, a 32-bit word at a time once aligned: most of the edge image is empty
+      while(x < map.cols && !row[x] && ((uintptr_t)(row + x) & 3))
+        x++;
+      for(uint32_t word; x + 4 <= map.cols; x += 4)
+      {
+        memcpy(&word, row + x, 4);
+        if(word)
+          break;
+      }
+      while(x < map.cols && !row[x])
+        x++;
+      if(x >= map.cols)
+        break;
+
+      // Run of edge pixels
+      int start = x;
+      while(x < map.cols && row[x])
+        x++;
+      map.runs.push_back({(uint16_t)start, (uint16_t)(x - 1)});
+    }
+    map.rowRuns.push_back(map.runs.size());
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void decodeEdges(const EdgeMap & map, Mat & edges)
+{
+  edges.create(map.rows, map.cols, CV_8UC1);
+
+  for(int y = 0; y < map.rows; y++)
+  {
+    uint8_t * row = edges.ptr<uint8_t>(y);
+    memset(row, 0, map.cols);
+    for(uint32_t i = map.rowRuns[y]; i < map.rowRuns[y + 1]; i++)
+      memset(row + map.runs[i].start, 255, map.runs[i].end - map.runs[i].start + 1);
+  }
+}
+
+// ============================================= BINARIZE ==========================================
+
+void binarize(const Mat & gray, EdgeMap & map, int radius, int offset)
+{
+  map.cols = gray.cols;
+  map.rows = gray.rows;
+  map.runs.clear();
+  map.rowRuns.clear();
+  map.rowRuns.push_back(0);
+
+  // Sums of the window rows, column by column: a row is added when it enters the window and
+  // subtracted when it leaves. The scratch rows are kept from call to call (the detection runs on a
+  // single task), so they are only allocated by the first frame
+  static vector<uint32_t> columns;
+  columns.assign(map.cols, 0);
+  for(int y = 0; y < radius && y < map.rows; y++)
+  {
+    const uint8_t * row = gray.ptr<uint8_t>(y);
+    for(int x = 0; x < map.cols; x++)
+      columns[x] += row[x];
+  }
+
+  // Dark pixels of a row (0xff), padded to whole words for the run extraction
+  static vector<uint8_t> dark;
+  dark.assign((map.cols + 3) & ~3, 0);
+
+  for(int y = 0; y < map.rows; y++)
+  {
+    const uint8_t * enter = y + radius < map.rows ? gray.ptr<uint8_t>(y + radius) : NULL;
+    const uint8_t * leave = y - radius - 1 >= 0 ? gray.ptr<uint8_t>(y - radius - 1) : NULL;
+    if(enter && leave)
+    {
+      for(int x = 0; x < map.cols; x++)
+        columns[x] += enter[x] - leave[x];
+    }
+    else if(enter || leave)
+    {
+      for(int x = 0; x < map.cols; x++)
+        columns[x] += enter ? enter[x] : -leave[x];
+    }
+    int height = min(y + radius, map.rows - 1) - max(y - radius, 0) + 1;
+
+    // Window sum along the row, same running scheme on the column sums. A pixel is dark when
+    // (pixel + offset) * area < sum, so the mean is never divided out. Only the columns near the
+    // borders have a clipped window.
+    const uint8_t * row = gray.ptr<uint8_t>(y);
+    const uint32_t * col = columns.data();
+    uint32_t sum = 0;
+    int x = 0;
+    for(int i = 0; i < radius && i < map.cols; i++)
+      sum += col[i];
+    for(; x < map.cols && (x < radius + 1 || x + radius >= map.cols); x++)
+    {
+      if(x + radius < map.cols)
+        sum += col[x + radius];
+      if(x - radius - 1 >= 0)
+        sum -= col[x - radius - 1];
+      uint32_t area = (min(x + radius, map.cols - 1) - max(x - radius, 0) + 1) * height;
+      dark[x] = (row[x] + offset) * area < sum ? 0xff : 0;
+    }
+    uint32_t area = (2 * radius + 1) * height;
+    for(; x + radius < map.cols; x++)
+    {
+      sum += col[x + radius] - col[x - radius - 1];
+      dark[x] = (row[x] + offset) * area < sum ? 0xff : 0;
+    }
+    for(; x < map.cols; x++)
+    {
+      sum -= col[x - radius - 1];
+      uint32_t area = (map.cols - (x - radius)) * height;
+      dark[x] = (row[x] + offset) * area < sum ? 0xff : 0;
+    }
+
+    // Runs of the dark pixels, skipping the background a word at a time
+    x = 0;
+    while(x < map.cols)
+    {
+      for(uint32_t word; x + 4 <= map.cols; x += 4)
+      {
+        memcpy(&word, &dark[x], 4);
+        if(word)
+          break;
+      }
+      while(x < map.cols && !dark[x])
+        x++;
+      if(x >= map.cols)
+        break;
+
+      int start = x;
+      while(x < map.cols && dark[x])
+        x++;
+      map.runs.push_back({(uint16_t)start, (uint16_t)(x - 1)});
+    }
+    map.rowRuns.push_back(map.runs.size());
+  }
+}
+
+// ============================================= DILATE ============================================
+
+void dilateEdges(const EdgeMap & src, EdgeMap & dst)
+{
+  dst.cols = src.cols;
+  dst.rows = src.rows;
+  dst.runs.clear();
+  dst.rowRuns.clear();
+  dst.rowRuns.push_back(0);
+
+  for(int y = 0; y < src.rows; y++)
+  {
+    // Runs of the rows above, on and below the output row (merged in column order)
+    uint32_t next[3], stop[3];
+    for(int k = 0; k < 3; k++)
+    {
+      int row = y - 1 + k;
+      bool inside = row >= 0 && row < src.rows;
+      next[k] = inside ? src.rowRuns[row] : 0;
+      stop[k] = inside ? src.rowRuns[row + 1] : 0;
+    }
+
+    int start = -1, end = -1;
+    for(;;)
+    {
+      // Leftmost run not merged yet
+      int k = -1;
+      for(int i = 0; i < 3; i++)
+      {
+        if(next[i] < stop[i] && (k < 0 || src.runs[next[i]].start < src.runs[next[k]].start))
+          k = i;
+      }
+      if(k < 0)
+        break;
+
+      // Each run grows by one pixel on both sides, touching runs are joined
+      int s = max((int)src.runs[next[k]].start - 1, 0);
+      int e = min((int)src.runs[next[k]].end + 1, src.cols - 1);
+      next[k]++;
+      if(start >= 0 && s <= end + 1)
+      {
+        end = max(end, e);
+      }
+      else
+      {
+        if(start >= 0)
+          dst.runs.push_back({(uint16_t)start, (uint16_t)end});
+        start = s;
+        end = e;
+      }
+    }
+    if(start >= 0)
+      dst.runs.push_back({(uint16_t)start, (uint16_t)end});
+    dst.rowRuns.push_back(dst.runs.size());
+  }
+}
+
+// ============================================= CONTOURS ==========================================
+
+// Index of the run covering pixel (x,y), -1 if the pixel is background
+static int findRun(const EdgeMap & map, int x, int y)
+{
+  if(x < 0 || y < 0 || x >= map.cols || y >= map.rows)
+    return -1;
+
+  uint32_t lo = map.rowRuns[y], hi = map.rowRuns[y + 1];
+  while(lo < hi)
+  {
+    uint32_t mid = (lo + hi) / 2;
+    if(map.runs[mid].end < x)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return (lo < map.rowRuns[y + 1] && map.runs[lo].start <= x) ? (int)lo : -1;
+}
+
+// Mark pixel x of run r as part of a followed border. Only the first and last pixels of a run are
+// ever looked at again by the scan, so their marks are the only ones kept.
+static void markPixel(const EdgeMap & map, pmr::vector<uint8_t> & marks, int r, int x, bool closed)
+{
+  if(x == map.runs[r].start)
+    marks[r] |= RUN_START_MARKED;
+  if(closed && x == map.runs[r].end)
+    marks[r] |= RUN_END_CLOSED;
+}
+
+// Follow the border starting at pixel (x,y) of run r (Suzuki and Abe, as done by findContours)
+// and store its corner points
+static void followBorder(const EdgeMap & map, pmr::vector<uint8_t> & marks, int r, int x, int y, bool hole, Contour & contour)
+{
+  Point p0(x, y), p1, p3, p4;
+  int s, sEnd, prevS, r3, r4;
+
+  // First neighbour, searched clockwise
+  s = sEnd = hole ? 0 : 4;
+  do
+  {
+    s = (s - 1) & 7;
+    p1 = Point(p0.x + dx[s], p0.y + dy[s]);
+  }
+  while(findRun(map, p1.x, p1.y) < 0 && s != sEnd);
+
+  // Isolated pixel
+  if(s == sEnd)
+  {
+    markPixel(map, marks, r, p0.x, true);
+    contour.push_back(p0);
+    return;
+  }
+
+  p3 = p0;
+  r3 = r;
+  prevS = s ^ 4;
+  for(;;)
+  {
+    // Next border pixel, searched counter-clockwise from the previous one
+    sEnd = s;
+    do
+    {
+      s++;
+      p4 = Point(p3.x + dx[s & 7], p3.y + dy[s & 7]);
+    }
+    while((r4 = findRun(map, p4.x, p4.y)) < 0);
+    s &= 7;
+
+    // The right neighbour has been examined if the search went past direction 0
+    markPixel(map, marks, r3, p3.x, (unsigned)(s - 1) < (unsigned)sEnd);
+
+    // Only the points where the direction changes are kept (CHAIN_APPROX_SIMPLE)
+    if(s != prevS)
+    {
+      contour.push_back(p3);
+      prevS = s;
+    }
+
+    if(p4 == p0 && p3 == p1)
+      break;
+
+    p3 = p4;
+    r3 = r4;
+    s = (s + 4) & 7;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void findEdgeContours(const EdgeMap & map, ContourList & contours)
+{
+  // The marks live with the contours (the frame arena in the detection)
+  pmr::vector<uint8_t> marks(map.runs.size(), 0, contours.get_allocator().resource());
+
+  contours.clear();
+
+  // A border starts where the raster scan enters a run not met by a border yet (outer border),
+  // or leaves a run whose right side has not been followed yet (hole border). Both only happen
+  // at the ends of the runs, so the background is never visited.
+  for(int y = 0; y < map.rows; y++)
+  {
+    for(uint32_t r = map.rowRuns[y]; r < map.rowRuns[y + 1]; r++)
+    {
+      if(!(marks[r] & RUN_START_MARKED))
+      {
+        contours.emplace_back();
+        followBorder(map, marks, r, map.runs[r].start, y, false, contours.back());
+      }
+      if(!(marks[r] & RUN_END_CLOSED))
+      {
+        contours.emplace_back();
+        followBorder(map, marks, r, map.runs[r].end, y, true, contours.back());
+      }
+    }
+  }
+}
@@ -0,0 +1,345 @@
+/**
+ * @file flightRecorder.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the flight recorder.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <flightRecorder.hpp>
+#include <sdWriter.hpp>
+#include <img_converters.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <string.h>
+#include <vector>
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "flightRecorder";
+
+/**
+ * @brief Frame in the ring: its header and where its payload is
+ */
+struct FlightEntry
+{
+  FlightFrameHeader header;
+  size_t offset;
+};
+
+// Ring of the payloads, and the frames in it (circular, from the oldest)
+static uint8_t * ring = NULL;
+static size_t ringSize = 0;
+static size_t ringHead = 0;         // where the next payload goes
+static vector<FlightEntry> entries;
+static unsigned int oldest = 0;     // oldest frame
+static unsigned int frameCount = 0; // frames in the ring
+static bool waiting = false;        // the newest frame waits for its result
+static FlightCompression ringCompression = FLIGHT_DELTA_RLE;
+static uint8_t ringQuality = 80;
+static bool dumped = false;
+static int64_t dumpTime = 0;        // timestamp of the newest frame of the last dump
+// Frames are compressed here first, so the ring only gives room to the bytes actually produced
+static uint8_t * scratch = NULL;
+static size_t scratchSize = 0;
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool startFlightRecorder(size_t capacity, unsigned int frames, FlightCompression compression, uint8_t quality)
+{
+  if(ring != NULL)
+  {
+    return true;
+  }
+  ring = (uint8_t *)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if(ring == NULL)
+  {
+    ESP_LOGE(TAG, "Failed to allocate the ring (%u bytes of PSRAM)", (unsigned int)capacity);
+    return false;
+  }
+  ringSize = capacity;
+  entries.resize(frames);
+  ringCompression = compression;
+  ringQuality = quality;
+  ESP_LOGI(TAG, "Recording the last %u frames in %u bytes (%s)", frames, (unsigned int)capacity,
+           compression == FLIGHT_JPEG ? "JPEG" : "delta-RLE");
+  return true;
+}
+
+bool flightRecorderRunning()
+{
+  return ring != NULL;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Does any frame use the ring in [start, start + size)
+static bool overlapsAny(size_t start, size_t size)
+{
+  for(unsigned int k = 0; k < frameCount; k++)
+  {
+    const FlightEntry & entry = entries[(oldest + k) % entries.size()];
+    if(entry.offset < start + size && entry.offset + entry.header.payloadSize > start)
+      return true;
+  }
+  return false;
+}
+
+// Drop frames from the oldest until a payload of size bytes fits at the head and a frame is free
+static bool makeRoom(size_t size)
+{
+  if(size > ringSize)
+  {
+    return false;
+  }
+  if(ringHead + size > ringSize)
+  {
+    ringHead = 0;
+  }
+  // The frames are dropped in order, so the ones in the way go with all the older ones
+  while(frameCount > 0 && (frameCount == entries.size() || overlapsAny(ringHead, size)))
+  {
+    oldest = (oldest + 1) % entries.size();
+    frameCount--;
+  }
+  return true;
+}
+
+// Scratch buffer of at least size bytes (in PSRAM, grown with the frame size)
+static bool reserveScratch(size_t size)
+{
+  if(size <= scratchSize)
+  {
+    return true;
+  }
+  heap_caps_free(scratch);
+  scratch = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  scratchSize = scratch != NULL ? size : 0;
+  return scratch != NULL;
+}
+
+// Output of the JPEG encoder: the scratch buffer
+typedef struct {
+  uint8_t * data;
+  size_t size;
+  size_t used;
+  bool full;
+} flightJpeg;
+
+static size_t flightJpegWrite(void * arg, size_t index, const void * data, size_t len)
+{
+  flightJpeg * out = (flightJpeg *)arg;
+  if(data == NULL)
+  {
+    return 0;
+  }
+  if(out->used + len > out->size)
+  {
+    out->full = true;
+    return 0;
+  }
+  memcpy(out->data + out->used, data, len);
+  out->used += len;
+  return len;
+}
+
+void flightRecordFrame(const Mat & gray, uint32_t frameId)
+{
+  if(ring == NULL)
+  {
+    return;
+  }
+  if(gray.type() != CV_8UC1 || !gray.isContinuous())
+  {
+    ESP_LOGW(TAG, "Frame %u not recorded: continuous CV_8UC1 expected", (unsigned int)frameId);
+    return;
+  }
+
+  // The previous frame never got its result (the detection stopped early)
+  waiting = false;
+
+  // Compression in the scratch buffer, sized for the largest payload
+  size_t pixels = gray.total();
+  size_t bound = ringCompression == FLIGHT_JPEG ? pixels : DELTA_RLE_BOUND(pixels);
+  if(!reserveScratch(bound))
+  {
+    ESP_LOGW(TAG, "Frame %u not recorded: no scratch buffer of %u bytes", (unsigned int)frameId, (unsigned int)bound);
+    return;
+  }
+  size_t size;
+  if(ringCompression == FLIGHT_JPEG)
+  {
+    flightJpeg out = {scratch, bound, 0, false};
+    if(!fmt2jpg_cb(gray.data, pixels, gray.cols, gray.rows, PIXFORMAT_GRAYSCALE, ringQuality, flightJpegWrite, &out) || out.full)
+    {
+      ESP_LOGW(TAG, "Frame %u not recorded: JPEG encoding failed", (unsigned int)frameId);
+      return;
+    }
+    size = out.used;
+  }
+  else
+  {
+    size = deltaRleEncode(gray.data, gray.cols, gray.rows, scratch);
+  }
+
+  // Only the compressed bytes take room in the ring (the payloads are kept aligned)
+  if(!makeRoom(size))
+  {
+    ESP_LOGW(TAG, "Frame %u not recorded: %u bytes, ring of %u", (unsigned int)frameId, (unsigned int)size, (unsigned int)ringSize);
+    return;
+  }
+
+  FlightEntry & entry = entries[(oldest + frameCount) % entries.size()];
+  memset(&entry.header, 0, sizeof(entry.header));
+  entry.offset = ringHead;
+  entry.header.frameId = frameId;
+  entry.header.timestamp = esp_timer_get_time();
+  entry.header.width = gray.cols;
+  entry.header.height = gray.rows;
+  entry.header.compression = ringCompression;
+  entry.header.payloadSize = size;
+  memcpy(ring + ringHead, scratch, size);
+
+  ringHead = (ringHead + entry.header.payloadSize + 3) & ~(size_t)3;
+  frameCount++;
+  waiting = true;
+}
+
+bool flightRecordResult(const Square * squares, unsigned int found, int expected, const uint32_t stageTime[STAGE_COUNT])
+{
+  if(ring == NULL || !waiting)
+  {
+    return false;
+  }
+  waiting = false;
+
+  FlightFrameHeader & header = entries[(oldest + frameCount - 1) % entries.size()].header;
+  header.complete = 1;
+  header.expected = expected;
+  header.squareCount = found;
+  memcpy(header.stageTime, stageTime, sizeof(header.stageTime));
+  for(unsigned int i = 0; i < found && i < FLIGHT_MAX_SQUARES; i++)
+  {
+    FlightSquare & square = header.squares[i];
+    square.x = squares[i].subCenter.x;
+    square.y = squares[i].subCenter.y;
+    square.id = squares[i].id;
+    for(int c = 0; c < 3; c++)
+      square.bgr[c] = squares[i].colour[c];
+  }
+
+  // Trigger: squares missing, and after a dump only once every frame of the ring is newer than it
+  if((int)found >= expected || (dumped && entries[oldest].header.timestamp <= dumpTime))
+  {
+    return false;
+  }
+  ESP_LOGW(TAG, "Frame %u: %u of %d squares found, dumping the last %u frames", (unsigned int)header.frameId, found,
+           expected, frameCount);
+  dumped = dumpFlightRecorder("/sdcard/flight" + to_string(header.frameId) + ".rec");
+  dumpTime = header.timestamp;
+  return dumped;
+}
+
+bool dumpFlightRecorder(const string & path)
+{
+  if(ring == NULL)
+  {
+    return false;
+  }
+
+  SdWriter writer;
+  if(!writer.open(path))
+  {
+    return false;
+  }
+  FlightFileHeader fileHeader;
+  memset(&fileHeader, 0, sizeof(fileHeader));
+  memcpy(fileHeader.magic, FLIGHT_MAGIC, sizeof(fileHeader.magic));
+  fileHeader.version = FLIGHT_VERSION;
+  fileHeader.frames = frameCount;
+  fileHeader.stageCount = STAGE_COUNT;
+  bool ok = writer.write(&fileHeader, sizeof(fileHeader));
+  for(unsigned int k = 0; k < frameCount && ok; k++)
+  {
+    const FlightEntry & entry = entries[(oldest + k) % entries.size()];
+    ok = writer.write(&entry.header, sizeof(entry.header)) && writer.write(ring + entry.offset, entry.header.payloadSize);
+  }
+  return writer.close() && ok;
+}
+
+// ============================================= DELTA-RLE =========================================
+/*------------------------------------------------------------------------------------------------*/
+
+// Difference of pixel i with the previous one (the one above at the start of a row)
+static inline uint8_t residual(const uint8_t * src, size_t i, int width)
+{
+  if(i % width != 0)
+    return src[i] - src[i - 1];
+  return i >= (size_t)width ? (uint8_t)(src[i] - src[i - width]) : src[i];
+}
+
+size_t deltaRleEncode(const uint8_t * src, int width, int height, uint8_t * dst)
+{
+  size_t pixels = (size_t)width * height, out = 0;
+  size_t control = 0, literals = 0; // literal run being written
+  size_t i = 0;
+  while(i < pixels)
+  {
+    uint8_t value = residual(src, i, width);
+    size_t run = 1;
+    while(i + run < pixels && run < 130 && residual(src, i + run, width) == value)
+      run++;
+
+    if(run >= 3)
+    {
+      if(literals > 0)
+        dst[control] = literals - 1;
+      literals = 0;
+      dst[out++] = run + 125;
+      dst[out++] = value;
+      i += run;
+      continue;
+    }
+
+    // Short runs go into the literal run
+    for(size_t k = 0; k < run; k++)
+    {
+      if(literals == 0)
+        control = out++;
+      dst[out++] = value;
+      if(++literals == 128)
+      {
+        dst[control] = 127;
+        literals = 0;
+      }
+    }
+    i += run;
+  }
+  if(literals > 0)
+    dst[control] = literals - 1;
+  return out;
+}
+
+bool deltaRleDecode(const uint8_t * src, size_t len, int width, int height, uint8_t * dst)
+{
+  size_t pixels = (size_t)width * height, i = 0, in = 0;
+  while(in < len && i < pixels)
+  {
+    uint8_t c = src[in++];
+    size_t n = c < 128 ? c + 1 : c - 125;
+    if(i + n > pixels || (c < 128 ? in + n : in + 1) > len)
+      return false;
+    for(size_t k = 0; k < n; k++, i++)
+    {
+      uint8_t value = c < 128 ? src[in + k] : src[in];
+      uint8_t prediction = i % width != 0 ? dst[i - 1] : (i >= (size_t)width ? dst[i - width] : 0);
+      dst[i] = prediction + value;
+    }
+    in += c < 128 ? n : 1;
+  }
+  return i == pixels && in == len;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file frameArena.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the frame arena.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <frameArena.hpp>
+#include <matAllocator.hpp>
+#include <esp_log.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "frameArena";
+
+// Room kept in front of the heap blocks for the link to the next one
+#define OVERFLOW_HEADER 16
+
+/*------------------------------------------------------------------------------------------------*/
+
+FrameArena::FrameArena(size_t capacity) : size(capacity)
+{
+}
+
+FrameArena::~FrameArena()
+{
+  reset();
+  placementFree(buffer);
+}
+
+void FrameArena::reset()
+{
+  // Heap blocks of the frame, if the buffer was not enough
+  while(overflowBlocks != NULL)
+  {
+    void * next = *(void **)overflowBlocks;
+    placementFree(overflowBlocks);
+    overflowBlocks = next;
+  }
+  offset = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void * FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+  // The buffer is taken the first time it is needed, in the arena statistics
+  if(buffer == NULL && size > 0)
+  {
+    const char * previous = setPlacementTag("arena");
+    buffer = (uint8_t *)placementMalloc(size);
+    setPlacementTag(previous);
+    if(buffer == NULL)
+    {
+      ESP_LOGW(TAG, "Arena buffer of %u bytes not allocated, using the heap", (unsigned int)size);
+      size = 0;
+    }
+  }
+
+  // Next aligned address in the buffer
+  size_t start = (offset + alignment - 1) & ~(alignment - 1);
+  if(buffer != NULL && start + bytes <= size)
+  {
+    offset = start + bytes;
+    highWater = max(highWater, offset);
+    return buffer + start;
+  }
+
+  // Buffer full: heap block linked to the others of the frame
+  overflowCount++;
+  uint8_t * block = (uint8_t *)placementMalloc(OVERFLOW_HEADER + alignment + bytes);
+  if(block == NULL)
+  {
+    ESP_LOGE(TAG, "Out of memory (%u bytes)", (unsigned int)bytes);
+    abort();
+  }
+  *(void **)block = overflowBlocks;
+  overflowBlocks = block;
+  return (void *)(((uintptr_t)block + OVERFLOW_HEADER + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameArena::do_deallocate(void *, size_t, size_t)
+{
+  // Everything is released by reset
+}
+
+bool FrameArena::do_is_equal(const pmr::memory_resource & other) const noexcept
+{
+  return this == &other;
+}
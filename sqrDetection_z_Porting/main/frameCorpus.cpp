@@ -0,0 +1,233 @@
+/**
+ * @file frameCorpus.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the frame corpus writer.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <frameCorpus.hpp>
+#include <esp_log.h>
+#include <esp_random.h>
+#include <stdio.h>
+#include <string.h>
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "frameCorpus";
+
+// Bytes per pixel of the frame formats (0 if the size is not fixed)
+static size_t pixelBytes(pixformat_t format)
+{
+  switch(format)
+  {
+    case PIXFORMAT_GRAYSCALE:
+      return 1;
+    case PIXFORMAT_RGB565:
+    case PIXFORMAT_YUV422:
+      return 2;
+    case PIXFORMAT_RGB888:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Settings the sensor is running with
+static void readSensorSettings(CorpusSensorSettings & settings)
+{
+  memset(&settings, 0, sizeof(settings));
+  sensor_t * sensor = esp_camera_sensor_get();
+  if(sensor == NULL)
+    return;
+
+  const camera_status_t & s = sensor->status;
+  settings.pid = sensor->id.PID;
+  settings.framesize = s.framesize;
+  settings.quality = s.quality;
+  settings.brightness = s.brightness;
+  settings.contrast = s.contrast;
+  settings.saturation = s.saturation;
+  settings.sharpness = s.sharpness;
+  settings.awb = s.awb;
+  settings.awbGain = s.awb_gain;
+  settings.wbMode = s.wb_mode;
+  settings.aec = s.aec;
+  settings.aec2 = s.aec2;
+  settings.aeLevel = s.ae_level;
+  settings.aecValue = s.aec_value;
+  settings.agc = s.agc;
+  settings.agcGain = s.agc_gain;
+  settings.gainCeiling = s.gainceiling;
+  settings.flags = (s.hmirror ? 1 : 0) | (s.vflip ? 2 : 0) | (s.lenc ? 4 : 0) | (s.denoise ? 8 : 0);
+  settings.xclkHz = sensor->xclk_freq_hz;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool CorpusWriter::open(const string & path)
+{
+  close();
+
+  // An existing corpus is checked and its complete frames are kept
+  FILE * file = fopen(path.c_str(), "rb");
+  if(file != NULL)
+  {
+    CorpusFileHeader fileHeader;
+    if(fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 || memcmp(fileHeader.magic, CORPUS_MAGIC, 8) != 0 ||
+       fileHeader.version != CORPUS_VERSION || fileHeader.headerSize != sizeof(fileHeader))
+    {
+      ESP_LOGE(TAG, "%s is not a frame corpus", path.c_str());
+      fclose(file);
+      return false;
+    }
+
+    // The frames are kept up to the first one that is not part of this corpus or was cut
+    long end = fileHeader.headerSize;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    CorpusFrameHeader header, previous;
+    CorpusFrameTrailer trailer;
+    unsigned int frames = 0;
+    while(fseek(file, end, SEEK_SET) == 0 && fread(&header, sizeof(header), 1, file) == 1 &&
+          corpusRecordFollows(fileHeader, frames > 0 ? &previous : NULL, header, end, length) &&
+          fseek(file, end + header.recordSize - sizeof(trailer), SEEK_SET) == 0 &&
+          fread(&trailer, sizeof(trailer), 1, file) == 1 && corpusRecordComplete(header, trailer))
+    {
+      end += header.recordSize;
+      previous = header;
+      frames++;
+    }
+    fclose(file);
+
+    // The new frames go after the last complete one, what follows it is cut when the writer closes
+    if(end < length)
+      ESP_LOGW(TAG, "%s: %ld bytes after the last complete frame dropped", path.c_str(), length - end);
+    if(!writer.open(path, CORPUS_PREALLOCATE, end))
+      return false;
+    // The new frames are a session after the last one kept: what an older session left past them
+    // does not follow them
+    frameCount = frames;
+    fileId = fileHeader.fileId;
+    session = frames > 0 ? previous.session + 1 : 0;
+    lastFrameId = frames > 0 ? previous.frameId : 0;
+    lastTimestamp = frames > 0 ? previous.timestamp : 0;
+    ESP_LOGI(TAG, "%s opened, %u frames", path.c_str(), frameCount);
+    return true;
+  }
+
+  // New corpus
+  if(!writer.open(path, CORPUS_PREALLOCATE))
+    return false;
+  CorpusFileHeader fileHeader;
+  memset(&fileHeader, 0, sizeof(fileHeader));
+  memcpy(fileHeader.magic, CORPUS_MAGIC, 8);
+  fileHeader.version = CORPUS_VERSION;
+  fileHeader.headerSize = sizeof(fileHeader);
+  fileHeader.fileId = esp_random();
+  if(!writer.write(&fileHeader, sizeof(fileHeader)) || !writer.sync())
+  {
+    ESP_LOGE(TAG, "Failed to write %s", path.c_str());
+    close();
+    return false;
+  }
+  fileId = fileHeader.fileId;
+  session = 0;
+  ESP_LOGI(TAG, "%s created", path.c_str());
+  return true;
+}
+
+void CorpusWriter::close()
+{
+  writer.close();
+  frameCount = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool CorpusWriter::append(const camera_fb_t * fb, uint32_t frameId)
+{
+  CorpusFrameHeader header;
+  memset(&header, 0, sizeof(header));
+  header.frameId = frameId;
+  header.width = fb->width;
+  header.height = fb->height;
+  header.format = fb->format;
+  header.timestamp = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+  readSensorSettings(header.sensor);
+
+  // JPEG frames are kept compressed, as a single row of bytes
+  size_t bytes = pixelBytes(fb->format);
+  if(bytes == 0)
+  {
+    header.cvType = CV_8UC1;
+    return writeFrame(header, fb->buf, 1, fb->len, fb->len);
+  }
+  header.cvType = CV_8UC(bytes);
+  header.step = fb->width * bytes;
+  return writeFrame(header, fb->buf, fb->height, header.step, header.step);
+}
+
+bool CorpusWriter::append(const Mat & img, pixformat_t format, uint32_t frameId, int64_t timestamp)
+{
+  CorpusFrameHeader header;
+  memset(&header, 0, sizeof(header));
+  header.frameId = frameId;
+  header.width = img.cols;
+  header.height = img.rows;
+  header.format = format;
+  header.timestamp = timestamp;
+  header.cvType = img.type();
+  header.step = img.cols * img.elemSize();
+  return writeFrame(header, img.data, img.rows, header.step, img.step);
+}
+
+// Header, rows of the payload (the padding of the source rows is left out), alignment and trailer.
+// The frame is synced: the trailer is on the card once it returns
+bool CorpusWriter::writeFrame(CorpusFrameHeader & header, const uint8_t * data, size_t rows, size_t rowBytes, size_t step)
+{
+  if(!writer.isOpen())
+  {
+    ESP_LOGE(TAG, "Corpus not open");
+    return false;
+  }
+
+  // Frames going back in id or time start a session, so they still follow the previous one
+  if(frameCount > 0 && (header.frameId < lastFrameId || header.timestamp < lastTimestamp))
+    session++;
+
+  static const uint8_t padding[CORPUS_ALIGN] = {0};
+  header.magic = CORPUS_FRAME_MAGIC;
+  header.headerSize = sizeof(header);
+  header.payloadSize = rows * rowBytes;
+  header.recordSize = corpusRecordSize(header.payloadSize);
+  header.fileId = fileId;
+  header.session = session;
+  CorpusFrameTrailer trailer = {CORPUS_FRAME_MAGIC, fileId, session, header.frameId};
+
+  bool ok = writer.write(&header, sizeof(header));
+  if(step == rowBytes)
+    ok = ok && writer.write(data, header.payloadSize);
+  else
+  {
+    for(size_t r = 0; r < rows && ok; r++)
+      ok = writer.write(data + r * step, rowBytes);
+  }
+  ok = ok && writer.write(padding, header.recordSize - sizeof(header) - header.payloadSize - sizeof(trailer));
+  ok = ok && writer.write(&trailer, sizeof(trailer));
+  ok = ok && writer.sync();
+  if(!ok)
+  {
+    ESP_LOGE(TAG, "Failed to append frame %u", (unsigned int)header.frameId);
+    return false;
+  }
+  frameCount++;
+  lastFrameId = header.frameId;
+  lastTimestamp = header.timestamp;
+  return true;
+}
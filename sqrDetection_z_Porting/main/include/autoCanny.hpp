@@ -0,0 +1,82 @@
+/**
+ * @file autoCanny.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the choice of the Canny thresholds frame by frame: the image
+ *         derivatives are computed together with the histogram of the gradient magnitude, and the
+ *         thresholds are taken from its percentiles.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __AUTOCANNY_HPP
+#define __AUTOCANNY_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Settings and state of the threshold choice. The high threshold leaves highFraction of
+ * the pixels above it, the low one lowFraction (both at least the minimum values, so that a flat
+ * or saturated frame does not turn its noise into edges). When a frame gives more than
+ * maxContours contours the fractions are scaled down for the next frames, and back up when the
+ * contours are fewer again.
+ */
+struct AutoCanny
+{
+  float highFraction;
+  float lowFraction;
+  int minHigh;
+  int minLow;
+  unsigned int maxContours;
+
+  // Updated frame by frame
+  float scale = 1.0f;
+  int low = 0;
+  int high = 0;
+  unsigned int contours = 0;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Sobel derivatives (3x3, border replicated: the same as Sobel(gray, dx, CV_16S, 1, 0, 3,
+ *        1, 0, BORDER_REPLICATE) and its y twin) and histogram of |dx|+|dy|, the magnitude Canny
+ *        compares with its thresholds, in a single pass over the image
+ *
+ * @param gray CV_8UC1 image
+ * @param dx output x derivative (CV_16SC1)
+ * @param dy output y derivative (CV_16SC1)
+ * @param histogram output histogram, histogram[m] pixels have magnitude m (0..2040)
+ */
+void sobelHistogram(const Mat & gray, Mat & dx, Mat & dy, vector<uint32_t> & histogram);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Choose the thresholds of a frame (canny.low and canny.high) from its histogram
+ *
+ * @param canny settings and state
+ * @param histogram histogram from sobelHistogram
+ */
+void autoCannyThresholds(AutoCanny & canny, const vector<uint32_t> & histogram);
+
+/**
+ * @brief Record the number of contours found with the last thresholds, to adjust the next ones
+ *
+ * @param canny settings and state
+ * @param contours number of contours found in the frame
+ */
+void autoCannyTrack(AutoCanny & canny, unsigned int contours);
+
+#endif // __AUTOCANNY_HPP
@@ -0,0 +1,101 @@
+/**
+ * @file benchmark.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the benchmark of the detection stages: every stage is timed on
+ *         synthetic marker scenes at several resolutions and clutter levels, and the results are
+ *         written as JSON (in the layout of Google Benchmark) to compare them across commits.
+ *         The same code runs on a PC as tests/stageBench.
+ *         The self-test is a short version for deployed boards: the stages on a single scene, and
+ *         the memory copy bandwidth, saved with the configuration of the board.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __BENCHMARK_HPP
+#define __BENCHMARK_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <string>
+#include <vector>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Timing of a stage on a scene: "<stage>/<resolution>/clutter:<n>"
+ */
+struct BenchmarkResult
+{
+  string name;
+  unsigned int iterations;
+  double realTime;      // microseconds per iteration
+  unsigned int items;   // contours, squares... handled per iteration (0 if not counted)
+  double minTime;       // fastest, median and slowest iteration (us)
+  double medianTime;
+  double maxTime;
+};
+
+/**
+ * @brief Bandwidth of memcpy between two kinds of memory: "<source>-><destination>"
+ */
+struct BandwidthResult
+{
+  string name;
+  size_t bytes;         // bytes copied per run
+  double bandwidth;     // MB/s of the fastest run (0 if the buffers could not be allocated)
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Time every detection stage on synthetic scenes. Each stage is repeated until it has run
+ *        for BENCHMARK_MIN_TIME microseconds (at least once). The resolutions whose buffers do not
+ *        fit in the free memory are skipped.
+ *
+ * @param results output timings, in the order they are run
+ * @param filter only the stages whose name contains it are timed (NULL or "" for all)
+ */
+void runBenchmarks(vector<BenchmarkResult> & results, const char * filter = NULL);
+
+/**
+ * @brief Write timings as JSON ({"context": {...}, "benchmarks": [...]}, times in us)
+ *
+ * @param results timings from runBenchmarks
+ * @param path output file
+ *
+ * @return true on success
+ */
+bool saveBenchmarks(const vector<BenchmarkResult> & results, const string & path);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Self-test of the board: every detection stage runs exactly iterations times on the same
+ *        synthetic VGA scene, then memcpy is timed between internal RAM and PSRAM
+ *
+ * @param stages output timings of the stages (min, median and max are the ones to compare)
+ * @param copies output bandwidths
+ * @param iterations runs of each stage
+ */
+void runSelfTest(vector<BenchmarkResult> & stages, vector<BandwidthResult> & copies, unsigned int iterations);
+
+/**
+ * @brief Write the self-test as JSON, with the clock, PSRAM and flash settings of the firmware
+ *
+ * @param stages timings from runSelfTest
+ * @param copies bandwidths from runSelfTest
+ * @param path output file
+ *
+ * @return true on success
+ */
+bool saveSelfTest(const vector<BenchmarkResult> & stages, const vector<BandwidthResult> & copies, const string & path);
+
+#endif // __BENCHMARK_HPP
@@ -82,6 +82,23 @@ bool jpg2rgb_565(const uint8_t *src, size_t src_len, uint8_t ** out, size_t * ou
  */
 bool jpg2rgb_888(const uint8_t *src, size_t src_len, uint8_t ** out, size_t * out_len, size_t * out_width, size_t * out_height, jpg_scale_t scale);
 
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Decode the luma of a JPEG buffer into a caller-owned grayscale buffer
+ *        (no colour conversion, chroma is skipped)
+ * 
+ * @param src  source buffer in JPEG format
+ * @param src_len  Length in bytes of the source buffer
+ * @param out  Pointer to the first pixel of the output buffer (e.g. Mat::data of a CV_8UC1 Mat)
+ * @param out_stride  Bytes between the start of two output rows (e.g. Mat::step)
+ * @param out_width  Width of the output buffer, must be the JPEG width divided by the scale
+ * @param out_height  Height of the output buffer, must be the JPEG height divided by the scale
+ * @param scale  scale factor (JPG_SCALE_8X uses only the DC of each block)
+ * 
+ * @return true on success 
+ */
+bool jpg2gray(const uint8_t *src, size_t src_len, uint8_t * out, size_t out_stride, uint16_t out_width, uint16_t out_height, jpg_scale_t scale);
+
 
 
 #if __cplusplus
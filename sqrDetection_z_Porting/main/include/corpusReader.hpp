@@ -0,0 +1,95 @@
+/**
+ * @file corpusReader.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the reader of the frame corpus, for Linux: the file is mapped in memory
+ *         and the frames are used in place as Mat objects. It does not depend on ESP-IDF, the
+ *         tests build it with the OpenCV of the system.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __CORPUSREADER_HPP
+#define __CORPUSREADER_HPP
+
+#include <opencv2/core.hpp>
+#include <frameCorpusFormat.hpp>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Reader of a corpus: the file is mapped in memory and the frames are views on the mapping
+ * (nothing is read until it is used). The mapping is private and writable, so the detection can
+ * work in place on a frame: the pages it changes are copied, the file is never modified.
+ */
+class CorpusReader
+{
+public:
+  CorpusReader() = default;
+  ~CorpusReader() { close(); }
+
+  CorpusReader(const CorpusReader &) = delete;
+  CorpusReader & operator=(const CorpusReader &) = delete;
+
+  /**
+   * @brief Map the corpus and index its frames, up to the first one that does not continue the
+   * corpus (see corpusRecordFollows) or was not written to its end
+   *
+   * @param path corpus file
+   *
+   * @return true on success
+   */
+  bool open(const string & path);
+
+  /**
+   * @brief Unmap the corpus: the views of its frames are no longer valid
+   */
+  void close();
+
+  size_t size() const { return records.size(); }
+
+  const CorpusFrameHeader & header(size_t index) const { return *records[index]; }
+
+  /**
+   * @brief Payload of a frame (payloadSize bytes)
+   */
+  uint8_t * payload(size_t index) const { return (uint8_t *)records[index] + records[index]->headerSize; }
+
+  /**
+   * @brief View of a frame (a single row of bytes for JPEG frames)
+   */
+  Mat frame(size_t index) const;
+
+  /**
+   * @brief Fill a frame buffer (camera_fb_t) pointing to a frame, to be given to PipelineEntry::detect
+   */
+  template <typename FrameBuffer>
+  void frameBuffer(size_t index, FrameBuffer & fb) const
+  {
+    const CorpusFrameHeader & h = header(index);
+    memset(&fb, 0, sizeof(fb));
+    fb.buf = payload(index);
+    fb.len = h.payloadSize;
+    fb.width = h.width;
+    fb.height = h.height;
+    fb.format = (decltype(fb.format))h.format;
+    fb.timestamp.tv_sec = h.timestamp / 1000000;
+    fb.timestamp.tv_usec = h.timestamp % 1000000;
+  }
+
+private:
+  uint8_t * base = NULL;
+  size_t length = 0;
+  vector<CorpusFrameHeader *> records;
+};
+
+#endif // __CORPUSREADER_HPP
@@ -18,14 +18,122 @@
 #include <esp_camera.h>
 #include <bitmapUtils.h>
 
+// Capture mode:
+// 1 -> a single YUV422 frame gives both the grayscale image and the colour of the squares
+// 0 -> an RGB565 colour frame, then the camera is re-initialised for a grayscale frame
+#ifndef SINGLE_CAPTURE
+#define SINGLE_CAPTURE 1
+#endif
+
+/**
+ * PIXFORMAT_RGB565,    // 2BPP/RGB565
+ * PIXFORMAT_YUV422,    // 2BPP/YUV422
+ * PIXFORMAT_GRAYSCALE, // 1BPP/GRAYSCALE
+ * PIXFORMAT_JPEG,      // JPEG/COMPRESSED
+ * PIXFORMAT_RGB888,    // 3BPP/RGB888
+ */
+#ifndef CAMERA_PIXEL_FORMAT
+#if SINGLE_CAPTURE
+#define CAMERA_PIXEL_FORMAT PIXFORMAT_YUV422
+#else
+#define CAMERA_PIXEL_FORMAT PIXFORMAT_RGB565
+#endif
+#endif
+
+// Format of the frames given to extractSquares: the camera frame, or with two captures the
+// grayscale one
+#if SINGLE_CAPTURE
+#define DETECTION_PIXEL_FORMAT CAMERA_PIXEL_FORMAT
+#else
+#define DETECTION_PIXEL_FORMAT PIXFORMAT_GRAYSCALE
+#endif
+
+// 1 -> the detection runs on synthetic frames (in memory, nothing is saved, see main.cpp) instead of
+//      taking pictures, and the squares found are scored against the ground truth of the frames
+//      (both front-ends, on every format the scene generator renders)
+#ifndef RUN_SCENES
+#define RUN_SCENES 0
+#endif
+
+// 1 -> every format with both front-ends is compiled in PIPELINES, whatever the settings above
+#ifndef PIPELINES_ALL
+#define PIPELINES_ALL 0
+#endif
+
 /**
- * @brief Function that runs the square detection algorithm.
+ * @brief Stages of the detection, timed on every frame (the names are also the placement tags of
+ *        their buffers, see matAllocator.hpp)
+ */
+enum DetectionStage
+{
+  STAGE_INPUT,    // frame to grayscale
+  STAGE_MEDIAN,   // median filter
+  STAGE_EDGES,    // edges (Canny or binarization)
+  STAGE_CONTOURS, // contours, quadrilaterals and their verification
+  STAGE_SQUARES,  // squares: colours, markers, overlaps
+  STAGE_COLOUR,   // colour patches decoded from the JPEG frame
+  STAGE_COUNT
+};
+
+extern const char * const STAGE_NAMES[STAGE_COUNT];
+
+/**
+ * @brief Function that runs the square detection algorithm, with the pipeline of the frame format
+ *        and the configured front-end (BINARIZE).
  * 
- * @param fb Pointer to the camera frame buffer.
+ * @param fb Pointer to the camera frame buffer, given back to the driver by this function.
  * @param expectedSquares The number of squares expected in the picture.
  * @param resultFileTag The tag to use for the result file.
  * @param onlyCanny If true, only the canny algorithm is used.
  */
 void extractSquares(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, string resultFileTag = string("result0.txt"), bool onlyCanny = false);
 
+/**
+ * @brief Detection pipeline compiled for a single input format and front-end: the stages are
+ *        policy types combined at compile time, so each pipeline only contains the code it runs.
+ *        extractSquares picks the one matching the frame from PIPELINES.
+ */
+struct PipelineEntry
+{
+  const char * name;      // "<format>/<front-end>"
+  pixformat_t format;     // format of the frames it takes
+  const char * frontEnd;  // "canny" or "binarize"
+  void (*run)(camera_fb_t * fb, int expectedSquares, uint8_t picNumber, string resultFileTag, bool onlyCanny);
+  // Detection on a frame not from the camera (e.g. a synthetic one): the squares are returned,
+  // nothing is saved and the frame buffer stays with the caller. false if the frame is not read.
+  bool (*detect)(camera_fb_t * fb, vector<Square> & squares);
+};
+
+// Every format with both front-ends: only the ones the settings above use are compiled, the others
+// have no run and detect functions and are never returned by findPipeline
+extern const PipelineEntry PIPELINES[];
+extern const unsigned int PIPELINE_COUNT;
+
+/**
+ * @brief Find the pipeline of a format and front-end
+ * 
+ * @param format pixel format of the frames
+ * @param frontEnd "canny" or "binarize"
+ * 
+ * @return const PipelineEntry* - the pipeline, NULL if none matches or it is not compiled
+ */
+const PipelineEntry * findPipeline(pixformat_t format, const char * frontEnd);
+
+/**
+ * @brief Function that decodes only some regions of a JPEG picture, each one into its own Mat.
+ *        The MCUs outside the regions are only entropy-decoded (no IDCT, no colour conversion).
+ * 
+ * @param src Buffer in JPEG format.
+ * @param len Length in bytes of the buffer.
+ * @param regions The regions to decode, in pixels of the scaled picture.
+ * @param patches Output Mats, one per region (CV_8UC3 in BGR, or CV_8UC1). Pixels outside the
+ *                picture are set to 0. The Mats already in it are reused (Mat::create), so a
+ *                caller decoding every frame keeps the same buffers.
+ * @param colour If true the patches are in colour, otherwise luma only.
+ * @param scale Scale of the decode (as for jpg2gray).
+ * 
+ * @return true on success.
+ */
+bool jpg2patches(const uint8_t * src, size_t len, const vector<Rect> & regions, vector<Mat> & patches, bool colour = true, jpg_scale_t scale = JPG_SCALE_NONE);
+
 #endif // __DETECTSQUARES_HPP
\ No newline at end of file
@@ -21,6 +21,8 @@
 #include <sdkconfig.h>
 
 #include <sys/param.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -30,6 +32,29 @@
 #endif 
 
 
+// Tasks whose stack high watermark is sampled by the telemetry (at most TELEMETRY_MAX_TASKS)
+#ifndef TELEMETRY_TASKS
+#define TELEMETRY_TASKS {"main", "archive", "sdWriter", "esp_timer"}
+#endif
+#define TELEMETRY_MAX_TASKS 8
+
+/**
+ * @brief Telemetry record: memory and CPU of the system when a frame is done
+ */
+typedef struct {
+  uint32_t frame_id;
+  uint32_t uptime_ms;
+  uint32_t internal_free;     // bytes free in internal RAM
+  uint32_t internal_largest;  // largest block that can be allocated in internal RAM
+  uint32_t internal_min;      // lowest internal_free since boot
+  uint32_t psram_free;        // same for PSRAM (0 without PSRAM)
+  uint32_t psram_largest;
+  uint32_t psram_min;
+  uint8_t cpu_load[2];        // percent per core since the previous record
+  uint16_t stack_free[TELEMETRY_MAX_TASKS]; // stack high watermark in bytes of TELEMETRY_TASKS (0 if not running)
+} telemetry_t;
+
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -60,6 +85,29 @@ void wait_sec(uint16_t v);
  */
 void disp_infos();
 
+//============================================= TELEMETRY ==========================================
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief start the telemetry: the CPU load is counted by an idle hook on each core
+ * 
+ * @param period a record is taken every period frames (0 disables the telemetry)
+ * 
+ * @return esp_err_t - ESP_OK on success
+ */
+esp_err_t start_telemetry(uint16_t period);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief to be called once per frame: every period frames a telemetry record is taken and logged
+ *        on a single line
+ * 
+ * @param frame_id frame the record refers to
+ * @param record filled with the record if one is taken (can be NULL)
+ * 
+ * @return true if a record has been taken
+ */
+bool sample_telemetry(uint32_t frame_id, telemetry_t *record);
+
 
 #if __cplusplus
 }
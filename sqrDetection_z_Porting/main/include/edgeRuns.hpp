@@ -0,0 +1,103 @@
+/**
+ * @file edgeRuns.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains a run-length encoded edge map and the functions working on it:
+ *         dilation and contour extraction cost in proportion to the edges, not to the frame area.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __EDGERUNS_HPP
+#define __EDGERUNS_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <stdint.h>
+#include <frameArena.hpp>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Horizontal run of edge pixels: first and last column (both included)
+ */
+struct EdgeRun
+{
+  uint16_t start;
+  uint16_t end;
+};
+
+/**
+ * @brief Binary edge image stored as runs, row after row:
+ * the runs of row y are runs[rowRuns[y]] .. runs[rowRuns[y+1]-1], sorted and not touching
+ */
+struct EdgeMap
+{
+  int cols = 0;
+  int rows = 0;
+  vector<uint32_t> rowRuns;
+  vector<EdgeRun> runs;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Encode a binary image (e.g. the Canny output) as runs of non-zero pixels
+ *
+ * @param edges CV_8UC1 edge image
+ * @param map output edge map
+ */
+void encodeEdges(const Mat & edges, EdgeMap & map);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Binarize a grayscale image with a local mean: the pixels darker than the mean of the
+ *        (2*radius+1)^2 window around them (clipped at the image borders) by more than offset are
+ *        stored as runs. The window sums are kept as running sums, so the image is read in a
+ *        single pass whatever the radius.
+ *
+ * @param gray CV_8UC1 image
+ * @param map output map of the dark regions
+ * @param radius half size of the window
+ * @param offset how much darker than the mean a pixel must be
+ */
+void binarize(const Mat & gray, EdgeMap & map, int radius, int offset);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Dilate an edge map with a 3x3 square, as dilate(img, img, Mat()) does on the image
+ *
+ * @param src edge map to dilate
+ * @param dst output edge map (must not be src)
+ */
+void dilateEdges(const EdgeMap & src, EdgeMap & dst);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Draw an edge map into a CV_8UC1 image (edges 255, background 0)
+ *
+ * @param map edge map to draw
+ * @param edges output image, allocated if needed
+ */
+void decodeEdges(const EdgeMap & map, Mat & edges);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Find the contours of an edge map: the same outer and hole borders, with the same points,
+ *        as findContours(RETR_TREE, CHAIN_APPROX_SIMPLE) on the decoded image. The contours are
+ *        listed in the order their first point is met scanning the rows, no hierarchy is built.
+ *
+ * @param map edge map
+ * @param contours output contours
+ */
+void findEdgeContours(const EdgeMap & map, ContourList & contours);
+
+#endif // __EDGERUNS_HPP
@@ -0,0 +1,175 @@
+/**
+ * @file flightRecorder.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the flight recorder: the last frames of the detection, compressed,
+ *         with their squares and stage timings, kept in a ring buffer in PSRAM. Nothing is
+ *         written to the SD card until a frame misses some of the expected squares: then the
+ *         frames that led to it are dumped to a single file.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __FLIGHTRECORDER_HPP
+#define __FLIGHTRECORDER_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <detectSquares.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+// Layout of a dump (little endian): a FlightFileHeader, then the frames from the oldest, each one
+// a FlightFrameHeader followed by payloadSize bytes of compressed grayscale image
+
+#define FLIGHT_MAGIC "SQRFLT1"
+#define FLIGHT_VERSION 1
+
+// Squares kept per frame (the others are counted but not stored)
+#define FLIGHT_MAX_SQUARES 16
+
+/**
+ * @brief Compression of the grayscale frames
+ */
+enum FlightCompression
+{
+  FLIGHT_DELTA_RLE, // lossless: difference with the previous pixel, then run lengths (see deltaRleEncode)
+  FLIGHT_JPEG       // fmt2jpg at the quality given to startFlightRecorder
+};
+
+/**
+ * @brief Header at the start of a dump
+ */
+struct FlightFileHeader
+{
+  char magic[8];       // FLIGHT_MAGIC
+  uint32_t version;    // FLIGHT_VERSION
+  uint32_t frames;     // frames in the file
+  uint32_t stageCount; // STAGE_COUNT of the firmware that wrote it
+  uint32_t reserved[3];
+};
+
+/**
+ * @brief Square of a recorded frame
+ */
+struct FlightSquare
+{
+  float x, y;          // sub-pixel center
+  int16_t id;          // marker id, -1 if none
+  uint8_t bgr[3];      // colour
+  uint8_t reserved[3];
+};
+
+/**
+ * @brief Header in front of every frame of a dump
+ */
+struct FlightFrameHeader
+{
+  uint32_t frameId;
+  uint32_t payloadSize;      // bytes of the compressed image
+  int64_t timestamp;         // microseconds since boot
+  uint16_t width;
+  uint16_t height;
+  uint8_t compression;       // FlightCompression
+  uint8_t complete;          // 1 if the detection gave its squares (0 if it stopped early)
+  uint16_t expected;         // squares expected
+  uint16_t squareCount;      // squares found
+  uint16_t reserved;
+  uint32_t stageTime[STAGE_COUNT]; // microseconds per stage
+  FlightSquare squares[FLIGHT_MAX_SQUARES];
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Allocate the ring (in PSRAM if present) and start recording
+ *
+ * @param capacity bytes of the ring for the compressed frames
+ * @param frames largest number of frames kept (fewer when their compressed sizes do not fit in
+ *        capacity)
+ * @param compression compression of the frames
+ * @param quality JPEG quality (FLIGHT_JPEG only)
+ *
+ * @return true on success
+ */
+bool startFlightRecorder(size_t capacity, unsigned int frames, FlightCompression compression, uint8_t quality = 80);
+
+/**
+ * @brief true once startFlightRecorder has succeeded
+ */
+bool flightRecorderRunning();
+
+/**
+ * @brief Compress a grayscale frame into the ring, dropping the oldest frames to make room. The
+ *        frame is compressed in a scratch buffer (DELTA_RLE_BOUND bytes of PSRAM, taken at the
+ *        first frame) and only its compressed size is copied in the ring. The frame waits for its
+ *        result (flightRecordResult).
+ *
+ * @param gray grayscale frame (CV_8UC1)
+ * @param frameId picture number
+ */
+void flightRecordFrame(const Mat & gray, uint32_t frameId);
+
+/**
+ * @brief Add the result of the detection to the last frame, and dump the recorder if squares are
+ *        missing. After a dump the trigger waits until the oldest frame of the ring was
+ *        recorded after it, so no frame is dumped twice.
+ *
+ * @param squares squares found
+ * @param count number of squares
+ * @param expected squares expected
+ * @param stageTime microseconds per stage
+ *
+ * @return true if the recorder has been dumped
+ */
+bool flightRecordResult(const Square * squares, unsigned int count, int expected, const uint32_t stageTime[STAGE_COUNT]);
+
+/**
+ * @brief Write the frames of the ring to a file, from the oldest
+ *
+ * @param path output file
+ *
+ * @return true on success
+ */
+bool dumpFlightRecorder(const string & path);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Largest output of deltaRleEncode for a number of pixels
+ */
+#define DELTA_RLE_BOUND(pixels) ((pixels) + ((pixels) + 127) / 128)
+
+/**
+ * @brief Lossless compression of a grayscale plane. Each pixel is replaced by its difference
+ *        (mod 256) with the previous one, or with the pixel above at the start of a row. The
+ *        differences are then run-length coded: a control byte c < 128 is followed by c + 1
+ *        literal bytes, a control byte c >= 128 by one byte repeated c - 125 times.
+ *
+ * @param src pixels, width * height continuous bytes
+ * @param width width of the plane
+ * @param height height of the plane
+ * @param dst output, at least DELTA_RLE_BOUND(width * height) bytes
+ *
+ * @return size_t - bytes written to dst
+ */
+size_t deltaRleEncode(const uint8_t * src, int width, int height, uint8_t * dst);
+
+/**
+ * @brief Decompress a plane compressed by deltaRleEncode
+ *
+ * @return true if the data decodes to exactly width * height pixels
+ */
+bool deltaRleDecode(const uint8_t * src, size_t len, int width, int height, uint8_t * dst);
+
+#endif // __FLIGHTRECORDER_HPP
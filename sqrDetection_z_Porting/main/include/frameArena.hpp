@@ -0,0 +1,80 @@
+/**
+ * @file frameArena.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the frame arena: a monotonic memory resource for the temporaries of
+ *         the detection (contours, square lists), released all together at the end of the frame.
+ *         The containers using it are std::pmr containers, so they keep the vector interface.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __FRAMEARENA_HPP
+#define __FRAMEARENA_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <stddef.h>
+#include <memory_resource>
+#include <vector>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Contour points and lists of contours living in a memory resource (the inner vectors get
+ * the resource of the list they are added to)
+ */
+typedef pmr::vector<Point> Contour;
+typedef pmr::vector<Contour> ContourList;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Monotonic arena: allocations move a pointer forward in a single buffer, deallocations do
+ * nothing, and reset gives the whole buffer back at once. The buffer (capacity bytes, from
+ * placementMalloc under the "arena" tag) is taken at the first allocation and kept for the next
+ * frames. When it is full the allocations go to the heap and are freed by reset, and they are
+ * counted so that the capacity can be raised.
+ */
+class FrameArena : public pmr::memory_resource
+{
+public:
+  explicit FrameArena(size_t capacity);
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena & operator=(const FrameArena &) = delete;
+
+  /**
+   * @brief Release everything allocated since the last reset (the buffer is kept)
+   */
+  void reset();
+
+  size_t capacity() const { return size; }
+  size_t used() const { return offset; }
+  size_t peak() const { return highWater; }
+  unsigned int overflows() const { return overflowCount; }
+
+protected:
+  void * do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void * ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const pmr::memory_resource & other) const noexcept override;
+
+private:
+  uint8_t * buffer = NULL;
+  size_t size;
+  size_t offset = 0;
+  size_t highWater = 0;
+  unsigned int overflowCount = 0;
+  void * overflowBlocks = NULL; // heap blocks of the frame, linked through their first word
+};
+
+#endif // __FRAMEARENA_HPP
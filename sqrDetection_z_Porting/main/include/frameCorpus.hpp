@@ -0,0 +1,108 @@
+/**
+ * @file frameCorpus.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the writer of the frame corpus: a single file the captured frames are
+ *         appended to, each one with a header holding its size, format, timestamp and the sensor
+ *         settings it was taken with. The layout is in frameCorpusFormat.hpp; the payload of every
+ *         frame is 64-byte aligned in the file, so on Linux the corpus can be mapped in memory and
+ *         its frames used in place as Mat objects (see corpusReader.hpp).
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __FRAMECORPUS_HPP
+#define __FRAMECORPUS_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <frameCorpusFormat.hpp>
+#include <sdWriter.hpp>
+#include <esp_camera.h>
+#include <stdint.h>
+#include <string>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+// The corpus file grows by this many bytes at a time (see SdWriter)
+#ifndef CORPUS_PREALLOCATE
+#define CORPUS_PREALLOCATE (8 * 1024 * 1024)
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Writer appending frames to a corpus file. The file is created if missing, otherwise the
+ * frames are added after the last complete one (a frame cut by a reset is overwritten). Every
+ * frame is synced to the card, so the frames appended before a reset are kept. The file is written
+ * through an SdWriter and grows by CORPUS_PREALLOCATE bytes at a time; the preallocation is not
+ * zeroed, what is left of older files in it is told apart by corpusRecordFollows.
+ */
+class CorpusWriter
+{
+public:
+  CorpusWriter() = default;
+  ~CorpusWriter() { close(); }
+
+  CorpusWriter(const CorpusWriter &) = delete;
+  CorpusWriter & operator=(const CorpusWriter &) = delete;
+
+  /**
+   * @brief Open (or create) the corpus
+   *
+   * @param path corpus file
+   *
+   * @return true on success (false if the file is not a corpus or cannot be written)
+   */
+  bool open(const string & path);
+
+  /**
+   * @brief Close the corpus (before unmounting the SD card)
+   */
+  void close();
+
+  /**
+   * @brief Append a camera frame, with the current settings of the sensor
+   *
+   * @param fb frame buffer
+   * @param frameId picture number
+   *
+   * @return true on success
+   */
+  bool append(const camera_fb_t * fb, uint32_t frameId);
+
+  /**
+   * @brief Append an image (a stage of the detection, a synthetic frame...)
+   *
+   * @param img image, continuous or not
+   * @param format pixformat_t of the image (e.g. PIXFORMAT_GRAYSCALE for CV_8UC1)
+   * @param frameId picture number
+   * @param timestamp microseconds since boot
+   *
+   * @return true on success
+   */
+  bool append(const Mat & img, pixformat_t format, uint32_t frameId, int64_t timestamp);
+
+  unsigned int frames() const { return frameCount; }
+
+private:
+  bool writeFrame(CorpusFrameHeader & header, const uint8_t * data, size_t rows, size_t rowBytes, size_t step);
+
+  SdWriter writer;
+  unsigned int frameCount = 0;
+  uint32_t fileId = 0;
+  uint32_t session = 0;        // session of the next frame
+  uint32_t lastFrameId = 0;    // frame appended last, while frameCount > 0
+  int64_t lastTimestamp = 0;
+};
+
+
+#endif // __FRAMECORPUS_HPP
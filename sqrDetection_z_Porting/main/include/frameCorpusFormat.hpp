@@ -0,0 +1,151 @@
+/**
+ * @file frameCorpusFormat.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the layout of the frame corpus file, shared by the writer of the
+ *         firmware and the reader on Linux. It depends on nothing but the C++ library.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __FRAMECORPUSFORMAT_HPP
+#define __FRAMECORPUSFORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------------------------*/
+// Layout of the file (little endian): a CorpusFileHeader, then the frames one after the other,
+// each one a CorpusFrameHeader followed by its payload, padded to CORPUS_ALIGN bytes and ended by a
+// CorpusFrameTrailer
+
+#define CORPUS_MAGIC "SQRFRMS2"
+#define CORPUS_VERSION 2
+#define CORPUS_FRAME_MAGIC 0x4d415246 // "FRAM"
+#define CORPUS_ALIGN 64
+
+/**
+ * @brief Header at the start of the file
+ */
+struct CorpusFileHeader
+{
+  char magic[8];       // CORPUS_MAGIC
+  uint32_t version;    // CORPUS_VERSION
+  uint32_t headerSize; // sizeof(CorpusFileHeader), the first frame starts here
+  uint32_t fileId;     // random number given at creation, copied in every frame of the file
+  uint8_t reserved[CORPUS_ALIGN - 20];
+};
+
+/**
+ * @brief Sensor settings of a frame (from the camera_status_t of the sensor)
+ */
+struct CorpusSensorSettings
+{
+  uint16_t pid;        // sensor model, 0 if the frame is not from the camera
+  uint8_t framesize;
+  uint8_t quality;
+  int8_t brightness;
+  int8_t contrast;
+  int8_t saturation;
+  int8_t sharpness;
+  uint8_t awb;
+  uint8_t awbGain;
+  uint8_t wbMode;
+  uint8_t aec;
+  uint8_t aec2;
+  int8_t aeLevel;
+  uint16_t aecValue;
+  uint8_t agc;
+  uint8_t agcGain;
+  uint8_t gainCeiling;
+  uint8_t flags;       // bit 0 hmirror, bit 1 vflip, bit 2 lens correction, bit 3 denoise
+  uint32_t xclkHz;
+};
+
+/**
+ * @brief Header in front of every frame
+ */
+struct CorpusFrameHeader
+{
+  uint32_t magic;       // CORPUS_FRAME_MAGIC
+  uint32_t headerSize;  // sizeof(CorpusFrameHeader), the payload starts here
+  uint64_t payloadSize; // bytes of the frame
+  uint64_t recordSize;  // header, payload and padding: the next frame starts here
+  uint32_t frameId;     // picture number given by the caller
+  uint32_t width;
+  uint32_t height;
+  uint32_t step;        // bytes per row, 0 for JPEG frames
+  int32_t cvType;       // type of the Mat of the frame (CV_8UC1 for JPEG frames)
+  uint32_t format;      // pixformat_t
+  int64_t timestamp;    // microseconds since boot
+  uint32_t fileId;      // fileId of the file header
+  uint32_t session;     // opening of the file the frame was written in (0 for the one creating it)
+  CorpusSensorSettings sensor;
+  uint8_t reserved[128 - 64 - sizeof(CorpusSensorSettings)];
+};
+
+/**
+ * @brief Last bytes of every frame: written after the payload, so a frame cut by a reset has none
+ */
+struct CorpusFrameTrailer
+{
+  uint32_t magic;       // CORPUS_FRAME_MAGIC
+  uint32_t fileId;      // the same as in the header of the frame
+  uint32_t session;
+  uint32_t frameId;
+};
+
+static_assert(sizeof(CorpusFileHeader) == CORPUS_ALIGN, "the first frame must be aligned");
+static_assert(sizeof(CorpusFrameHeader) % CORPUS_ALIGN == 0, "the payloads must be aligned");
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Bytes of a frame in the file, trailer included
+ */
+inline uint64_t corpusRecordSize(uint64_t payloadSize)
+{
+  return sizeof(CorpusFrameHeader) +
+         ((payloadSize + sizeof(CorpusFrameTrailer) + CORPUS_ALIGN - 1) & ~(uint64_t)(CORPUS_ALIGN - 1));
+}
+
+/**
+ * @brief Check that a record continues the corpus. The file is preallocated and never zeroed, so
+ * after a reset the bytes past the last frame are whatever the clusters held before: a record
+ * of another corpus (other fileId), or one left by an earlier session of this file past the point
+ * the next session went on from (older session, or ids and timestamps going back).
+ *
+ * @param file header of the file
+ * @param previous the last accepted frame (NULL for the first one)
+ * @param header the frame at offset
+ * @param offset where the frame starts in the file
+ * @param length size of the file
+ *
+ * @return true if the header describes a frame following previous (its trailer is checked apart)
+ */
+inline bool corpusRecordFollows(const CorpusFileHeader & file, const CorpusFrameHeader * previous,
+                                const CorpusFrameHeader & header, uint64_t offset, uint64_t length)
+{
+  if(header.magic != CORPUS_FRAME_MAGIC || header.fileId != file.fileId || header.headerSize != sizeof(CorpusFrameHeader) ||
+     header.payloadSize > length || header.recordSize != corpusRecordSize(header.payloadSize) ||
+     header.recordSize > length - offset)
+    return false;
+  if(previous == NULL || header.session > previous->session)
+    return true;
+  return header.session == previous->session && header.frameId >= previous->frameId &&
+         header.timestamp >= previous->timestamp;
+}
+
+/**
+ * @brief Check the trailer of a frame (the last sizeof(CorpusFrameTrailer) bytes of its record)
+ *
+ * @return true if the frame was written to its end
+ */
+inline bool corpusRecordComplete(const CorpusFrameHeader & header, const CorpusFrameTrailer & trailer)
+{
+  return trailer.magic == CORPUS_FRAME_MAGIC && trailer.fileId == header.fileId && trailer.session == header.session &&
+         trailer.frameId == header.frameId;
+}
+
+#endif // __FRAMECORPUSFORMAT_HPP
@@ -0,0 +1,63 @@
+/**
+ * @file markerDecoder.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the decoding of binary markers: a grid of black and white cells inside
+ *         a black border, sampled through the corners of a square and matched against a dictionary.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __MARKERDECODER_HPP
+#define __MARKERDECODER_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <stdint.h>
+#include <array>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Set of markers: each marker has bits x bits cells inside a black border one cell wide.
+ * Cell (row r, column c) of marker i is bit r*bits+c of codes[i], set if the cell is white.
+ * Any two markers, in any rotation, differ in more than 2*maxErrors cells.
+ */
+struct MarkerDictionary
+{
+  int bits;
+  int maxErrors;
+  int size;
+  const uint64_t * codes;
+};
+
+// 32 markers of 4x4 cells, at least 5 cells apart in any rotation (2 wrong cells corrected)
+extern const MarkerDictionary MARKERS_4X4_32;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Decode the marker inside a square: the cell grid is sampled with a fixed-point
+ *        homography from the corners, and matched against every marker of the dictionary in
+ *        the four rotations
+ *
+ * @param gray grayscale image (CV_8UC1) the corners were found in
+ * @param corners corners of the square, in contour order (either direction)
+ * @param dictionary markers that can be found
+ * @param id index of the marker in the dictionary
+ * @param rotation quarter turns (clockwise as seen in the picture) of the marker, taking corners[0]
+ *        as its top left corner
+ *
+ * @return true if a marker of the dictionary has been found
+ */
+bool decodeMarker(const Mat & gray, const array<Point2f,4> & corners, const MarkerDictionary & dictionary, int & id, int & rotation);
+
+#endif // __MARKERDECODER_HPP
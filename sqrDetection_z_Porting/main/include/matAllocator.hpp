@@ -0,0 +1,135 @@
+/**
+ * @file matAllocator.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the placement of the Mat buffers: an OpenCV allocator that puts the
+ *         small (hot) buffers in internal DRAM and the big ones in PSRAM, following per-tag rules,
+ *         and keeps per-tag statistics (bytes in use and high-water marks) to tune the rules.
+ *         On the host everything comes from malloc, the statistics are kept the same way.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __MATALLOCATOR_HPP
+#define __MATALLOCATOR_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <stddef.h>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Where a buffer is placed: PLACE_AUTO chooses by size (up to the internal limit in DRAM,
+ * as long as the DRAM reserve stays free, the rest in PSRAM)
+ */
+enum MemoryPlace
+{
+  PLACE_AUTO,
+  PLACE_INTERNAL,
+  PLACE_PSRAM,
+};
+
+/**
+ * @brief Statistics of the buffers allocated under a tag. Index 0 of the arrays is internal DRAM,
+ * index 1 PSRAM.
+ */
+struct PlacementStats
+{
+  const char * tag;
+  unsigned int allocations;
+  unsigned int fallbacks; // buffers not placed where the rule wanted (region full)
+  size_t current[2];      // bytes in use
+  size_t peak[2];         // high-water marks of current
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief OpenCV allocator placing the Mat buffers with placementMalloc, under the tag of the
+ * calling task
+ */
+class PlacementAllocator : public MatAllocator
+{
+public:
+  UMatData * allocate(int dims, const int * sizes, int type, void * data, size_t * step, AccessFlag flags, UMatUsageFlags usageFlags) const override;
+  bool allocate(UMatData * data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override;
+  void deallocate(UMatData * data) const override;
+};
+
+/**
+ * @brief Make PlacementAllocator the allocator of all the Mats created from now on
+ */
+void installPlacementAllocator();
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Set the tag of the allocations made by the calling task
+ *
+ * @param tag name of the stage (a string that stays valid, NULL for untagged)
+ *
+ * @return const char* - previous tag
+ */
+const char * setPlacementTag(const char * tag);
+
+/**
+ * @brief Set where the buffers of a tag go (PLACE_AUTO to remove the rule)
+ *
+ * @param tag name of the stage
+ * @param place placement of its buffers
+ */
+void setPlacementRule(const char * tag, MemoryPlace place);
+
+/**
+ * @brief Set the largest buffer PLACE_AUTO puts in internal DRAM, and the DRAM left free for the
+ *        rest of the system
+ *
+ * @param maxSize largest buffer placed in DRAM, in bytes
+ * @param reserve DRAM that must stay free, in bytes
+ */
+void setPlacementLimits(size_t maxSize, size_t reserve);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Allocate a buffer following the placement rules, under the tag of the calling task
+ *
+ * @param size size in bytes
+ *
+ * @return void* - buffer (aligned as malloc) to release with placementFree, NULL if out of memory
+ */
+void * placementMalloc(size_t size);
+
+/**
+ * @brief Release a buffer from placementMalloc
+ *
+ * @param ptr buffer (NULL is ignored)
+ */
+void placementFree(void * ptr);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Copy the statistics of all the tags met so far
+ *
+ * @param stats output statistics, one entry per tag
+ */
+void getPlacementStats(vector<PlacementStats> & stats);
+
+/**
+ * @brief Restart the high-water marks from the bytes in use (e.g. at the start of a frame)
+ */
+void resetPlacementPeaks();
+
+/**
+ * @brief Log the statistics of all the tags
+ */
+void logPlacementStats();
+
+#endif // __MATALLOCATOR_HPP
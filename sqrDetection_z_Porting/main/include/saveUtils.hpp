@@ -24,6 +24,18 @@
 #include <esp_camera.h>
 #include <esp_log.h>
 
+// Archive format of the saved images and stages:
+// 1 -> JPEG, encoded and streamed to the file by a background task
+// 0 -> uncompressed BMP (plus .raw for the stages), written by the caller
+#ifndef ARCHIVE_JPEG
+#define ARCHIVE_JPEG 1
+#endif
+
+// Default JPEG quality (1..100) of the archived images
+#ifndef ARCHIVE_QUALITY
+#define ARCHIVE_QUALITY 90
+#endif
+
 /*------------------------------------------------------------------------------------------------*/
 // Namesapces
 using namespace std;
@@ -54,18 +66,66 @@ bool saveRawMat(Mat &image, string path, string name);
  */
 bool Mat2bmp(Mat &img, string path, string name);
 
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Save an intermediate stage of the detection: as JPEG (see Mat2jpg) if ARCHIVE_JPEG is
+ *        enabled, otherwise as bmp and raw files
+ * 
+ * @param img  Mat object to save
+ * @param path  path where to save the image
+ * @param name  Name of the file without extension.
+ * @param quality  JPEG quality (1..100) of this stage
+ * 
+ * @return true if the image is saved (or queued) correctly false otherwise 
+ */
+bool saveStage(Mat &img, string path, string name, uint8_t quality = ARCHIVE_QUALITY);
+
+// ============================================= ARCHIVE ===========================================
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Queue a Mat object to be saved as a jpg file by the archive task.
+ *        The image is copied, so the caller can keep working on it. The JPEG is streamed to the
+ *        file while it is encoded (no output buffer), then bytes written and encode time are logged.
+ *        At most ARCHIVE_QUEUE_LEN copies are held by the archive (the one being encoded included):
+ *        when they are all in use, the call waits for one to be encoded before copying the image.
+ * 
+ * @param img  Mat object to save (CV_8UC1 grayscale, CV_8UC2 RGB565 or CV_8UC3 BGR)
+ * @param path  path where to save the image
+ * @param name  Name and extension of the file.
+ * @param quality  JPEG quality (1..100)
+ * 
+ * @return true if the image is queued correctly false otherwise 
+ */
+bool Mat2jpg(Mat &img, string path, string name, uint8_t quality = ARCHIVE_QUALITY);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Start the archive task (done by the first Mat2jpg if needed)
+ * 
+ * @return true if the task is running false otherwise 
+ */
+bool startArchive();
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Wait until every queued image has been written. Call it before unmounting the SD card.
+ */
+void flushArchive();
+
 // ============================================= PICTURE ===========================================
 /*------------------------------------------------------------------------------------------------*/
 /**
- * @brief Save the picture
+ * @brief Save the picture (as JPEG through the archive task if ARCHIVE_JPEG is enabled,
+ *        the frame is copied so it can be given back to the driver right away)
  * 
  * @param camera_fb_t Picture to save.
  * @param path Path where to save the picture.
  * @param name Name and extension of the file.
+ * @param quality JPEG quality (1..100), not used for JPEG frames that are written as they are
  * 
  * @return true If the picture is saved correctly false otherwise.
  */
-bool savePicture(camera_fb_t *pic, string path, string name);
+bool savePicture(camera_fb_t *pic, string path, string name, uint8_t quality = ARCHIVE_QUALITY);
 
 // ============================================= EXTRA ==============================================
 /*------------------------------------------------------------------------------------------------*/
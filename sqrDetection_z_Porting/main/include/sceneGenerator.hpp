@@ -0,0 +1,148 @@
+/**
+ * @file sceneGenerator.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the generator of synthetic scenes: a board of markers (coloured
+ *         squares or binary markers) seen in perspective, with lighting gradient, blur, noise,
+ *         occlusions and distractor shapes such as keyboard keys. Every frame comes with its
+ *         ground truth and is rendered in memory, in the format of a camera frame buffer, so it
+ *         can be given straight to the detection.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __SCENEGENERATOR_HPP
+#define __SCENEGENERATOR_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <sqrDetection.hpp>
+#include <esp_camera.h>
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Settings of the scenes. Sizes are in pixels of the frame, amounts of the random effects
+ * are the largest ones (each frame draws its own up to them).
+ */
+struct SceneConfig
+{
+  int width = 640;
+  int height = 480;
+  pixformat_t format = PIXFORMAT_YUV422; // YUV422, GRAYSCALE or RGB565
+
+  // Board: rows x cols markers of markerSide pixels, markerStep pixels apart (seen from the front)
+  int rows = 2;
+  int cols = 5;
+  float markerSide = 64;
+  float markerStep = 110;
+  bool binaryMarkers = false; // MARKERS_4X4_32 codes instead of coloured squares
+
+  // Pose of the board
+  float rotation = 10;      // degrees
+  float perspective = 0.08f; // corner displacement, as a fraction of the board size
+
+  // Image effects
+  float lighting = 0.3f;   // brightness drop across the frame (0 none, 1 black on one side)
+  float blur = 0.8f;       // sigma of the Gaussian blur
+  float noise = 3;         // sigma of the sensor noise, in grey levels
+  int occlusions = 0;      // occluding shapes over the board
+  int distractors = 10;    // keyboard keys, outlines and lines around the board
+
+  uint64_t seed = 1;
+};
+
+/**
+ * @brief Ground truth of a marker of a scene
+ */
+struct MarkerTruth
+{
+  array<Point2f,4> corners; // clockwise from the top left corner of the marker
+  Point2f center;           // image of the marker center
+  Vec3b colour;             // BGR colour (coloured squares)
+  int id;                   // index in MARKERS_4X4_32 (binary markers), -1 otherwise
+  bool occluded;            // partly covered by an occluding shape or out of the frame
+};
+
+/**
+ * @brief Comparison of the squares found in a frame with its ground truth
+ */
+struct SceneScore
+{
+  unsigned int frames = 0;
+  unsigned int markers = 0;        // visible markers of the frames
+  unsigned int found = 0;          // visible markers matched by a square
+  unsigned int falsePositives = 0; // squares not matching any marker
+  unsigned int wrongIds = 0;       // matched binary markers decoded with another id
+  double centerError = 0;          // sum of the center distances of the matches, in pixels
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Stream of synthetic frames: every call to next renders a new scene (the seed advances)
+ * into a buffer owned by the generator, which stays valid until the following call
+ */
+class SceneGenerator
+{
+public:
+  explicit SceneGenerator(const SceneConfig & config);
+
+  /**
+   * @brief Render the next frame
+   *
+   * @param fb frame buffer filled to point to the rendered frame
+   * @param truth ground truth of the markers of the frame
+   *
+   * @return true on success (false if the format is not supported)
+   */
+  bool next(camera_fb_t & fb, vector<MarkerTruth> & truth);
+
+  /**
+   * @brief The last frame in BGR, before the conversion to the frame format
+   */
+  const Mat & image() const { return bgr; }
+
+private:
+  SceneConfig config;
+  uint64_t frameIndex = 0;
+  Mat bgr;
+  vector<uint8_t> frame;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Match the squares found in a frame with its visible markers and add the result to score
+ *
+ * @param truth ground truth of the frame
+ * @param squares squares found by the detection
+ * @param tolerance largest center distance of a match, in pixels
+ * @param score score updated with the frame
+ */
+void scoreScene(const vector<MarkerTruth> & truth, const vector<Square> & squares, float tolerance, SceneScore & score);
+
+/**
+ * @brief Give frames of the generator to the detection pipeline of their format, in memory, and
+ *        score the squares found against the ground truth
+ *
+ * @param config settings of the scenes
+ * @param frames number of frames
+ * @param frontEnd "canny" or "binarize"
+ * @param score score of all the frames
+ *
+ * @return true on success (false if no pipeline takes the format)
+ */
+bool evaluateScenes(const SceneConfig & config, unsigned int frames, const char * frontEnd, SceneScore & score);
+
+#endif // __SCENEGENERATOR_HPP
@@ -0,0 +1,153 @@
+/**
+ * @file sdWriter.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the SD card writer: files are preallocated in large steps, so FATFS
+ *         does not look for a free cluster at every write, and the data goes through two
+ *         512-byte aligned, DMA capable buffers in internal RAM. While one buffer is written to
+ *         the card by the SD writer task, the caller fills the other one. The transfers are
+ *         whole sectors taken straight from these buffers, with no bounce through the driver.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __SDWRITER_HPP
+#define __SDWRITER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+
+// Size of each of the two buffers of a writer (multiple of the SD sector)
+#ifndef SD_WRITER_BUFFER
+#define SD_WRITER_BUFFER (16 * 1024)
+#endif
+
+// SD sector: the buffers are aligned to it, and so are the file positions of the transfers
+#define SD_SECTOR 512
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Totals of all the writers since boot
+ */
+struct SdWriterStats
+{
+  uint64_t bytes;        // bytes written to the card
+  int64_t busyTime;      // microseconds spent in the transfers
+  unsigned int transfers;
+  unsigned int stalls;   // fills that waited for the transfer of the other buffer
+  unsigned int files;    // files closed
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Buffered writer of a file. A writer is used by one task at a time; the buffers are taken
+ * at the first open and kept until the writer is destroyed, so it can be reused for many files.
+ */
+class SdWriter
+{
+public:
+  SdWriter() = default;
+  ~SdWriter();
+
+  SdWriter(const SdWriter &) = delete;
+  SdWriter & operator=(const SdWriter &) = delete;
+
+  /**
+   * @brief Open a file for writing
+   *
+   * @param path file to write
+   * @param preallocate bytes reserved ahead of the data, again every time they are used up (0 to
+   *        let FATFS allocate at every write)
+   * @param start the first start bytes of an existing file are kept and the data is written after
+   *        them (0 to start from an empty file)
+   *
+   * @return true on success
+   */
+  bool open(const string & path, size_t preallocate = 0, size_t start = 0);
+
+  /**
+   * @brief Copy data in the buffers (the full ones are handed to the SD writer task)
+   *
+   * @return false if a transfer of the file has failed
+   */
+  bool write(const void * data, size_t len);
+
+  /**
+   * @brief Write everything given so far and wait for the transfers to be done. The last partial
+   * sector is kept in the buffer and written again with the next data, so the transfers stay
+   * aligned. The data may still be in the cache of FATFS and the directory entry is not updated:
+   * use sync to have it survive a reset.
+   *
+   * @return false if a transfer of the file has failed
+   */
+  bool flush();
+
+  /**
+   * @brief Flush, then commit the file to the card (data, FAT and size in the directory entry)
+   *
+   * @return false if a transfer of the file or the commit has failed
+   */
+  bool sync();
+
+  /**
+   * @brief Flush, cut the file at the end of the data (the unused preallocation is released) and
+   * close it. The throughput of the file is logged.
+   *
+   * @return false if a transfer of the file has failed
+   */
+  bool close();
+
+  bool isOpen() const { return fd >= 0; }
+
+  /**
+   * @brief Size of the file: bytes kept at open plus bytes written
+   */
+  size_t size() const { return position + fill; }
+
+private:
+  bool reserve(size_t end);
+  void submit(size_t len);
+
+  int fd = -1;
+  string name;
+  uint8_t * buffers[2] = {NULL, NULL};
+  void * bufferFree[2] = {NULL, NULL}; // semaphores given back by the SD writer task
+  int current = 0;          // buffer being filled, owned by the caller
+  size_t fill = 0;          // bytes in the current buffer
+  size_t clean = 0;         // bytes of the current buffer already on the card
+  size_t position = 0;      // file offset of the current buffer (sector aligned)
+  size_t queued = 0;        // file position after the transfers handed to the task
+  size_t allocated = 0;     // file size reserved so far
+  size_t step = 0;          // preallocation step
+  volatile bool failed = false;
+  int64_t openTime = 0;
+  uint64_t written = 0;     // bytes of the file handed to the transfers
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Write a whole buffer to a new file (through a temporary writer)
+ *
+ * @return true on success
+ */
+bool saveBuffer(const string & path, const void * data, size_t len);
+
+/**
+ * @brief Totals of all the writers since boot
+ */
+SdWriterStats getSdWriterStats();
+
+/**
+ * @brief Log the totals of the writers (bytes, MB/s while transferring, stalls)
+ */
+void logSdWriterStats();
+
+#endif // __SDWRITER_HPP
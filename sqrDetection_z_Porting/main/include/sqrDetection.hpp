@@ -21,6 +21,9 @@
 #define EPS 192
 
 #include <stdlib.h>
+#include <limits.h>
+#include <array>
+#include <frameArena.hpp>
 
 /*------------------------------------------------------------------------------------------------*/
 // Namesapces
@@ -33,12 +36,18 @@ using namespace cv;
 /**
  * @brief Square object with a center and a colour:
  * center is stored as a point ([x,y])
- * colour is stored in BGR ([B,G,R])
+ * colour is stored in BGR ([B,G,R]), as a fixed 3-byte value
+ * subCenter and corners keep the geometry with sub-pixel accuracy (center is subCenter rounded)
+ * id and rotation identify binary markers (see decodeMarker), id is -1 if no marker was decoded
  */
 struct Square
 {
   Point center;
-  vector<unsigned int> colour;
+  Vec3b colour;
+  Point2f subCenter;
+  array<Point2f,4> corners;
+  int id = -1;
+  int rotation = 0;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -56,13 +65,40 @@ Point getCenter(vector<Point> & vertices);
  * @brief Get a Square object from a list of vertices
  * 
  * @param vertices list of square vertices
- * @param image image where the square is located
+ * @param image image where the square is located (BGR, see getColour)
  * @param highAccuracy if 0 low accuracy is used, if 1 better colour measurement is done
  * 
  * @return Square - square object with center and colour
  */
 Square getSquare(vector<Point> & vertices, Mat & image, bool highAccuracy = 0);
 
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Quadrilateral fitted to a contour by fitQuad
+ */
+struct QuadFit
+{
+  array<Point,4> corners; // vertices, in contour order
+  int area; // area enclosed by the contour, as contourArea
+  int perimeter; // length of the closed contour in 1/256 of pixel, as arcLength
+  bool convex; // true if the vertices make a convex quadrilateral
+};
+
+/**
+ * @brief Fit a quadrilateral to a closed contour, with integer arithmetic and no allocation.
+ *        The contour is simplified as approxPolyDP(contour, 0.02 * perimeter, true) does, giving up
+ *        as soon as too many vertices appear for the clean-up to leave four. The area and the
+ *        perimeter are measured in a single pass over the contour, before the simplification.
+ * 
+ * @param contour closed contour (e.g. from findContours or findEdgeContours)
+ * @param quad fitted quadrilateral, the fields are filled as far as the fit went
+ * @param minArea contours enclosing a smaller area are rejected before the simplification
+ * @param maxArea contours enclosing a larger area are rejected before the simplification
+ * 
+ * @return true if the contour simplifies to exactly four vertices making a convex quadrilateral
+ */
+bool fitQuad(const Contour & contour, QuadFit & quad, int minArea = 0, int maxArea = INT_MAX);
+
 /*------------------------------------------------------------------------------------------------*/
 /**
  * @brief Get the distance between two centers
@@ -88,12 +124,12 @@ int centerToCenter(Square & square1, Square & square2);
 /**
  * @brief Get the BGR Colour of a point in an image
  * 
- * @param image image where colour is going to be retrieved
+ * @param image image where colour is going to be retrieved (BGR, CV_8UC3)
  * @param point point of interest
- * @param bgrArray array where bgr colour is going to be stored
+ * @param bgr where the bgr colour is going to be stored
  * @param highAccuracy if 0 low accuracy is used, if 1 better colour measurement is done
  */
-void getColour(Mat & image, Point & point, vector<unsigned int> & bgrArray, bool highAccuracy = 0);
+void getColour(Mat & image, Point & point, Vec3b & bgr, bool highAccuracy = 0);
 
 /**
  * @brief Get the BGR Colour of a square in an image
@@ -104,6 +140,26 @@ void getColour(Mat & image, Point & point, vector<unsigned int> & bgrArray, bool
  */
 void getColour(Mat & image, Square & sqr, bool highAccuracy = 0);
 
+/**
+ * @brief Get the BGR Colour of a point in a YUYV frame (CV_8UC2 with the YUV422 layout of the
+ *        camera, not RGB565): only the sampled pixels are converted to colour
+ * 
+ * @param image YUYV frame
+ * @param point point of interest
+ * @param bgr where the bgr colour is going to be stored
+ * @param highAccuracy if 0 low accuracy is used, if 1 better colour measurement is done
+ */
+void getColourYUYV(Mat & image, Point & point, Vec3b & bgr, bool highAccuracy = 0);
+
+/**
+ * @brief Get the BGR Colour of a square in a YUYV frame
+ * 
+ * @param image YUYV frame
+ * @param sqr square in which colour is measured
+ * @param highAccuracy if 0 low accuracy is used, if 1 better colour measurement is done
+ */
+void getColourYUYV(Mat & image, Square & sqr, bool highAccuracy = 0);
+
 /*------------------------------------------------------------------------------------------------*/
 /**
  * @brief Check if two points are overlapping
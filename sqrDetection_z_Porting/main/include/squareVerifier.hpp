@@ -0,0 +1,101 @@
+/**
+ * @file squareVerifier.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the verification of the quadrilaterals found in the picture: their
+ *         geometry is scored in batch, so that only square-looking ones reach the colour stage,
+ *         and the corners of those are refined to sub-pixel accuracy.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __SQUAREVERIFIER_HPP
+#define __SQUAREVERIFIER_HPP
+
+#undef EPS // specreg.h defines EPS which interfere with opencv
+#pragma once
+#include <opencv2/core.hpp>
+#define EPS 192
+
+#include <array>
+
+/*------------------------------------------------------------------------------------------------*/
+// Namesapces
+using namespace std;
+using namespace cv;
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Quadrilateral candidates stored as structure of arrays (entry i of every vector belongs to
+ * candidate i), so that scoreQuads works on whole columns with plain loops the compiler can
+ * vectorise. Corners are in contour order.
+ */
+struct QuadBatch
+{
+  // Corners
+  vector<float> x[4];
+  vector<float> y[4];
+
+  // Filled by scoreQuads
+  vector<float> sideRatio; // shortest side / longest side
+  vector<float> angleCos; // largest |cos| of the corner angles (0 if all the corners are right)
+  vector<float> cx; // centroid of the enclosed area
+  vector<float> cy;
+  vector<float> score; // squareness: sideRatio * (1 - angleCos), 1 for a perfect square
+
+  size_t size() const { return x[0].size(); }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Add a candidate to a batch
+ *
+ * @param batch batch of candidates
+ * @param corners corners of the candidate, in contour order
+ */
+void addQuad(QuadBatch & batch, const array<Point,4> & corners);
+
+/**
+ * @brief Remove all the candidates of a batch (the memory is kept for the next frame)
+ *
+ * @param batch batch of candidates
+ */
+void clearQuads(QuadBatch & batch);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Measure side ratio, corner angles, centroid and squareness of all the candidates
+ *
+ * @param batch batch of candidates, the result vectors are filled
+ */
+void scoreQuads(QuadBatch & batch);
+
+/**
+ * @brief Select the candidates that look like squares
+ *
+ * @param batch batch of scored candidates
+ * @param minScore lowest squareness accepted
+ * @param accepted indices of the accepted candidates
+ */
+void verifyQuads(const QuadBatch & batch, float minScore, vector<unsigned int> & accepted);
+
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Move the corners of some candidates to the sub-pixel point where the image edges meet,
+ *        using the image gradients in a window around each corner. A corner is left where it is
+ *        when no corner is found in its window. The batch is scored again afterwards, so the
+ *        centroids follow the refined corners.
+ *
+ * @param batch batch of candidates
+ * @param selected indices of the candidates to refine (e.g. the ones accepted by verifyQuads)
+ * @param dx CV_16SC1 x derivative (Sobel) of the image the candidates were found in
+ * @param dy CV_16SC1 y derivative (Sobel) of the same image
+ * @param radius half size of the window around each corner, in pixels
+ *
+ * @return unsigned int - number of corners refined
+ */
+unsigned int refineQuads(QuadBatch & batch, const vector<unsigned int> & selected, const Mat & dx, const Mat & dy, int radius);
+
+#endif // __SQUAREVERIFIER_HPP
@@ -20,6 +20,12 @@
 #include <device.h>
 #include <detectSquares.hpp>
 #include <saveUtils.hpp>
+#include <matAllocator.hpp>
+#include <benchmark.hpp>
+#include <sceneGenerator.hpp>
+#include <frameCorpus.hpp>
+#include <sdWriter.hpp>
+#include <flightRecorder.hpp>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -28,6 +34,8 @@
 
 #include <iostream>
 #include <map>
+#include <stdio.h>
+#include <unistd.h>
 
 // tag used for ESP_LOGx functions
 #define TAG "main"
@@ -41,14 +49,8 @@
 #define PIC_NUMBER 1
 
 
-/**
- * PIXFORMAT_RGB565,    // 2BPP/RGB565
- * PIXFORMAT_YUV422,    // 2BPP/YUV422
- * PIXFORMAT_GRAYSCALE, // 1BPP/GRAYSCALE
- * PIXFORMAT_JPEG,      // JPEG/COMPRESSED
- * PIXFORMAT_RGB888,    // 3BPP/RGB888
- */
-#define CAMERA_PIXEL_FORMAT PIXFORMAT_RGB565
+// Capture mode (SINGLE_CAPTURE) and camera format (CAMERA_PIXEL_FORMAT): see detectSquares.hpp,
+// they also choose the detection pipelines compiled
 
 /*
  * FRAMESIZE_QQVGA,    // 160x120
@@ -65,6 +67,66 @@
  */
 #define CAMERA_FRAME_SIZE FRAMESIZE_SVGA
 
+// 1 -> the detection stages are timed on synthetic scenes instead of taking pictures, the results
+//      are written to /sdcard/bench.json (BENCHMARK_FILTER selects the stages by name)
+#ifndef RUN_BENCHMARKS
+#define RUN_BENCHMARKS 0
+#endif
+#ifndef BENCHMARK_FILTER
+#define BENCHMARK_FILTER ""
+#endif
+
+// 1 -> the self-test (the stages SELFTEST_ITERATIONS times on a synthetic frame, and the memory
+//      bandwidth) runs at every boot before the detection, its results go to /sdcard/selftest.json.
+//      Otherwise it runs once when a file named SELFTEST_TRIGGER is found on the SD card at boot.
+#ifndef RUN_SELFTEST
+#define RUN_SELFTEST 0
+#endif
+#ifndef SELFTEST_ITERATIONS
+#define SELFTEST_ITERATIONS 20
+#endif
+#ifndef SELFTEST_TRIGGER
+#define SELFTEST_TRIGGER "selftest.req"
+#endif
+
+// RUN_SCENES 1 -> the detection runs on SCENE_FRAMES synthetic frames instead of taking pictures (see
+// detectSquares.hpp)
+#ifndef SCENE_FRAMES
+#define SCENE_FRAMES 50
+#endif
+
+// 1 -> every camera frame is also appended, as it is, to /sdcard/frames.sqc (see frameCorpus.hpp)
+#ifndef RECORD_CORPUS
+#define RECORD_CORPUS 0
+#endif
+
+// 1 -> the last FLIGHT_RECORDER_FRAMES grayscale frames are kept compressed in PSRAM with their
+//      squares and stage timings, and dumped to /sdcard/flight<n>.rec when a frame misses squares.
+//      Fewer frames are kept when their compressed sizes do not fit in FLIGHT_RECORDER_SIZE bytes
+#ifndef FLIGHT_RECORDER
+#define FLIGHT_RECORDER 0
+#endif
+#ifndef FLIGHT_RECORDER_SIZE
+#define FLIGHT_RECORDER_SIZE (1024 * 1024)
+#endif
+#ifndef FLIGHT_RECORDER_FRAMES
+#define FLIGHT_RECORDER_FRAMES 8
+#endif
+#ifndef FLIGHT_COMPRESSION
+#define FLIGHT_COMPRESSION FLIGHT_DELTA_RLE
+#endif
+
+// A telemetry record (heaps, CPU load per core, stacks of the tasks) is logged every TELEMETRY_PERIOD
+// frames, 0 -> no telemetry
+#ifndef TELEMETRY_PERIOD
+#define TELEMETRY_PERIOD 1
+#endif
+
+// JPEG quality (1..100) of the archived camera frames when ARCHIVE_JPEG is enabled
+#ifndef ARCHIVE_QUALITY_FRAME
+#define ARCHIVE_QUALITY_FRAME 90
+#endif
+
 extern "C" {
   void app_main(void);
 }
@@ -89,6 +151,10 @@ void app_main(void)
 
   // Display some useful information about the system (heap left, stack high watermark)
   disp_infos();
+  start_telemetry(TELEMETRY_PERIOD);
+
+  // The Mat buffers are placed by size (small ones in internal DRAM) and counted per stage
+  installPlacementAllocator();
 
   /* Start the tasks */
   xTaskCreatePinnedToCore(main_Task, "main", 1024 * 9, nullptr, 24, nullptr, 0);
@@ -103,6 +169,50 @@ void main_Task(void *arg)
   // Create the base path for the pictures 
   string basePath = "/sdcard/";
 
+  // Speed of this board, to compare it with the others
+  string selfTestTrigger = basePath + SELFTEST_TRIGGER;
+  if(RUN_SELFTEST || access(selfTestTrigger.c_str(), F_OK) == 0)
+  {
+    vector<BenchmarkResult> stages;
+    vector<BandwidthResult> copies;
+    runSelfTest(stages, copies, SELFTEST_ITERATIONS);
+    if(saveSelfTest(stages, copies, basePath + "selftest.json"))
+      remove(selfTestTrigger.c_str());
+  }
+
+#if RUN_BENCHMARKS
+  // Timings of the stages instead of the detection
+  vector<BenchmarkResult> results;
+  runBenchmarks(results, BENCHMARK_FILTER);
+  saveBenchmarks(results, basePath + "bench.json");
+  vTaskDelete(NULL);
+  return;
+#endif
+
+#if RUN_SCENES
+  // Accuracy of both front-ends on the same scenes
+  SceneConfig scenes;
+  scenes.occlusions = 2;
+  for(const char * frontEnd : {"canny", "binarize"})
+  {
+    SceneScore score;
+    evaluateScenes(scenes, SCENE_FRAMES, frontEnd, score);
+  }
+  vTaskDelete(NULL);
+  return;
+#endif
+
+#if FLIGHT_RECORDER
+  // Frames that led to a detection failure, dumped by the detection
+  startFlightRecorder(FLIGHT_RECORDER_SIZE, FLIGHT_RECORDER_FRAMES, FLIGHT_COMPRESSION);
+#endif
+
+#if RECORD_CORPUS
+  // Frames with their sensor settings, to replay them on a PC
+  CorpusWriter corpus;
+  corpus.open(basePath + "frames.sqc");
+#endif
+
   // Main loop (take a picture, save it to the SD card, detect squares)
   for (int i = 0; i < PIC_NUMBER; i++)
   {
@@ -116,8 +226,17 @@ void main_Task(void *arg)
     }
 
     // Save the picture to the SD card 
-    savePicture(fb, basePath, "COL" + to_string(i));
+    savePicture(fb, basePath, "COL" + to_string(i), ARCHIVE_QUALITY_FRAME);
+#if RECORD_CORPUS
+    corpus.append(fb, i);
+#endif
 
+#if !SINGLE_CAPTURE
+    // Wait for the archived images before unmounting the SD card
+    flushArchive();
+#if RECORD_CORPUS
+    corpus.close();
+#endif
     // Deinit camera
     esp_camera_deinit();
     // Deinit sdcard
@@ -141,15 +260,27 @@ void main_Task(void *arg)
     }
 
     // Save the picture to the SD card
-    savePicture(fb, basePath, "PIC" + to_string(i));
+    savePicture(fb, basePath, "PIC" + to_string(i), ARCHIVE_QUALITY_FRAME);
+#if RECORD_CORPUS
+    corpus.open(basePath + "frames.sqc");
+    corpus.append(fb, i);
+#endif
+#endif
     
-    // Detect squares
+    // Detect squares (the frame buffer is given back to the driver by extractSquares)
     extractSquares(fb, EXPECTED_SQUARES, i, "result" + to_string(i) + ".txt", false);
-  
-    // Release the memory of the frame buffer if is not null
-    if (fb != NULL)
-      esp_camera_fb_return(fb);
+    // Memory used by each stage of the detection
+    logPlacementStats();
+    // Throughput of the SD card
+    logSdWriterStats();
+    // Memory and CPU load after the frame
+    sample_telemetry(i, NULL);
   }
+  // Wait for the archived images to be on the SD card
+  flushArchive();
+#if RECORD_CORPUS
+  corpus.close();
+#endif
   wait_msec(3000);
   vTaskDelete(NULL);
 }
@@ -0,0 +1,175 @@
+/**
+ * @file markerDecoder.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the decoding of binary markers.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <markerDecoder.hpp>
+#include <math.h>
+
+
+// Largest grid handled (cells per side, border included): the inner cells must fit in 64 bits
+#define MARKER_MAX_CELLS 10
+
+// Smallest difference between the darkest and the lightest cell of a marker
+#define MARKER_MIN_CONTRAST 30
+
+// Fractional bits of the fixed-point homography
+#define HOMOGRAPHY_SHIFT 12
+
+static const uint64_t markers4x4[32] = {
+  0x45b5, 0xc4c8, 0xb2ee, 0x5ba8, 0x8a9e, 0xfa13, 0x1ad7, 0xef35,
+  0xaa69, 0xa7af, 0x265a, 0x6075, 0xdb94, 0x544e, 0x9c23, 0x0fe7,
+  0xb840, 0xc930, 0x190a, 0x538f, 0x9ccf, 0x5de2, 0xa9fc, 0xbbe3,
+  0xf0dd, 0xbf64, 0xd2a1, 0x34a7, 0x7d38, 0x4e08, 0x098d, 0x6dc4,
+};
+
+const MarkerDictionary MARKERS_4X4_32 = {4, 2, 32, markers4x4};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Rounded num / den (den > 0)
+static inline int divRound(int32_t num, int32_t den)
+{
+  return num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+// Rotate a bits x bits grid a quarter turn clockwise
+static uint64_t rotateCode(uint64_t code, int bits)
+{
+  uint64_t rotated = 0;
+  for(int r=0; r<bits; r++)
+  {
+    for(int c=0; c<bits; c++)
+    {
+      if((code >> ((bits - 1 - c) * bits + r)) & 1)
+        rotated |= (uint64_t)1 << (r * bits + c);
+    }
+  }
+  return rotated;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Sample the cell centers of a cells x cells grid spread over the quadrilateral p (clockwise as seen
+// in the picture, p[0] top left). The projective map from the unit square to p is computed once in
+// floating point, then every sample costs a few integer products and two divisions: with u = U/2n,
+// v = V/2n (U, V odd, n cells) x = x0 + (A U + B V + C) / (G U + H V + 2n), and the same for y.
+static bool sampleGrid(const Mat & gray, const Point2f * p, int cells, uint8_t * samples)
+{
+  // Unit square to quadrilateral (Heckbert)
+  float sx = p[0].x - p[1].x + p[2].x - p[3].x;
+  float sy = p[0].y - p[1].y + p[2].y - p[3].y;
+  float dx1 = p[1].x - p[2].x, dx2 = p[3].x - p[2].x;
+  float dy1 = p[1].y - p[2].y, dy2 = p[3].y - p[2].y;
+  float den = dx1 * dy2 - dx2 * dy1;
+  if(fabsf(den) < 1.0f)
+    return false;
+  float g = (sx * dy2 - dx2 * sy) / den;
+  float h = (dx1 * sy - sx * dy1) / den;
+  float a = p[1].x - p[0].x + g * p[1].x, b = p[3].x - p[0].x + h * p[3].x;
+  float d = p[1].y - p[0].y + g * p[1].y, e = p[3].y - p[0].y + h * p[3].y;
+
+  // Fixed point, relative to the integer part of the first corner so that the terms stay small
+  const float one = (float)(1 << HOMOGRAPHY_SHIFT);
+  int x0 = (int)floorf(p[0].x), y0 = (int)floorf(p[0].y);
+  int32_t A = lrintf((a - x0 * g) * one), B = lrintf((b - x0 * h) * one);
+  int32_t C = lrintf(2 * cells * (p[0].x - x0) * one);
+  int32_t D = lrintf((d - y0 * g) * one), E = lrintf((e - y0 * h) * one);
+  int32_t F = lrintf(2 * cells * (p[0].y - y0) * one);
+  int32_t G = lrintf(g * one), H = lrintf(h * one), W = 2 * cells << HOMOGRAPHY_SHIFT;
+
+  for(int j=0; j<cells; j++)
+  {
+    int32_t V = 2 * j + 1;
+    for(int i=0; i<cells; i++)
+    {
+      int32_t U = 2 * i + 1;
+      int32_t w = G * U + H * V + W;
+      if(w <= 0)
+        return false;
+      int x = x0 + divRound(A * U + B * V + C, w);
+      int y = y0 + divRound(D * U + E * V + F, w);
+      *samples++ = gray.ptr<uint8_t>(y)[x];
+    }
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool decodeMarker(const Mat & gray, const array<Point2f,4> & corners, const MarkerDictionary & dictionary, int & id, int & rotation)
+{
+  int bits = dictionary.bits, cells = bits + 2;
+  uint8_t samples[MARKER_MAX_CELLS * MARKER_MAX_CELLS];
+
+  if(cells > MARKER_MAX_CELLS)
+    return false;
+
+  // Corners clockwise as seen in the picture (y down), all inside the image: the quadrilateral is
+  // convex, so every sample is inside too
+  Point2f p[4] = {corners[0], corners[1], corners[2], corners[3]};
+  float area2 = 0;
+  for(int k=0; k<4; k++)
+  {
+    if(p[k].x < 0 || p[k].y < 0 || p[k].x > gray.cols - 1 || p[k].y > gray.rows - 1)
+      return false;
+    area2 += p[k].x * p[(k + 1) & 3].y - p[(k + 1) & 3].x * p[k].y;
+  }
+  if(area2 < 0)
+    swap(p[1], p[3]);
+
+  if(!sampleGrid(gray, p, cells, samples))
+    return false;
+
+  // Black and white split halfway between the darkest and the lightest cell
+  int darkest = 255, lightest = 0;
+  for(int k=0; k<cells*cells; k++)
+  {
+    darkest = min(darkest, (int)samples[k]);
+    lightest = max(lightest, (int)samples[k]);
+  }
+  if(lightest - darkest < MARKER_MIN_CONTRAST)
+    return false;
+  int threshold = (darkest + lightest) / 2;
+
+  // The border must be black, the inner cells are packed in a word (bit r*bits+c, 1 if white)
+  uint64_t code = 0;
+  for(int r=0; r<cells; r++)
+  {
+    for(int c=0; c<cells; c++)
+    {
+      bool white = samples[r * cells + c] > threshold;
+      bool border = r == 0 || c == 0 || r == cells - 1 || c == cells - 1;
+      if(border && white)
+        return false;
+      if(!border && white)
+        code |= (uint64_t)1 << ((r - 1) * bits + (c - 1));
+    }
+  }
+
+  // Closest marker in any rotation: the Hamming distance is the number of bits set in the XOR
+  int best = dictionary.maxErrors + 1;
+  for(int turn=0; turn<4; turn++)
+  {
+    for(int i=0; i<dictionary.size; i++)
+    {
+      int distance = __builtin_popcountll(code ^ dictionary.codes[i]);
+      if(distance < best)
+      {
+        best = distance;
+        id = i;
+        // The grid turned clockwise `turn` times matches: the marker is turned the other way
+        rotation = (4 - turn) & 3;
+      }
+    }
+    code = rotateCode(code, bits);
+  }
+
+  return best <= dictionary.maxErrors;
+}
@@ -0,0 +1,287 @@
+/**
+ * @file matAllocator.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the placement of the Mat buffers.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <matAllocator.hpp>
+#include <esp_log.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#ifdef ESP_PLATFORM
+#include <sdkconfig.h>
+#include <esp_heap_caps.h>
+#endif
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "matAllocator";
+
+// Default limits: the ones malloc follows when it may use the PSRAM (CONFIG_SPIRAM_USE_MALLOC)
+#ifdef CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL
+#define PLACEMENT_INTERNAL_MAX CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL
+#else
+#define PLACEMENT_INTERNAL_MAX 16384
+#endif
+#ifdef CONFIG_SPIRAM_MALLOC_RESERVE_INTERNAL
+#define PLACEMENT_INTERNAL_RESERVE CONFIG_SPIRAM_MALLOC_RESERVE_INTERNAL
+#else
+#define PLACEMENT_INTERNAL_RESERVE 32768
+#endif
+
+// Step given by the caller that must be computed (the value of the C API)
+#define STEP_AUTO 0x7fffffff
+
+// Number of tags with their own statistics (the next ones are counted as untagged)
+#define PLACEMENT_MAX_TAGS 16
+
+// Stored in front of every buffer, so that placementFree knows what to update (16 bytes, so the
+// buffer keeps the alignment of the block)
+struct BlockHeader
+{
+  uint32_t size;
+  uint16_t tag;
+  uint8_t place;
+  uint8_t unused[9];
+};
+
+// Statistics and rule of every tag, entry 0 is for the untagged buffers
+struct TagEntry
+{
+  PlacementStats stats;
+  MemoryPlace rule;
+};
+
+static TagEntry tags[PLACEMENT_MAX_TAGS] = {{{"untagged", 0, 0, {0, 0}, {0, 0}}, PLACE_AUTO}};
+static int tagCount = 1;
+static size_t internalMax = PLACEMENT_INTERNAL_MAX;
+static size_t internalReserve = PLACEMENT_INTERNAL_RESERVE;
+static mutex statsLock;
+
+// Tag of the calling task
+static __thread const char * currentTag = NULL;
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Entry of a tag, added if new (statsLock held)
+static int findTag(const char * tag)
+{
+  if(tag == NULL)
+    return 0;
+
+  for(int i=1; i<tagCount; i++)
+  {
+    if(strcmp(tags[i].stats.tag, tag) == 0)
+      return i;
+  }
+  if(tagCount == PLACEMENT_MAX_TAGS)
+    return 0;
+
+  tags[tagCount].stats = {tag, 0, 0, {0, 0}, {0, 0}};
+  tags[tagCount].rule = PLACE_AUTO;
+  return tagCount++;
+}
+
+// Allocate a block in the wanted region, or in the other one if it is full (place is updated)
+static void * regionMalloc(size_t size, MemoryPlace & place)
+{
+#ifdef ESP_PLATFORM
+  void * block = NULL;
+  if(place == PLACE_INTERNAL && heap_caps_get_free_size(MALLOC_CAP_INTERNAL) >= size + internalReserve)
+    block = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if(block == NULL)
+  {
+    block = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    place = PLACE_PSRAM;
+  }
+  if(block == NULL)
+  {
+    block = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    place = PLACE_INTERNAL;
+  }
+  return block;
+#else
+  // Host: a single heap, the placement is only recorded
+  return malloc(size);
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void * placementMalloc(size_t size)
+{
+  int tag;
+  MemoryPlace place;
+  {
+    lock_guard<mutex> guard(statsLock);
+    tag = findTag(currentTag);
+    place = tags[tag].rule;
+  }
+  if(place == PLACE_AUTO)
+    place = size <= internalMax ? PLACE_INTERNAL : PLACE_PSRAM;
+
+  MemoryPlace wanted = place;
+  BlockHeader * header = (BlockHeader *)regionMalloc(sizeof(BlockHeader) + size, place);
+  if(header == NULL)
+    return NULL;
+  header->size = size;
+  header->tag = tag;
+  header->place = place;
+
+  // Statistics: index 0 DRAM, 1 PSRAM
+  int region = place == PLACE_PSRAM;
+  lock_guard<mutex> guard(statsLock);
+  PlacementStats & stats = tags[tag].stats;
+  stats.allocations++;
+  stats.fallbacks += place != wanted;
+  stats.current[region] += size;
+  stats.peak[region] = max(stats.peak[region], stats.current[region]);
+
+  return header + 1;
+}
+
+void placementFree(void * ptr)
+{
+  if(ptr == NULL)
+    return;
+
+  BlockHeader * header = (BlockHeader *)ptr - 1;
+  int region = header->place == PLACE_PSRAM;
+  {
+    lock_guard<mutex> guard(statsLock);
+    tags[header->tag].stats.current[region] -= header->size;
+  }
+#ifdef ESP_PLATFORM
+  heap_caps_free(header);
+#else
+  free(header);
+#endif
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char * setPlacementTag(const char * tag)
+{
+  const char * previous = currentTag;
+  currentTag = tag;
+  return previous;
+}
+
+void setPlacementRule(const char * tag, MemoryPlace place)
+{
+  lock_guard<mutex> guard(statsLock);
+  int i = findTag(tag);
+  if(i > 0)
+    tags[i].rule = place;
+}
+
+void setPlacementLimits(size_t maxSize, size_t reserve)
+{
+  internalMax = maxSize;
+  internalReserve = reserve;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void getPlacementStats(vector<PlacementStats> & stats)
+{
+  lock_guard<mutex> guard(statsLock);
+  stats.clear();
+  for(int i=0; i<tagCount; i++)
+    stats.push_back(tags[i].stats);
+}
+
+void resetPlacementPeaks()
+{
+  lock_guard<mutex> guard(statsLock);
+  for(int i=0; i<tagCount; i++)
+  {
+    tags[i].stats.peak[0] = tags[i].stats.current[0];
+    tags[i].stats.peak[1] = tags[i].stats.current[1];
+  }
+}
+
+void logPlacementStats()
+{
+  vector<PlacementStats> stats;
+  getPlacementStats(stats);
+
+  for(unsigned int i=0; i<stats.size(); i++)
+  {
+    ESP_LOGI(TAG, "%-10s %5u allocs %3u fallbacks | DRAM %7u peak %7u | PSRAM %8u peak %8u",
+             stats[i].tag, stats[i].allocations, stats[i].fallbacks,
+             (unsigned int)stats[i].current[0], (unsigned int)stats[i].peak[0],
+             (unsigned int)stats[i].current[1], (unsigned int)stats[i].peak[1]);
+  }
+}
+
+// ============================================= ALLOCATOR =========================================
+
+// Same layout as the OpenCV standard allocator (continuous data, steps of the last dimension
+// first), only the buffer comes from placementMalloc
+UMatData * PlacementAllocator::allocate(int dims, const int * sizes, int type, void * data, size_t * step, AccessFlag, UMatUsageFlags) const
+{
+  size_t total = CV_ELEM_SIZE(type);
+  for(int i = dims - 1; i >= 0; i--)
+  {
+    if(step)
+    {
+      if(data && step[i] != STEP_AUTO)
+      {
+        CV_Assert(total <= step[i]);
+        total = step[i];
+      }
+      else
+      {
+        step[i] = total;
+      }
+    }
+    total *= sizes[i];
+  }
+
+  uchar * buffer = data ? (uchar *)data : (uchar *)placementMalloc(total);
+  if(buffer == NULL)
+    CV_Error(Error::StsNoMem, "Mat buffer allocation failed");
+
+  UMatData * u = new UMatData(this);
+  u->data = u->origdata = buffer;
+  u->size = total;
+  if(data)
+    u->flags |= UMatData::USER_ALLOCATED;
+  return u;
+}
+
+bool PlacementAllocator::allocate(UMatData * data, AccessFlag, UMatUsageFlags) const
+{
+  return data != NULL;
+}
+
+void PlacementAllocator::deallocate(UMatData * data) const
+{
+  if(data == NULL)
+    return;
+
+  CV_Assert(data->urefcount == 0);
+  CV_Assert(data->refcount == 0);
+  if(!(data->flags & UMatData::USER_ALLOCATED))
+  {
+    placementFree(data->origdata);
+    data->origdata = 0;
+  }
+  delete data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void installPlacementAllocator()
+{
+  static PlacementAllocator allocator;
+  Mat::setDefaultAllocator(&allocator);
+}
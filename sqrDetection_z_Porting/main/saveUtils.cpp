@@ -11,10 +11,38 @@
 // ============================================= CODE ==============================================
 
 #include <saveUtils.hpp>
+#include <sdWriter.hpp>
+#include <img_converters.h>
+#include <esp_timer.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 
 // tag used for ESP_LOGx functions
 static const char *TAG = "saveUtils";
 
+// Archive task: stack, priority, core (the detection runs on core 0) and queued images.
+// Every image handed to the task is a copy: at most ARCHIVE_QUEUE_LEN of them exist at a time, the
+// one being encoded included, a caller finding them all in use waits before copying.
+#ifndef ARCHIVE_TASK_STACK
+#define ARCHIVE_TASK_STACK (1024 * 6)
+#endif
+#ifndef ARCHIVE_TASK_PRIORITY
+#define ARCHIVE_TASK_PRIORITY 5
+#endif
+#ifndef ARCHIVE_TASK_CORE
+#define ARCHIVE_TASK_CORE 1
+#endif
+#ifndef ARCHIVE_QUEUE_LEN
+#define ARCHIVE_QUEUE_LEN 3
+#endif
+// part of the image size preallocated for its JPEG file (the end not used is cut at close)
+#ifndef ARCHIVE_PREALLOCATE_DIV
+#define ARCHIVE_PREALLOCATE_DIV 4
+#endif
+
 // ============================================= MAT ===============================================
 /*------------------------------------------------------------------------------------------------*/
 
@@ -71,23 +99,13 @@ bool Mat2bmp(Mat & img, string path, string name)
     name.append(".bmp");
   }
   string picName = path + name;
-  // open file for writing
-  FILE *file = fopen((char*)picName.c_str(), "wb");
-  if (file == NULL)
-  {
-    // error opening file for writing
-    ESP_LOGE(TAG, "Saving Error : Failed to open file for writing");
-    return false;
-  }
   // write the buffer to the file
-  fwrite(bmp_buf, 1, bmp_buf_len, file);
-  fclose(file);
-  ESP_LOGI(TAG, "File saved as %s", (char*)picName.c_str());
+  bool saved = saveBuffer(picName, bmp_buf, bmp_buf_len);
 
   // deallocate the memory used by bmp_buf
   free(bmp_buf);
 
-  return true;  
+  return saved;
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -99,27 +117,279 @@ bool saveRawMat(Mat &image, string path, string name)
   {
     name.append(".raw");
   }
-  // open file for writing
+  // write the pixels as they are
   string picName = path + name;
-  FILE *file = fopen((char*)picName.c_str() , "wb");
-  if (file == NULL) {
-    ESP_LOGE(TAG, "Failed to open file for writing");
+  return saveBuffer(picName, image.data, image.total() * image.elemSize());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool saveStage(Mat &img, string path, string name, uint8_t quality)
+{
+#if ARCHIVE_JPEG
+  return Mat2jpg(img, path, name, quality);
+#else
+  bool saved = Mat2bmp(img, path, name);
+  saveRawMat(img, path, name);
+  return saved;
+#endif
+}
+
+// ============================================= ARCHIVE ===========================================
+/*------------------------------------------------------------------------------------------------*/
+/**
+ * @brief Image queued to the archive task (a flush request if done is not NULL)
+ */
+typedef struct {
+  Mat image; // private copy of the image
+  pixformat_t format; // format of the image data
+  string fileName; // path and name of the jpg file
+  uint8_t quality; // JPEG quality
+  SemaphoreHandle_t done; // given by the task when a flush request is reached
+} archiveJob;
+
+/**
+ * @brief Output file of a JPEG being encoded
+ */
+typedef struct {
+  SdWriter * writer;
+  size_t written; // bytes written so far
+  bool failed; // true if a write failed
+} archiveFile;
+
+// queue of archiveJob pointers, NULL until the task is started
+static QueueHandle_t archiveQueue = NULL;
+
+// copies of images the archive may still hold: taken before copying, given back once encoded
+static SemaphoreHandle_t archiveSlots = NULL;
+
+// writer of the archive task, its buffers are kept from one file to the next
+static SdWriter archiveWriter;
+
+/*------------------------------------------------------------------------------------------------*/
+// static function used by the encoder to write each chunk of the JPEG to the file
+static size_t archiveWrite(void * arg, size_t index, const void * data, size_t len)
+{
+  archiveFile * out = (archiveFile *)arg;
+  // data is null at the end of the image, nothing left to write after a failure
+  if(data == NULL || out->failed)
+  {
+    return 0;
+  }
+  if(!out->writer->write(data, len))
+  {
+    out->failed = true;
+    return 0;
+  }
+  out->written += len;
+  return len;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// static function used to encode an image and stream it to its file
+static void archiveEncode(archiveJob * job)
+{
+  archiveFile out = {&archiveWriter, 0, false};
+  size_t bytes = job->image.total() * job->image.elemSize();
+  if(!archiveWriter.open(job->fileName, bytes / ARCHIVE_PREALLOCATE_DIV))
+  {
+    ESP_LOGE(TAG, "Saving Error : Failed to open %s for writing", (char*)job->fileName.c_str());
+    return;
+  }
+
+  // encode the image line by line, the encoder hands every chunk to archiveWrite
+  int64_t start = esp_timer_get_time();
+  bool encoded = fmt2jpg_cb(job->image.data, bytes, job->image.cols, job->image.rows, job->format, job->quality,
+                            archiveWrite, &out);
+  if(!archiveWriter.close())
+  {
+    out.failed = true;
+  }
+  int64_t elapsed = esp_timer_get_time() - start;
+
+  if(!encoded || out.failed)
+  {
+    ESP_LOGE(TAG, "Saving Error : Failed to encode %s", (char*)job->fileName.c_str());
+    return;
+  }
+  ESP_LOGI(TAG, "File saved as %s (q%u, %u bytes, %u ms)", (char*)job->fileName.c_str(),
+           (unsigned)job->quality, (unsigned)out.written, (unsigned)(elapsed / 1000));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// archive task: encodes the queued images one by one
+static void archiveTask(void *arg)
+{
+  archiveJob * job;
+  for(;;)
+  {
+    if(xQueueReceive(archiveQueue, &job, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+    // a flush request is owned by the caller waiting on it
+    if(job->done != NULL)
+    {
+      xSemaphoreGive(job->done);
+      continue;
+    }
+    archiveEncode(job);
+    delete job;
+    xSemaphoreGive(archiveSlots);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool startArchive()
+{
+  if(archiveQueue != NULL)
+  {
+    return true;
+  }
+  archiveQueue = xQueueCreate(ARCHIVE_QUEUE_LEN, sizeof(archiveJob *));
+  if(archiveQueue == NULL)
+  {
+    ESP_LOGE(TAG, "Archive queue creation failed");
+    return false;
+  }
+  archiveSlots = xSemaphoreCreateCounting(ARCHIVE_QUEUE_LEN, ARCHIVE_QUEUE_LEN);
+  if(archiveSlots == NULL)
+  {
+    ESP_LOGE(TAG, "Archive semaphore creation failed");
+    vQueueDelete(archiveQueue);
+    archiveQueue = NULL;
+    return false;
+  }
+  if(xTaskCreatePinnedToCore(archiveTask, "archive", ARCHIVE_TASK_STACK, nullptr, ARCHIVE_TASK_PRIORITY, nullptr,
+                             ARCHIVE_TASK_CORE) != pdPASS)
+  {
+    ESP_LOGE(TAG, "Archive task creation failed");
+    vSemaphoreDelete(archiveSlots);
+    archiveSlots = NULL;
+    vQueueDelete(archiveQueue);
+    archiveQueue = NULL;
+    return false;
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+// static function used to hand a copy of an image to the archive task
+static bool archiveQueueImage(const Mat & image, pixformat_t format, string fileName, uint8_t quality)
+{
+  if(!startArchive())
+  {
+    return false;
+  }
+  // waits while ARCHIVE_QUEUE_LEN copies are queued or being encoded, before making one more
+  xSemaphoreTake(archiveSlots, portMAX_DELAY);
+  archiveJob * job = new archiveJob();
+  // copy the image (continuous, as the encoder expects)
+  image.copyTo(job->image);
+  if(job->image.empty())
+  {
+    ESP_LOGE(TAG, "Saving Error : Failed to copy %s", (char*)fileName.c_str());
+    delete job;
+    xSemaphoreGive(archiveSlots);
+    return false;
+  }
+  job->format = format;
+  job->fileName = fileName;
+  job->quality = quality;
+  job->done = NULL;
+  // a slot is held, so only a flush request can keep the queue full for a moment
+  xQueueSend(archiveQueue, &job, portMAX_DELAY);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool Mat2jpg(Mat & img, string path, string name, uint8_t quality)
+{
+  // get the format of the image from the Mat type
+  pixformat_t format;
+  if(img.type() == CV_8UC1)
+  {
+    format = PIXFORMAT_GRAYSCALE;
+  }
+  else if(img.type() == CV_8UC2)
+  {
+    format = PIXFORMAT_RGB565;
+  }
+  else if(img.type() == CV_8UC3)
+  {
+    // the encoder reads 3 bytes pixels in BGR order, as OpenCV stores them
+    format = PIXFORMAT_RGB888;
+  }
+  else
+  {
+    // error if the format is not supported
+    ESP_LOGE(TAG, "Saving Error : Unknown format");
+    return false;
   }
-  else{
-    fwrite((char*)image.data, 1, image.total() * image.elemSize(), file);
-    fclose(file);
-    ESP_LOGI(TAG, "File saved as %s", (char*)picName.c_str());
+
+  // check if the extension is already present in the last 4 characters of the name
+  if (name.substr(name.length() - 4, 4) != ".jpg")
+  {
+    name.append(".jpg");
   }
-  return 0;
+  return archiveQueueImage(img, format, path + name, quality);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void flushArchive()
+{
+  if(archiveQueue == NULL)
+  {
+    return;
+  }
+  // the request is reached once every image queued before it has been written
+  archiveJob flush;
+  flush.done = xSemaphoreCreateBinary();
+  if(flush.done == NULL)
+  {
+    ESP_LOGE(TAG, "Archive flush failed");
+    return;
+  }
+  archiveJob * job = &flush;
+  xQueueSend(archiveQueue, &job, portMAX_DELAY);
+  xSemaphoreTake(flush.done, portMAX_DELAY);
+  vSemaphoreDelete(flush.done);
 }
 
 // ============================================= PICTURE ===========================================
 /*------------------------------------------------------------------------------------------------*/
 
-bool savePicture(camera_fb_t *pic, string path, string name)
+bool savePicture(camera_fb_t *pic, string path, string name, uint8_t quality)
 {
+#if ARCHIVE_JPEG
+  // JPEG frames are already compressed: write them as they are
+  if(pic->format == PIXFORMAT_JPEG)
+  {
+    if (name.substr(name.length() - 4, 4) != ".jpg")
+    {
+      name.append(".jpg");
+    }
+    string picName = path + name;
+    return saveBuffer(picName, pic->buf, pic->len);
+  }
+  // other formats are copied and encoded by the archive task
+  if(pic->format == PIXFORMAT_GRAYSCALE || pic->format == PIXFORMAT_RGB565 || pic->format == PIXFORMAT_YUV422)
+  {
+    if (name.substr(name.length() - 4, 4) != ".jpg")
+    {
+      name.append(".jpg");
+    }
+    Mat frame(pic->height, pic->width, pic->format == PIXFORMAT_GRAYSCALE ? CV_8UC1 : CV_8UC2, pic->buf);
+    return archiveQueueImage(frame, pic->format, path + name, quality);
+  }
+#endif
+
   // save jpeg without creating the bmp header
-  if(pic->format == PIXFORMAT_JPEG || pic->format == PIXFORMAT_GRAYSCALE || pic->format == PIXFORMAT_RGB565)
+  if(pic->format == PIXFORMAT_JPEG || pic->format == PIXFORMAT_GRAYSCALE || pic->format == PIXFORMAT_RGB565 ||
+     pic->format == PIXFORMAT_YUV422)
   {  
     // Log the format of the picture using a switch case
     switch (pic->format)
@@ -130,6 +400,9 @@ bool savePicture(camera_fb_t *pic, string path, string name)
     case PIXFORMAT_GRAYSCALE:
       ESP_LOGI(TAG, "Image format: GRAYSCALE");
       break;
+    case PIXFORMAT_YUV422:
+      ESP_LOGI(TAG, "Image format: YUV422");
+      break;
    default:
       ESP_LOGI(TAG, "Image format: RGB565");
       break;
@@ -149,23 +422,12 @@ bool savePicture(camera_fb_t *pic, string path, string name)
         name.append(".bmp");
       }
       string picName = path + name;
-      // open file for writing
-      FILE *file = fopen((char*)picName.c_str(), "wb");
-      if (file == NULL)
-      {
-        // error opening file for writing
-        ESP_LOGE(TAG, "Saving Error : Failed to open file for writing");
-        free(bmp_buf);
-        return false;
-      }
       // write the buffer to the file
-      fwrite(bmp_buf, 1, bmp_buf_len, file);
-      fclose(file);
-      ESP_LOGI(TAG, "File saved as %s", (char*)picName.c_str());
+      bool saved = saveBuffer(picName, bmp_buf, bmp_buf_len);
 
       // deallocate the memory used by bmp_buf 
       free(bmp_buf);
-      return true;
+      return saved;
     }
     else
     {
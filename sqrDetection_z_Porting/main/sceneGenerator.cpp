@@ -0,0 +1,389 @@
+/**
+ * @file sceneGenerator.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the generator of synthetic scenes.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <sceneGenerator.hpp>
+#include <detectSquares.hpp>
+#include <markerDecoder.hpp>
+#include <opencv2/imgproc.hpp>
+#include <esp_log.h>
+#include <string.h>
+#include <math.h>
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "sceneGenerator";
+
+// Colours of the coloured squares (BGR)
+static const Vec3b PALETTE[] = {{40, 40, 200}, {50, 170, 50}, {190, 80, 30}, {30, 200, 220}, {170, 50, 160}, {30, 120, 240}};
+
+// White margin of the board around the markers, as a fraction of the marker side
+#define BOARD_MARGIN 0.5f
+
+// Largest part of the frame the board takes (before the perspective)
+#define BOARD_FILL 0.85f
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Keyboard key: rounded cap with a letter on it
+static void drawKey(Mat & bgr, Point origin, int side, RNG & rng)
+{
+  int radius = side / 6;
+  Scalar cap = Scalar::all(rng.uniform(20, 90));
+  Scalar rim = Scalar::all(rng.uniform(100, 160));
+
+  rectangle(bgr, Rect(origin.x + radius, origin.y, side - 2 * radius, side), cap, FILLED);
+  rectangle(bgr, Rect(origin.x, origin.y + radius, side, side - 2 * radius), cap, FILLED);
+  for(int k = 0; k < 4; k++)
+  {
+    Point corner(origin.x + (k & 1 ? side - radius : radius), origin.y + (k & 2 ? side - radius : radius));
+    circle(bgr, corner, radius, cap, FILLED, LINE_AA);
+  }
+  line(bgr, Point(origin.x + radius, origin.y + side), Point(origin.x + side - radius, origin.y + side), rim, 2);
+
+  char letter[2] = {(char)('A' + rng.uniform(0, 26)), 0};
+  putText(bgr, letter, Point(origin.x + side / 4, origin.y + side * 2 / 3), FONT_HERSHEY_SIMPLEX, side / 60.0,
+          Scalar::all(230), max(1, side / 25), LINE_AA);
+}
+
+// Shapes around the board: rows of keys, outlines and lines
+static void drawDistractors(Mat & bgr, int count, RNG & rng)
+{
+  for(int i = 0; i < count; i++)
+  {
+    Point p(rng.uniform(0, bgr.cols), rng.uniform(0, bgr.rows));
+    int size = rng.uniform(24, 72);
+    Scalar shade(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+    switch(rng.uniform(0, 4))
+    {
+      case 0:
+      {
+        // A few keys in a row, as on a keyboard
+        int keys = rng.uniform(1, 5);
+        for(int k = 0; k < keys; k++)
+          drawKey(bgr, Point(p.x + k * size * 9 / 8, p.y), size, rng);
+        break;
+      }
+      case 1:
+        rectangle(bgr, Rect(p.x, p.y, size, rng.uniform(24, 72)), shade, 2, LINE_AA);
+        break;
+      case 2:
+        circle(bgr, p, size / 2, shade, rng.uniform(0, 2) ? FILLED : 2, LINE_AA);
+        break;
+      default:
+        line(bgr, p, Point(p.x + rng.uniform(-3 * size, 3 * size), p.y + rng.uniform(-3 * size, 3 * size)), shade, 2, LINE_AA);
+        break;
+    }
+  }
+}
+
+// Quadrilateral of the board plane, in the image
+static void fillProjected(Mat & bgr, const Mat & homography, const vector<Point2f> & quad, const Scalar & colour)
+{
+  vector<Point2f> image;
+  perspectiveTransform(quad, image, homography);
+  Point points[4];
+  for(int k = 0; k < 4; k++)
+    points[k] = Point(cvRound(image[k].x * 16), cvRound(image[k].y * 16));
+  fillConvexPoly(bgr, points, 4, colour, LINE_AA, 4);
+}
+
+static vector<Point2f> square(float x, float y, float side)
+{
+  return {Point2f(x, y), Point2f(x + side, y), Point2f(x + side, y + side), Point2f(x, y + side)};
+}
+
+// Binary marker: black square with the white cells of its code
+static void drawMarker(Mat & bgr, const Mat & homography, float x, float y, float side, int id)
+{
+  const MarkerDictionary & dictionary = MARKERS_4X4_32;
+  int cells = dictionary.bits + 2;
+  float cell = side / cells;
+
+  fillProjected(bgr, homography, square(x, y, side), Scalar::all(0));
+  for(int r = 0; r < dictionary.bits; r++)
+  {
+    for(int c = 0; c < dictionary.bits; c++)
+    {
+      if(dictionary.codes[id] >> (r * dictionary.bits + c) & 1)
+        fillProjected(bgr, homography, square(x + (c + 1) * cell, y + (r + 1) * cell, cell), Scalar::all(255));
+    }
+  }
+}
+
+// Brightness falling linearly across the frame, in a random direction
+static void applyLighting(Mat & bgr, float amount, RNG & rng)
+{
+  if(amount <= 0)
+    return;
+
+  float angle = rng.uniform(0.f, (float)(2 * CV_PI));
+  float gx = cosf(angle) / bgr.cols, gy = sinf(angle) / bgr.rows;
+  float offset = -min(0.f, gx * bgr.cols) - min(0.f, gy * bgr.rows);
+  float span = fabsf(gx * bgr.cols) + fabsf(gy * bgr.rows);
+
+  for(int y = 0; y < bgr.rows; y++)
+  {
+    uint8_t * row = bgr.ptr<uint8_t>(y);
+    for(int x = 0; x < bgr.cols; x++)
+    {
+      float gain = 1 - amount * (gx * x + gy * y + offset) / span;
+      for(int k = 0; k < 3; k++)
+        row[3 * x + k] = (uint8_t)(row[3 * x + k] * gain);
+    }
+  }
+}
+
+// YUYV (studio range BT.601, as the camera), chroma of each pair of pixels averaged
+static void bgrToYuyv(const Mat & bgr, uint8_t * yuyv)
+{
+  for(int y = 0; y < bgr.rows; y++)
+  {
+    const uint8_t * p = bgr.ptr<uint8_t>(y);
+    for(int x = 0; x + 1 < bgr.cols; x += 2, p += 6, yuyv += 4)
+    {
+      int b = p[0] + p[3], g = p[1] + p[4], r = p[2] + p[5];
+      yuyv[0] = (uint8_t)(16 + ((66 * p[2] + 129 * p[1] + 25 * p[0] + 128) >> 8));
+      yuyv[2] = (uint8_t)(16 + ((66 * p[5] + 129 * p[4] + 25 * p[3] + 128) >> 8));
+      yuyv[1] = (uint8_t)(128 + ((-38 * r - 74 * g + 112 * b + 256) >> 9));
+      yuyv[3] = (uint8_t)(128 + ((112 * r - 94 * g - 18 * b + 256) >> 9));
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+SceneGenerator::SceneGenerator(const SceneConfig & config) : config(config)
+{
+}
+
+bool SceneGenerator::next(camera_fb_t & fb, vector<MarkerTruth> & truth)
+{
+  const SceneConfig & c = config;
+  RNG rng(c.seed * 0x9E3779B97F4A7C15ULL + frameIndex);
+  truth.clear();
+
+  // Desk with its clutter
+  bgr.create(c.height, c.width, CV_8UC3);
+  bgr.setTo(Scalar(rng.uniform(140, 190), rng.uniform(140, 190), rng.uniform(140, 190)));
+  drawDistractors(bgr, c.distractors, rng);
+
+  // Board seen from the front, scaled to fit the frame
+  float margin = c.markerSide * BOARD_MARGIN;
+  float boardWidth = (c.cols - 1) * c.markerStep + c.markerSide + 2 * margin;
+  float boardHeight = (c.rows - 1) * c.markerStep + c.markerSide + 2 * margin;
+  float scale = min(1.f, BOARD_FILL * min(c.width / boardWidth, c.height / boardHeight));
+
+  // Pose: rotation about the frame center, then each corner moved for the perspective
+  float angle = rng.uniform(-c.rotation, c.rotation) * (float)CV_PI / 180;
+  float jitter = c.perspective * max(boardWidth, boardHeight) * scale;
+  vector<Point2f> board = {Point2f(0, 0), Point2f(boardWidth, 0), Point2f(boardWidth, boardHeight), Point2f(0, boardHeight)};
+  Point2f image[4], center(c.width / 2.f, c.height / 2.f);
+  for(int k = 0; k < 4; k++)
+  {
+    Point2f p = (board[k] - Point2f(boardWidth / 2, boardHeight / 2)) * scale;
+    image[k] = center + Point2f(p.x * cosf(angle) - p.y * sinf(angle), p.x * sinf(angle) + p.y * cosf(angle));
+    image[k] += Point2f(rng.uniform(-jitter, jitter), rng.uniform(-jitter, jitter));
+  }
+  Mat homography = getPerspectiveTransform(board.data(), image);
+
+  // Board and markers
+  fillProjected(bgr, homography, board, Scalar::all(rng.uniform(215, 250)));
+  for(int r = 0; r < c.rows; r++)
+  {
+    for(int col = 0; col < c.cols; col++)
+    {
+      float x = margin + col * c.markerStep, y = margin + r * c.markerStep;
+      MarkerTruth marker;
+      marker.id = -1;
+      marker.occluded = false;
+      if(c.binaryMarkers)
+      {
+        marker.id = (int)((r * c.cols + col + frameIndex) % MARKERS_4X4_32.size);
+        marker.colour = Vec3b(0, 0, 0);
+        drawMarker(bgr, homography, x, y, c.markerSide, marker.id);
+      }
+      else
+      {
+        marker.colour = PALETTE[rng.uniform(0, (int)(sizeof(PALETTE) / sizeof(PALETTE[0])))];
+        fillProjected(bgr, homography, square(x, y, c.markerSide), Scalar(marker.colour));
+      }
+
+      vector<Point2f> corners;
+      perspectiveTransform(square(x, y, c.markerSide), corners, homography);
+      vector<Point2f> middle = {Point2f(x + c.markerSide / 2, y + c.markerSide / 2)}, projected;
+      perspectiveTransform(middle, projected, homography);
+      for(int k = 0; k < 4; k++)
+      {
+        marker.corners[k] = corners[k];
+        if(corners[k].x < 0 || corners[k].y < 0 || corners[k].x >= c.width || corners[k].y >= c.height)
+          marker.occluded = true;
+      }
+      marker.center = projected[0];
+      truth.push_back(marker);
+    }
+  }
+
+  // Occluding shapes (pens, fingers) over the board, and the markers they cover
+  Mat occlusion = Mat::zeros(c.height, c.width, CV_8UC1);
+  for(int i = 0; i < c.occlusions; i++)
+  {
+    const MarkerTruth & target = truth[rng.uniform(0, (int)truth.size())];
+    Point p(cvRound(target.corners[rng.uniform(0, 4)].x), cvRound(target.corners[rng.uniform(0, 4)].y));
+    Size axes(rng.uniform(8, 30), rng.uniform(30, 90));
+    double tilt = rng.uniform(0., 180.);
+    Scalar shade(rng.uniform(60, 200), rng.uniform(60, 200), rng.uniform(60, 200));
+    ellipse(bgr, p, axes, tilt, 0, 360, shade, FILLED, LINE_AA);
+    ellipse(occlusion, p, axes, tilt, 0, 360, Scalar(255), FILLED);
+  }
+  if(c.occlusions > 0)
+  {
+    for(MarkerTruth & marker : truth)
+    {
+      Point points[4];
+      for(int k = 0; k < 4; k++)
+        points[k] = Point(cvRound(marker.corners[k].x), cvRound(marker.corners[k].y));
+      Rect box = boundingRect(vector<Point>(points, points + 4)) & Rect(0, 0, c.width, c.height);
+      if(box.empty())
+        continue;
+      for(int k = 0; k < 4; k++)
+        points[k] -= box.tl();
+      Mat area = Mat::zeros(box.size(), CV_8UC1);
+      fillConvexPoly(area, points, 4, Scalar(255));
+      bitwise_and(area, occlusion(box), area);
+      if(countNonZero(area) > 0)
+        marker.occluded = true;
+    }
+  }
+
+  // Camera effects
+  applyLighting(bgr, c.lighting, rng);
+  if(c.blur > 0)
+    GaussianBlur(bgr, bgr, Size(0, 0), rng.uniform(0.f, c.blur) + 0.01f);
+  if(c.noise > 0)
+  {
+    Mat noise(bgr.size(), CV_16SC3);
+    rng.fill(noise, RNG::NORMAL, 0, c.noise);
+    add(bgr, noise, bgr, noArray(), CV_8U);
+  }
+
+  // Frame in the camera format
+  size_t pixels = (size_t)c.width * c.height;
+  switch(c.format)
+  {
+    case PIXFORMAT_YUV422:
+      frame.resize(pixels * 2);
+      bgrToYuyv(bgr, frame.data());
+      break;
+    case PIXFORMAT_GRAYSCALE:
+    {
+      frame.resize(pixels);
+      Mat gray(c.height, c.width, CV_8UC1, frame.data());
+      cvtColor(bgr, gray, COLOR_BGR2GRAY);
+      break;
+    }
+    case PIXFORMAT_RGB565:
+    {
+      frame.resize(pixels * 2);
+      Mat rgb565(c.height, c.width, CV_8UC2, frame.data());
+      cvtColor(bgr, rgb565, COLOR_BGR2BGR565);
+      break;
+    }
+    default:
+      ESP_LOGE(TAG, "Format %d not supported", (int)c.format);
+      return false;
+  }
+
+  memset(&fb, 0, sizeof(fb));
+  fb.buf = frame.data();
+  fb.len = frame.size();
+  fb.width = c.width;
+  fb.height = c.height;
+  fb.format = c.format;
+  frameIndex++;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void scoreScene(const vector<MarkerTruth> & truth, const vector<Square> & squares, float tolerance, SceneScore & score)
+{
+  vector<bool> used(squares.size(), false);
+  score.frames++;
+
+  // Nearest free square of each marker (occluded markers may or may not be found)
+  for(int pass = 0; pass < 2; pass++)
+  {
+    for(const MarkerTruth & marker : truth)
+    {
+      if(marker.occluded != (pass == 1))
+        continue;
+
+      int best = -1;
+      float bestDistance = tolerance;
+      for(unsigned int i = 0; i < squares.size(); i++)
+      {
+        float distance = (float)norm(squares[i].subCenter - marker.center);
+        if(!used[i] && distance <= bestDistance)
+        {
+          best = i;
+          bestDistance = distance;
+        }
+      }
+
+      if(!marker.occluded)
+        score.markers++;
+      if(best < 0)
+        continue;
+      used[best] = true;
+      if(marker.occluded)
+        continue;
+
+      score.found++;
+      score.centerError += bestDistance;
+      if(marker.id >= 0 && squares[best].id != marker.id)
+        score.wrongIds++;
+    }
+  }
+
+  for(unsigned int i = 0; i < squares.size(); i++)
+  {
+    if(!used[i])
+      score.falsePositives++;
+  }
+}
+
+bool evaluateScenes(const SceneConfig & config, unsigned int frames, const char * frontEnd, SceneScore & score)
+{
+  const PipelineEntry * pipeline = findPipeline(config.format, frontEnd);
+  if(pipeline == NULL)
+  {
+    ESP_LOGE(TAG, "No %s pipeline for format %d", frontEnd, (int)config.format);
+    return false;
+  }
+
+  SceneGenerator generator(config);
+  camera_fb_t fb;
+  vector<MarkerTruth> truth;
+  vector<Square> squares;
+  for(unsigned int i = 0; i < frames; i++)
+  {
+    if(!generator.next(fb, truth))
+      return false;
+    squares.clear();
+    pipeline->detect(&fb, squares);
+    scoreScene(truth, squares, config.markerSide / 4, score);
+  }
+
+  ESP_LOGI(TAG, "%s: %u frames, %u/%u markers found, %u false positives, %u wrong ids, center error %.2f px",
+           pipeline->name, score.frames, score.found, score.markers, score.falsePositives, score.wrongIds,
+           score.found > 0 ? score.centerError / score.found : 0.);
+  return true;
+}
@@ -0,0 +1,379 @@
+/**
+ * @file sdWriter.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the SD card writer.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <sdWriter.hpp>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#endif
+
+
+// tag used for ESP_LOGx functions
+static const char *TAG = "sdWriter";
+
+// SD writer task: stack, priority and core (the detection runs on core 0), and transfers queued
+// (two per writer at most, the fill waits for the older one)
+#ifndef SD_WRITER_TASK_STACK
+#define SD_WRITER_TASK_STACK (1024 * 3)
+#endif
+#ifndef SD_WRITER_TASK_PRIORITY
+#define SD_WRITER_TASK_PRIORITY 6
+#endif
+#ifndef SD_WRITER_TASK_CORE
+#define SD_WRITER_TASK_CORE 1
+#endif
+#ifndef SD_WRITER_QUEUE_LEN
+#define SD_WRITER_QUEUE_LEN 4
+#endif
+
+static_assert(SD_WRITER_BUFFER % SD_SECTOR == 0, "the buffers must hold whole sectors");
+
+/**
+ * @brief Buffer handed to the SD writer task
+ */
+typedef struct {
+  int fd;
+  size_t offset;          // file offset of the data (sector aligned)
+  bool seek;              // the data does not follow the previous transfer (tail of a flush)
+  const uint8_t * data;
+  size_t len;
+  volatile bool * failed; // set if the transfer fails
+  void * done;            // semaphore given when the buffer can be filled again
+} sdTransfer;
+
+// totals of the transfers (stalls and files are counted by the writers)
+static SdWriterStats totals = {0, 0, 0, 0, 0};
+
+#ifdef ESP_PLATFORM
+// queue of sdTransfer, NULL until the task is started
+static QueueHandle_t sdQueue = NULL;
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+// static function writing a buffer at its offset. The writes are sequential: FATFS seeks from the
+// current cluster when moving forward but from the start of the chain when moving back, so the file
+// position is only moved back for the sector rewritten after a flush (pwrite would move it twice)
+static void sdTransferRun(const sdTransfer & transfer)
+{
+  int64_t start = esp_timer_get_time();
+  if(transfer.seek && lseek(transfer.fd, transfer.offset, SEEK_SET) != (off_t)transfer.offset)
+  {
+    *transfer.failed = true;
+  }
+  else if(write(transfer.fd, transfer.data, transfer.len) != (ssize_t)transfer.len)
+  {
+    *transfer.failed = true;
+  }
+  totals.busyTime += esp_timer_get_time() - start;
+  totals.bytes += transfer.len;
+  totals.transfers++;
+}
+
+#ifdef ESP_PLATFORM
+/*------------------------------------------------------------------------------------------------*/
+// SD writer task: writes the queued buffers in order
+static void sdWriterTask(void *arg)
+{
+  sdTransfer transfer;
+  for(;;)
+  {
+    if(xQueueReceive(sdQueue, &transfer, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+    sdTransferRun(transfer);
+    xSemaphoreGive((SemaphoreHandle_t)transfer.done);
+  }
+}
+
+// static function starting the SD writer task (done by the first open)
+static bool startSdWriter()
+{
+  if(sdQueue != NULL)
+  {
+    return true;
+  }
+  sdQueue = xQueueCreate(SD_WRITER_QUEUE_LEN, sizeof(sdTransfer));
+  if(sdQueue == NULL)
+  {
+    ESP_LOGE(TAG, "SD writer queue creation failed");
+    return false;
+  }
+  if(xTaskCreatePinnedToCore(sdWriterTask, "sdWriter", SD_WRITER_TASK_STACK, nullptr, SD_WRITER_TASK_PRIORITY, nullptr,
+                             SD_WRITER_TASK_CORE) != pdPASS)
+  {
+    ESP_LOGE(TAG, "SD writer task creation failed");
+    vQueueDelete(sdQueue);
+    sdQueue = NULL;
+    return false;
+  }
+  return true;
+}
+#endif
+
+// ============================================= WRITER ============================================
+/*------------------------------------------------------------------------------------------------*/
+
+SdWriter::~SdWriter()
+{
+  close();
+  for(int i = 0; i < 2; i++)
+  {
+    heap_caps_free(buffers[i]);
+#ifdef ESP_PLATFORM
+    if(bufferFree[i] != NULL)
+      vSemaphoreDelete((SemaphoreHandle_t)bufferFree[i]);
+#endif
+  }
+}
+
+bool SdWriter::open(const string & path, size_t preallocate, size_t start)
+{
+  close();
+
+  // The buffers (and their semaphores, given while the buffer is free) are kept for the next files
+  if(buffers[0] == NULL)
+  {
+    for(int i = 0; i < 2; i++)
+    {
+      buffers[i] = (uint8_t *)heap_caps_aligned_alloc(SD_SECTOR, SD_WRITER_BUFFER, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+#ifdef ESP_PLATFORM
+      bufferFree[i] = xSemaphoreCreateBinary();
+      if(bufferFree[i] != NULL)
+        xSemaphoreGive((SemaphoreHandle_t)bufferFree[i]);
+#endif
+    }
+    if(buffers[0] == NULL || buffers[1] == NULL)
+    {
+      ESP_LOGE(TAG, "Failed to allocate the buffers (%u bytes of DMA memory)", 2 * SD_WRITER_BUFFER);
+      heap_caps_free(buffers[0]);
+      heap_caps_free(buffers[1]);
+      buffers[0] = buffers[1] = NULL;
+      return false;
+    }
+  }
+#ifdef ESP_PLATFORM
+  if(bufferFree[0] == NULL || bufferFree[1] == NULL || !startSdWriter())
+  {
+    return false;
+  }
+#endif
+
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | (start == 0 ? O_TRUNC : 0), 0666);
+  if(fd < 0)
+  {
+    ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+    return false;
+  }
+  name = path;
+  failed = false;
+  written = 0;
+  openTime = esp_timer_get_time();
+
+  // The buffer starts at the sector of start: its head is read back and written again
+#ifdef ESP_PLATFORM
+  xSemaphoreTake((SemaphoreHandle_t)bufferFree[current], portMAX_DELAY);
+#endif
+  position = start & ~(size_t)(SD_SECTOR - 1);
+  fill = start - position;
+  clean = fill;
+  allocated = start;
+  queued = 0;
+  step = preallocate;
+  if(fill > 0 && pread(fd, buffers[current], fill, position) != (ssize_t)fill)
+  {
+    ESP_LOGE(TAG, "Failed to read %s", path.c_str());
+    close();
+    return false;
+  }
+  // Without the preallocation the file is still written, FATFS allocates at every transfer
+  reserve(start + SD_WRITER_BUFFER);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Grow the file by whole steps until it holds end bytes: writing its last byte makes FATFS take the
+// clusters in one go (consecutive on a card with free space in one piece), so the transfers find
+// their clusters already chained instead of allocating one at a time. The position of the file is
+// left where it is, so this costs one walk of the chain per step
+bool SdWriter::reserve(size_t end)
+{
+  if(step == 0 || end <= allocated)
+  {
+    return true;
+  }
+  while(allocated < end)
+  {
+    allocated += step;
+  }
+  static const uint8_t zero = 0;
+  if(pwrite(fd, &zero, 1, allocated - 1) != 1)
+  {
+    ESP_LOGW(TAG, "%s: preallocation of %u bytes failed", name.c_str(), (unsigned int)allocated);
+    step = 0;
+    return false;
+  }
+  return true;
+}
+
+// Hand the current buffer to the SD writer task and take the other one
+void SdWriter::submit(size_t len)
+{
+  reserve(position + len);
+  sdTransfer transfer = {fd, position, position != queued, buffers[current], len, &failed, bufferFree[current]};
+  queued = position + len;
+  written += len;
+#ifdef ESP_PLATFORM
+  xQueueSend(sdQueue, &transfer, portMAX_DELAY);
+  current ^= 1;
+  if(xSemaphoreTake((SemaphoreHandle_t)bufferFree[current], 0) != pdTRUE)
+  {
+    totals.stalls++;
+    xSemaphoreTake((SemaphoreHandle_t)bufferFree[current], portMAX_DELAY);
+  }
+#else
+  sdTransferRun(transfer);
+  current ^= 1;
+#endif
+}
+
+bool SdWriter::write(const void * data, size_t len)
+{
+  if(fd < 0)
+  {
+    return false;
+  }
+  const uint8_t * bytes = (const uint8_t *)data;
+  while(len > 0)
+  {
+    size_t chunk = min(len, (size_t)SD_WRITER_BUFFER - fill);
+    memcpy(buffers[current] + fill, bytes, chunk);
+    fill += chunk;
+    bytes += chunk;
+    len -= chunk;
+    if(fill == SD_WRITER_BUFFER)
+    {
+      submit(fill);
+      position += fill;
+      fill = 0;
+      clean = 0;
+    }
+  }
+  return !failed;
+}
+
+bool SdWriter::flush()
+{
+  if(fd < 0)
+  {
+    return false;
+  }
+  if(fill > clean)
+  {
+    // The partial sector at the end goes on with the next buffer
+    size_t tail = fill % SD_SECTOR;
+    const uint8_t * sent = buffers[current];
+    submit(fill);
+    memcpy(buffers[current], sent + fill - tail, tail);
+    position += fill - tail;
+    fill = clean = tail;
+  }
+#ifdef ESP_PLATFORM
+  // The transfers are in order: the other buffer is free once all of them are done
+  xSemaphoreTake((SemaphoreHandle_t)bufferFree[current ^ 1], portMAX_DELAY);
+  xSemaphoreGive((SemaphoreHandle_t)bufferFree[current ^ 1]);
+#endif
+  return !failed;
+}
+
+bool SdWriter::sync()
+{
+  if(!flush())
+  {
+    return false;
+  }
+  if(fsync(fd) != 0)
+  {
+    failed = true;
+  }
+  return !failed;
+}
+
+bool SdWriter::close()
+{
+  if(fd < 0)
+  {
+    return true;
+  }
+  bool ok = flush();
+#ifdef ESP_PLATFORM
+  xSemaphoreGive((SemaphoreHandle_t)bufferFree[current]);
+#endif
+
+  // The preallocation past the data is given back
+  size_t end = position + fill;
+  if(ftruncate(fd, end) != 0 || fsync(fd) != 0)
+  {
+    ok = false;
+  }
+  if(::close(fd) != 0)
+  {
+    ok = false;
+  }
+  fd = -1;
+  totals.files++;
+
+  int64_t elapsed = esp_timer_get_time() - openTime;
+  if(!ok)
+  {
+    ESP_LOGE(TAG, "Saving Error : Failed to write %s", name.c_str());
+    return false;
+  }
+  ESP_LOGI(TAG, "File saved as %s (%u bytes, %u ms, %.2f MB/s)", name.c_str(), (unsigned int)end,
+           (unsigned int)(elapsed / 1000), elapsed > 0 ? (double)written / elapsed : 0.);
+  return true;
+}
+
+// ============================================= UTILS =============================================
+/*------------------------------------------------------------------------------------------------*/
+
+bool saveBuffer(const string & path, const void * data, size_t len)
+{
+  SdWriter writer;
+  if(!writer.open(path, len))
+  {
+    return false;
+  }
+  bool ok = writer.write(data, len);
+  return writer.close() && ok;
+}
+
+SdWriterStats getSdWriterStats()
+{
+  return totals;
+}
+
+void logSdWriterStats()
+{
+  SdWriterStats stats = getSdWriterStats();
+  ESP_LOGI(TAG, "SD writer: %u files, %llu bytes in %u transfers, %.2f MB/s while writing, %u stalls",
+           stats.files, (unsigned long long)stats.bytes, stats.transfers,
+           stats.busyTime > 0 ? (double)stats.bytes / stats.busyTime : 0., stats.stalls);
+}
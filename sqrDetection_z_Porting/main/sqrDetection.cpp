@@ -12,10 +12,16 @@
 
 #include "sqrDetection.hpp"
 #include <esp_log.h>
+#include <pixel_convert.h>
 
 // tag used for ESP_LOGx functions
 static const char *TAG = "sqrDetection";
 
+// Tolerance of fitQuad in thousandths of the contour perimeter (was approxPolyDP with 0.02)
+#ifndef QUAD_FIT_TOLERANCE
+#define QUAD_FIT_TOLERANCE 20
+#endif
+
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -58,6 +64,7 @@ Square getSquare(vector<Point> & vertices, Mat & image, bool highAccuracy)
 
   // Find center of square
   square.center = getCenter(vertices);
+  square.subCenter = square.center;
 
   // Find colour of square
   getColour(image,square.center,square.colour,highAccuracy);
@@ -67,6 +74,203 @@ Square getSquare(vector<Point> & vertices, Mat & image, bool highAccuracy)
 
 /*------------------------------------------------------------------------------------------------*/
 
+// Integer square root (floor)
+static uint32_t isqrt(uint64_t value)
+{
+  uint64_t root = 0, bit = 1ULL << 62;
+
+  while(bit > value)
+    bit >>= 2;
+  while(bit)
+  {
+    if(value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+// Length of a segment in 1/256 of pixel. The segments of a CHAIN_APPROX_SIMPLE contour are
+// horizontal, vertical or diagonal, so the square root is rarely needed.
+static int segmentLength(int dx, int dy)
+{
+  dx = abs(dx);
+  dy = abs(dy);
+  if(!dx || !dy)
+    return (dx + dy) << 8;
+  if(dx == dy)
+    return dx * 362; // sqrt(2) * 256
+  return (int)isqrt(((uint64_t)dx * dx + (uint64_t)dy * dy) << 16);
+}
+
+// Index of the contour point farthest from point start, scanning from the following one
+static int farthestPoint(const Contour & contour, int start)
+{
+  int n = contour.size();
+  int64_t best = 0;
+  int index = start;
+
+  for(int i = (start + 1) % n; i != start; i = (i + 1) % n)
+  {
+    int64_t dx = contour[i].x - contour[start].x, dy = contour[i].y - contour[start].y;
+    if(dx * dx + dy * dy > best)
+    {
+      best = dx * dx + dy * dy;
+      index = i;
+    }
+  }
+  return index;
+}
+
+bool fitQuad(const Contour & contour, QuadFit & quad, int minArea, int maxArea)
+{
+  int n = contour.size();
+  int64_t area2 = 0;
+  int64_t perimeter = 0;
+  int64_t far = 0;
+  int a = 0;
+
+  quad.area = 0;
+  quad.perimeter = 0;
+  quad.convex = false;
+  if(n < 4)
+    return false;
+
+  // Single pass: area (shoelace), perimeter and the point farthest from the first one
+  for(int i=0; i<n; i++)
+  {
+    const Point & p = contour[i];
+    const Point & q = contour[i + 1 < n ? i + 1 : 0];
+    int64_t dx = p.x - contour[0].x, dy = p.y - contour[0].y;
+
+    area2 += (int64_t)p.x * q.y - (int64_t)q.x * p.y;
+    perimeter += segmentLength(q.x - p.x, q.y - p.y);
+    if(dx * dx + dy * dy > far)
+    {
+      far = dx * dx + dy * dy;
+      a = i;
+    }
+  }
+  quad.area = (int)(llabs(area2) / 2);
+  quad.perimeter = (int)perimeter;
+  if(llabs(area2) < 2LL * minArea || llabs(area2) > 2LL * maxArea)
+    return false;
+
+  // Two far apart points are vertices of the polygon: like approxPolyDP, jump twice more to the
+  // farthest point to get closer to the farthest pair
+  a = farthestPoint(contour, a);
+  int b = farthestPoint(contour, a);
+  if(contour[a] == contour[b])
+    return false;
+
+  // Douglas-Peucker on the two halves of the contour: a point is a vertex if it is farther than
+  // epsilon from the chord, i.e. cross^2 > epsilon^2 * chord^2 (epsilon in 1/256 of pixel).
+  // The clean-up below removes at most every other vertex, so more than 8 vertices can not end up
+  // as a quadrilateral.
+  int64_t epsilon = perimeter * QUAD_FIT_TOLERANCE / 1000;
+  int64_t epsilon2 = epsilon * epsilon;
+  int vertices[8] = {a, b};
+  int count = 2;
+  int stack[8][2] = {{b, a}, {a, b}};
+  int depth = 2;
+
+  while(depth)
+  {
+    depth--;
+    int start = stack[depth][0], end = stack[depth][1];
+    const Point & s = contour[start];
+    int64_t cx = contour[end].x - s.x, cy = contour[end].y - s.y;
+    int64_t best = 0;
+    int vertex = -1;
+
+    // Farthest point of the chain from the chord
+    for(int i = (start + 1) % n; i != end; i = (i + 1) % n)
+    {
+      int64_t cross = cx * (contour[i].y - s.y) - cy * (contour[i].x - s.x);
+      if(cross * cross > best)
+      {
+        best = cross * cross;
+        vertex = i;
+      }
+    }
+    if(vertex < 0 || best * 65536 <= epsilon2 * (cx * cx + cy * cy))
+      continue;
+
+    if(count == 8)
+      return false;
+    vertices[count++] = vertex;
+    stack[depth][0] = vertex;
+    stack[depth][1] = end;
+    stack[depth + 1][0] = start;
+    stack[depth + 1][1] = vertex;
+    depth += 2;
+  }
+  if(count < 4)
+    return false;
+
+  // Vertices in contour order, starting from the first far point
+  for(int i=1; i<count; i++)
+  {
+    for(int j=i; j>0 && (vertices[j] - a + n) % n < (vertices[j - 1] - a + n) % n; j--)
+      swap(vertices[j], vertices[j - 1]);
+  }
+
+  // Clean-up as approxPolyDP: drop the vertices lying almost on the line joining their neighbours
+  // (unless it is horizontal or vertical), keeping the vertex that follows a dropped one. The list
+  // is compacted in place, so the last vertex sees the compacted first one as its neighbour.
+  Point corners[8];
+  for(int i=0; i<count; i++)
+    corners[i] = contour[vertices[i]];
+
+  int kept = count, write = 0, read = 1;
+  Point prev = corners[count - 1], p = corners[0];
+  for(int i=0; i<count && kept > 2; i++)
+  {
+    Point next = corners[read];
+    read = (read + 1) % count;
+    int64_t dx = next.x - prev.x, dy = next.y - prev.y;
+    int64_t cross = (int64_t)(p.x - prev.x) * dy - (int64_t)(p.y - prev.y) * dx;
+    int64_t inner = (int64_t)(p.x - prev.x) * (next.x - p.x) + (int64_t)(p.y - prev.y) * (next.y - p.y);
+
+    if(dx && dy && inner >= 0 && cross * cross * 131072 <= epsilon2 * (dx * dx + dy * dy))
+    {
+      kept--;
+      corners[write++] = prev = next;
+      p = corners[read];
+      read = (read + 1) % count;
+      i++;
+      continue;
+    }
+    corners[write++] = prev = p;
+    p = next;
+  }
+  if(kept != 4)
+    return false;
+  for(int i=0; i<4; i++)
+    quad.corners[i] = corners[i];
+
+  // Convex if all the turns have the same direction
+  int turns = 0;
+  for(int i=0; i<4; i++)
+  {
+    const Point & p0 = quad.corners[i];
+    const Point & p1 = quad.corners[(i + 1) & 3];
+    const Point & p2 = quad.corners[(i + 2) & 3];
+    int64_t cross = (int64_t)(p1.x - p0.x) * (p2.y - p1.y) - (int64_t)(p1.y - p0.y) * (p2.x - p1.x);
+    turns |= cross > 0 ? 1 : cross < 0 ? 2 : 3;
+  }
+  quad.convex = turns == 1 || turns == 2;
+
+  return quad.convex;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 int centerToCenter(Point & center1, Point & center2)
 {
   // Find distance between the two points (x,y)
@@ -81,7 +285,53 @@ int centerToCenter(Square & square1, Square & square2)
 
 /*------------------------------------------------------------------------------------------------*/
 
-void getColour(Mat & image, Point & point, vector<unsigned int> & bgrArray, bool highAccuracy)
+void getColourYUYV(Mat & image, Point & point, Vec3b & bgr, bool highAccuracy)
+{
+  // Only the pixel pairs covering the sampled window are converted, the rest of the frame is never
+  // turned into colour
+  unsigned int b = 0, g = 0, r = 0, count = 0;
+
+  // Sampled window (5x5 or a single pixel) clipped to the image
+  int half = highAccuracy ? 2 : 0;
+  int x0 = max(point.x - half, 0), x1 = min(point.x + half, image.cols - 1);
+  int y0 = max(point.y - half, 0), y1 = min(point.y + half, image.rows - 1);
+
+  // Chroma is shared by pairs of pixels, so the conversion starts on an even column
+  int first = x0 & ~1;
+  int pixels = (x1 - first + 2) & ~1;
+  uint8_t pairs[3 * 6];
+
+  for(int y = y0; y <= y1 && x0 <= x1; y++)
+  {
+    pixconv_yuyv_to_bgr888(image.ptr<uint8_t>(y) + first * 2, pairs, pixels);
+    for(int x = x0; x <= x1; x++)
+    {
+      // Add BGR values
+      b += pairs[(x - first) * 3];
+      g += pairs[(x - first) * 3 + 1];
+      r += pairs[(x - first) * 3 + 2];
+      count++;
+    }
+  }
+
+  // Calculate average colour
+  if(count)
+  {
+    b /= count;
+    g /= count;
+    r /= count;
+  }
+
+  bgr = Vec3b(b, g, r);
+}
+
+void getColourYUYV(Mat & image, Square & sqr, bool highAccuracy)
+{
+  // Wrapper function
+  getColourYUYV(image, sqr.center, sqr.colour, highAccuracy);
+}
+
+void getColour(Mat & image, Point & point, Vec3b & bgr, bool highAccuracy)
 {
   // Extract BGR colour of a single pixel
   unsigned int b = 0, g = 0, r = 0;
@@ -116,11 +366,7 @@ void getColour(Mat & image, Point & point, vector<unsigned int> & bgrArray, bool
     r = image.at<Vec3b>(point.y,point.x)[2];
   }
 
-  bgrArray.clear();
-  
-  bgrArray.push_back(b);
-  bgrArray.push_back(g);
-  bgrArray.push_back(r);
+  bgr = Vec3b(b, g, r);
 }
 
 void getColour(Mat & image, Square & sqr, bool highAccuracy)
@@ -206,6 +452,7 @@ Square intermediateSquare(Square & square1, Square & square2)
   // return the center of a square between the two given squares
   Square intermediateSquare;
   intermediateSquare.center = intermediatePoint(square1.center,square2.center);
+  intermediateSquare.subCenter = (square1.subCenter + square2.subCenter) * 0.5f;
   return intermediateSquare;
 }
 
@@ -0,0 +1,209 @@
+/**
+ * @file squareVerifier.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the verification of the quadrilaterals found in the picture.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <squareVerifier.hpp>
+#include <math.h>
+
+
+// Corner refinement: the estimate is moved at most this many times, or until it moves less than
+// REFINE_EPSILON pixels
+#define REFINE_ITERATIONS 10
+#define REFINE_EPSILON 0.01f
+
+// Branch-free min/max, so that the loops below can be vectorised
+static inline float minf(float a, float b) { return a < b ? a : b; }
+static inline float maxf(float a, float b) { return a > b ? a : b; }
+
+/*------------------------------------------------------------------------------------------------*/
+
+void addQuad(QuadBatch & batch, const array<Point,4> & corners)
+{
+  for(int k=0; k<4; k++)
+  {
+    batch.x[k].push_back(corners[k].x);
+    batch.y[k].push_back(corners[k].y);
+  }
+}
+
+void clearQuads(QuadBatch & batch)
+{
+  for(int k=0; k<4; k++)
+  {
+    batch.x[k].clear();
+    batch.y[k].clear();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Scoring loops on the columns of a batch (restrict parameters: the columns never overlap, so the
+// compiler can vectorise without run-time alias checks)
+static void scoreColumns(size_t n,
+                         const float * __restrict x0, const float * __restrict x1,
+                         const float * __restrict x2, const float * __restrict x3,
+                         const float * __restrict y0, const float * __restrict y1,
+                         const float * __restrict y2, const float * __restrict y3,
+                         float * __restrict ratio, float * __restrict cosine,
+                         float * __restrict cx, float * __restrict cy, float * __restrict score)
+{
+  // Squared sides and angles, and centroid: straight-line code on every candidate
+  for(size_t i=0; i<n; i++)
+  {
+    // Corners relative to the first one, so that the products stay small
+    float ax = x1[i] - x0[i], ay = y1[i] - y0[i];
+    float bx = x2[i] - x0[i], by = y2[i] - y0[i];
+    float dx = x3[i] - x0[i], dy = y3[i] - y0[i];
+
+    // Sides 0->1, 1->2, 2->3, 3->0
+    float e0x = ax, e0y = ay;
+    float e1x = bx - ax, e1y = by - ay;
+    float e2x = dx - bx, e2y = dy - by;
+    float e3x = -dx, e3y = -dy;
+    float l0 = e0x * e0x + e0y * e0y;
+    float l1 = e1x * e1x + e1y * e1y;
+    float l2 = e2x * e2x + e2y * e2y;
+    float l3 = e3x * e3x + e3y * e3y;
+    ratio[i] = minf(minf(l0, l1), minf(l2, l3)) / maxf(maxf(l0, l1), maxf(l2, l3));
+
+    // Squared cosine of each corner angle (between the sides meeting there)
+    float d0 = e3x * e0x + e3y * e0y;
+    float d1 = e0x * e1x + e0y * e1y;
+    float d2 = e1x * e2x + e1y * e2y;
+    float d3 = e2x * e3x + e2y * e3y;
+    cosine[i] = maxf(maxf(d0 * d0 / (l3 * l0), d1 * d1 / (l0 * l1)),
+                     maxf(d2 * d2 / (l1 * l2), d3 * d3 / (l2 * l3)));
+
+    // Centroid of the enclosed area (the triangles 0,1,2 and 0,2,3)
+    float a1 = ax * by - bx * ay;
+    float a2 = bx * dy - dx * by;
+    cx[i] = x0[i] + ((ax + bx) * a1 + (bx + dx) * a2) / (3.0f * (a1 + a2));
+    cy[i] = y0[i] + ((ay + by) * a1 + (by + dy) * a2) / (3.0f * (a1 + a2));
+  }
+
+  // Back from squared values, and squareness
+  for(size_t i=0; i<n; i++)
+  {
+    ratio[i] = sqrtf(ratio[i]);
+    cosine[i] = sqrtf(cosine[i]);
+    score[i] = ratio[i] * (1.0f - cosine[i]);
+  }
+}
+
+void scoreQuads(QuadBatch & batch)
+{
+  size_t n = batch.size();
+
+  batch.sideRatio.resize(n);
+  batch.angleCos.resize(n);
+  batch.cx.resize(n);
+  batch.cy.resize(n);
+  batch.score.resize(n);
+
+  scoreColumns(n, batch.x[0].data(), batch.x[1].data(), batch.x[2].data(), batch.x[3].data(),
+               batch.y[0].data(), batch.y[1].data(), batch.y[2].data(), batch.y[3].data(),
+               batch.sideRatio.data(), batch.angleCos.data(), batch.cx.data(), batch.cy.data(),
+               batch.score.data());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void verifyQuads(const QuadBatch & batch, float minScore, vector<unsigned int> & accepted)
+{
+  accepted.clear();
+  for(unsigned int i=0; i<batch.size(); i++)
+  {
+    if(batch.score[i] >= minScore)
+      accepted.push_back(i);
+  }
+}
+
+// ============================================= REFINE ============================================
+
+// Every pixel of the window gives a line through itself, across its gradient (along the edge it
+// belongs to): the corner is the point closest to all of them, weighted by the gradient strength
+// (as cornerSubPix does, but on the derivatives already computed for Canny)
+static bool refineCorner(const Mat & dx, const Mat & dy, int radius, const float * weight, float & x, float & y)
+{
+  float px = x, py = y;
+
+  for(int iter=0; iter<REFINE_ITERATIONS; iter++)
+  {
+    // Window around the current estimate, that must be inside the image
+    int cx = cvRound(px), cy = cvRound(py);
+    if(cx - radius < 0 || cy - radius < 0 || cx + radius >= dx.cols || cy + radius >= dx.rows)
+      return false;
+
+    // Normal equations, with the window positions relative to its center
+    float gxx = 0, gxy = 0, gyy = 0, bx = 0, by = 0;
+    for(int v=-radius; v<=radius; v++)
+    {
+      const short * gxRow = dx.ptr<short>(cy + v) + cx;
+      const short * gyRow = dy.ptr<short>(cy + v) + cx;
+      for(int u=-radius; u<=radius; u++)
+      {
+        float w = weight[u + radius] * weight[v + radius];
+        float gx = gxRow[u], gy = gyRow[u];
+        float a = w * gx * gx, b = w * gx * gy, c = w * gy * gy;
+        gxx += a;
+        gxy += b;
+        gyy += c;
+        bx += a * u + b * v;
+        by += b * u + c * v;
+      }
+    }
+
+    // A flat window or a single straight edge do not fix a point
+    float det = gxx * gyy - gxy * gxy;
+    if(det <= 0.01f * (gxx + gyy) * (gxx + gyy))
+      return false;
+
+    float nx = cx + (gyy * bx - gxy * by) / det;
+    float ny = cy + (gxx * by - gxy * bx) / det;
+    float shift = (nx - px) * (nx - px) + (ny - py) * (ny - py);
+    px = nx;
+    py = ny;
+    if(shift < REFINE_EPSILON * REFINE_EPSILON)
+      break;
+  }
+
+  // A point found away from the window belongs to something else
+  if((px - x) * (px - x) + (py - y) * (py - y) > (float)(radius * radius))
+    return false;
+
+  x = px;
+  y = py;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+unsigned int refineQuads(QuadBatch & batch, const vector<unsigned int> & selected, const Mat & dx, const Mat & dy, int radius)
+{
+  unsigned int refined = 0;
+
+  // Gaussian weights of the window rows and columns: the pixels near the center count more (kept
+  // from call to call, like the other buffers of the detection)
+  static vector<float> weight;
+  weight.resize(2 * radius + 1);
+  for(int i=-radius; i<=radius; i++)
+    weight[i + radius] = expf(-(float)(i * i) / (float)(radius * radius));
+
+  for(unsigned int k=0; k<selected.size(); k++)
+  {
+    for(int c=0; c<4; c++)
+      refined += refineCorner(dx, dy, radius, weight.data(), batch.x[c][selected[k]], batch.y[c][selected[k]]);
+  }
+
+  // Centroids (and scores) of the moved corners
+  scoreQuads(batch);
+
+  return refined;
+}
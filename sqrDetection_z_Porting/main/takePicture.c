@@ -15,6 +15,12 @@
 // tag used for ESP_LOGx functions
 static const char *TAG = "take_picture";
 
+// Files open at the same time on the SD card: each one keeps a FATFS object with a sector buffer.
+// The writers keep a few large files open (corpus, archive) instead of many small ones.
+#ifndef SD_MAX_FILES
+#define SD_MAX_FILES 6
+#endif
+
 /*------------------------------------------------------------------------------------------------*/
 camera_config_t config;
 // camera pins
@@ -119,7 +125,7 @@ esp_err_t initSDCard()
   // formatted in case when mounting fails.
   esp_vfs_fat_sdmmc_mount_config_t mount_config = {
       .format_if_mount_failed = false,
-      .max_files = 20};
+      .max_files = SD_MAX_FILES};
 
   // Use settings defined above to initialize SD card and mount FAT filesystem.
   // Note: esp_vfs_fat_sdmmc/sdspi_mount is all-in-one convenience functions.
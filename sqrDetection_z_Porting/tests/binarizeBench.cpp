@@ -0,0 +1,179 @@
+/**
+ * @file binarizeBench.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file compares the two front-ends of the detection, Gaussian blur + Canny +
+ *         dilation and binarize, on the sample images and on synthetic frames of dark squares
+ *         under an illumination gradient: time of the front-end, squares found (the same quad fit
+ *         and verification after both), and on the synthetic frames the misses, false positives
+ *         and center error against the ground truth.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <edgeRuns.hpp>
+#include <sqrDetection.hpp>
+#include <squareVerifier.hpp>
+#include <stdio.h>
+#include <time.h>
+
+using namespace std;
+using namespace cv;
+
+#define RUNS 20
+
+// Synthetic frames: squares of SIDE pixels, STEP pixels apart
+#define WIDTH 800
+#define HEIGHT 600
+#define SIDE 40
+#define STEP 90
+
+static double nowUs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+// Front-end of the detection on the median output, into the regions whose contours are searched
+static void frontEnd(const Mat & median, bool binarized, EdgeMap & regions)
+{
+  if(binarized)
+  {
+    binarize(median, regions, 30, 5);
+    return;
+  }
+  Mat blurred, edges;
+  EdgeMap runs;
+  GaussianBlur(median, blurred, Size(3, 3), 0);
+  Canny(blurred, edges, 30, 80);
+  encodeEdges(edges, runs);
+  dilateEdges(runs, regions);
+}
+
+// Centers of the squares found: quad fit and verification, squares closer than 10 px merged
+static vector<Point2f> findSquares(const EdgeMap & regions, int minArea, int maxArea)
+{
+  pmr::monotonic_buffer_resource memory;
+  ContourList contours(&memory);
+  findEdgeContours(regions, contours);
+
+  QuadBatch batch;
+  vector<unsigned int> accepted;
+  clearQuads(batch);
+  for(const Contour & contour : contours)
+  {
+    QuadFit quad;
+    if(fitQuad(contour, quad, minArea, maxArea))
+      addQuad(batch, quad.corners);
+  }
+  scoreQuads(batch);
+  verifyQuads(batch, 0.7f, accepted);
+
+  vector<Point2f> centers;
+  for(unsigned int k : accepted)
+  {
+    Point2f center(batch.cx[k], batch.cy[k]);
+    bool duplicate = false;
+    for(const Point2f & other : centers)
+      duplicate |= norm(center - other) < 10;
+    if(!duplicate)
+      centers.push_back(center);
+  }
+  return centers;
+}
+
+// Best time of the front-end, and the squares it leads to
+static double run(const Mat & median, bool binarized, int minArea, int maxArea, vector<Point2f> & centers)
+{
+  EdgeMap regions;
+  double best = 1e30;
+  for(int i = 0; i < RUNS; i++)
+  {
+    double start = nowUs();
+    frontEnd(median, binarized, regions);
+    best = min(best, nowUs() - start);
+  }
+  centers = findSquares(regions, minArea, maxArea);
+  return best;
+}
+
+// Grid of dark squares, brightness falling across the frame, blur and noise
+static Mat renderFrame(uint64_t seed, vector<Point2f> & truth)
+{
+  Mat frame(HEIGHT, WIDTH, CV_8UC1);
+  for(int x = 0; x < WIDTH; x++)
+    frame.col(x).setTo(Scalar(210 - 110 * x / WIDTH));
+  truth.clear();
+  for(int y = STEP / 2; y + SIDE < HEIGHT; y += STEP)
+  {
+    for(int x = STEP / 2; x + SIDE < WIDTH; x += STEP)
+    {
+      rectangle(frame, Rect(x, y, SIDE, SIDE), Scalar(35 + (x + y) % 30), FILLED);
+      truth.push_back(Point2f(x + (SIDE - 1) / 2.f, y + (SIDE - 1) / 2.f));
+    }
+  }
+  GaussianBlur(frame, frame, Size(0, 0), 0.8);
+  RNG rng(seed);
+  Mat noise(frame.size(), CV_16SC1);
+  rng.fill(noise, RNG::NORMAL, 0, 4);
+  add(frame, noise, frame, noArray(), CV_8U);
+  return frame;
+}
+
+int main(int argc, char ** argv)
+{
+  string images = argc > 1 ? argv[1] : ".";
+  const char * NAMES[] = {"canny", "binarize"};
+
+  printf("%-16s %-9s %10s %8s\n", "image", "front-end", "us", "squares");
+  for(int i = 0;; i++)
+  {
+    string name = "test" + to_string(i) + ".jpg";
+    Mat gray = imread(images + "/" + name, IMREAD_GRAYSCALE);
+    if(gray.empty())
+      break;
+    Mat median;
+    medianBlur(gray, median, 3);
+    for(int binarized = 0; binarized < 2; binarized++)
+    {
+      vector<Point2f> centers;
+      double time = run(median, binarized, 400, 100000, centers);
+      printf("%-16s %-9s %10.0f %8zu\n", name.c_str(), NAMES[binarized], time, centers.size());
+    }
+  }
+
+  printf("\n%-16s %-9s %10s %8s %6s %6s %10s\n", "synthetic", "front-end", "us", "squares", "missed", "false",
+         "error px");
+  for(uint64_t seed = 1; seed <= 4; seed++)
+  {
+    vector<Point2f> truth;
+    Mat median;
+    medianBlur(renderFrame(seed, truth), median, 3);
+    for(int binarized = 0; binarized < 2; binarized++)
+    {
+      vector<Point2f> centers;
+      double time = run(median, binarized, SIDE * SIDE / 2, SIDE * SIDE * 2, centers);
+      unsigned int found = 0;
+      double error = 0;
+      for(const Point2f & marker : truth)
+      {
+        double nearest = 1e30;
+        for(const Point2f & center : centers)
+          nearest = min(nearest, norm(center - marker));
+        if(nearest < SIDE / 4)
+        {
+          found++;
+          error += nearest;
+        }
+      }
+      printf("%-16s %-9s %10.0f %8zu %6zu %6zu %10.2f\n", ("seed " + to_string(seed)).c_str(), NAMES[binarized], time,
+             centers.size(), truth.size() - found, centers.size() - found, found ? error / found : 0.);
+    }
+  }
+  return 0;
+}
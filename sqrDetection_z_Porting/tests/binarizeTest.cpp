@@ -0,0 +1,98 @@
+/**
+ * @file binarizeTest.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file checks binarize against the local mean computed with an integral image: the
+ *         same dark pixels, window clipped at the borders, on the sample images and on random
+ *         images, for several radii (larger than the image too) and offsets.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <edgeRuns.hpp>
+#include <stdio.h>
+
+using namespace std;
+using namespace cv;
+
+static int failures = 0;
+
+// Dark pixels: (pixel + offset) * area < sum of the clipped window
+static Mat referenceBinarize(const Mat & gray, int radius, int offset)
+{
+  Mat sums, dark(gray.size(), CV_8UC1);
+  integral(gray, sums, CV_64F);
+  for(int y = 0; y < gray.rows; y++)
+  {
+    int y0 = max(y - radius, 0), y1 = min(y + radius, gray.rows - 1) + 1;
+    for(int x = 0; x < gray.cols; x++)
+    {
+      int x0 = max(x - radius, 0), x1 = min(x + radius, gray.cols - 1) + 1;
+      double sum = sums.at<double>(y1, x1) - sums.at<double>(y0, x1) - sums.at<double>(y1, x0) + sums.at<double>(y0, x0);
+      double area = (double)(x1 - x0) * (y1 - y0);
+      dark.at<uint8_t>(y, x) = (gray.at<uint8_t>(y, x) + offset) * area < sum ? 255 : 0;
+    }
+  }
+  return dark;
+}
+
+static void check(const string & name, const Mat & gray)
+{
+  static const int RADIUS[] = {0, 1, 5, 30, 200};
+  static const int OFFSET[] = {0, 5, 20};
+  for(int radius : RADIUS)
+  {
+    for(int offset : OFFSET)
+    {
+      EdgeMap map;
+      Mat dark;
+      binarize(gray, map, radius, offset);
+      decodeEdges(map, dark);
+      if(countNonZero(dark != referenceBinarize(gray, radius, offset)) != 0)
+      {
+        printf("FAIL %s: radius %d, offset %d\n", name.c_str(), radius, offset);
+        failures++;
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char ** argv)
+{
+  string images = argc > 1 ? argv[1] : ".";
+  int samples = 0;
+  for(int i = 0;; i++, samples++)
+  {
+    string name = "test" + to_string(i) + ".jpg";
+    Mat gray = imread(images + "/" + name, IMREAD_GRAYSCALE);
+    if(gray.empty())
+      break;
+    Mat median;
+    medianBlur(gray, median, 3);
+    check(name, median);
+  }
+  if(samples == 0)
+  {
+    printf("FAIL no sample image in %s\n", images.c_str());
+    failures++;
+  }
+
+  RNG rng(1);
+  for(int i = 0; i < 100; i++)
+  {
+    Mat gray(rng.uniform(1, 90), rng.uniform(1, 130), CV_8UC1);
+    rng.fill(gray, RNG::UNIFORM, 0, 256);
+    if(i % 2)
+      GaussianBlur(gray, gray, Size(5, 5), 0);
+    check("random " + to_string(i), gray);
+  }
+
+  printf("%d failures\n", failures);
+  return failures != 0;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file corpusTest.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file writes frame corpora with the CorpusWriter of the firmware and reads them back
+ *         with the CorpusReader: the frames (grayscale and colour Mat, some not continuous, and
+ *         camera frame buffers) come back byte for byte, a reopened corpus goes on after its last
+ *         frame, and what is left past the end of a corpus after a reset is not taken as frames:
+ *         the frames of an older session of the file, the frames of another corpus and a frame
+ *         without its trailer.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <frameCorpus.hpp>
+#include <corpusReader.hpp>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+
+static int failures = 0;
+
+// The sensor of the tests: none, the settings of the frames are left at 0
+sensor_t * esp_camera_sensor_get(void)
+{
+  return NULL;
+}
+
+static void expect(bool condition, const char * what)
+{
+  if(!condition)
+  {
+    printf("FAIL %s\n", what);
+    failures++;
+  }
+}
+
+static Mat randomFrame(int rows, int cols, int type, uint64 seed)
+{
+  Mat frame(rows, cols, type);
+  RNG rng(seed);
+  rng.fill(frame, RNG::UNIFORM, 0, 256);
+  return frame;
+}
+
+static bool sameBytes(const Mat & a, const Mat & b)
+{
+  if(a.size() != b.size() || a.type() != b.type())
+    return false;
+  for(int r = 0; r < a.rows; r++)
+  {
+    if(memcmp(a.ptr(r), b.ptr(r), a.cols * a.elemSize()) != 0)
+      return false;
+  }
+  return true;
+}
+
+static vector<uint8_t> readFile(const string & path)
+{
+  vector<uint8_t> bytes;
+  FILE * file = fopen(path.c_str(), "rb");
+  if(file == NULL)
+    return bytes;
+  fseek(file, 0, SEEK_END);
+  bytes.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  if(fread(bytes.data(), 1, bytes.size(), file) != bytes.size())
+    bytes.clear();
+  fclose(file);
+  return bytes;
+}
+
+static void writeFile(const string & path, const uint8_t * data, size_t len)
+{
+  FILE * file = fopen(path.c_str(), "wb");
+  if(file != NULL)
+  {
+    fwrite(data, 1, len, file);
+    fclose(file);
+  }
+}
+
+// Frames a corpus reads back as
+static size_t framesRead(const string & path)
+{
+  CorpusReader reader;
+  return reader.open(path) ? reader.size() : 0;
+}
+
+// Frames a corpus is reopened with
+static unsigned int framesReopened(const string & path)
+{
+  CorpusWriter writer;
+  return writer.open(path) ? writer.frames() : 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Mat and frame buffers, and the corpus reopened
+static void roundTrip(const string & path)
+{
+  unlink(path.c_str());
+  vector<Mat> frames;
+  frames.push_back(randomFrame(600, 800, CV_8UC1, 1));
+  frames.push_back(randomFrame(37, 53, CV_8UC3, 2));
+  frames.push_back(randomFrame(240, 320, CV_8UC1, 3)(Rect(7, 5, 101, 77))); // not continuous
+  frames.push_back(randomFrame(120, 160, CV_8UC2, 4));
+
+  CorpusWriter writer;
+  expect(writer.open(path), "create the corpus");
+  const pixformat_t formats[] = {PIXFORMAT_GRAYSCALE, PIXFORMAT_RGB888, PIXFORMAT_GRAYSCALE, PIXFORMAT_RGB565};
+  for(size_t i = 0; i < frames.size(); i++)
+    expect(writer.append(frames[i], formats[i], i, 1000 * i), "append a Mat");
+
+  // A JPEG frame is kept as a row of bytes
+  Mat jpeg = randomFrame(1, 4321, CV_8UC1, 5);
+  camera_fb_t fb;
+  memset(&fb, 0, sizeof(fb));
+  fb.buf = jpeg.data;
+  fb.len = jpeg.cols;
+  fb.width = 640;
+  fb.height = 480;
+  fb.format = PIXFORMAT_JPEG;
+  fb.timestamp.tv_sec = 9;
+  expect(writer.append(&fb, 9), "append a JPEG frame buffer");
+  writer.close();
+
+  CorpusReader reader;
+  expect(reader.open(path) && reader.size() == frames.size() + 1, "read the frames back");
+  for(size_t i = 0; i < frames.size() && i < reader.size(); i++)
+  {
+    expect(sameBytes(reader.frame(i), frames[i]), "frame read back");
+    expect((uintptr_t)reader.payload(i) % CORPUS_ALIGN == 0, "aligned payload");
+  }
+  if(reader.size() == frames.size() + 1)
+  {
+    camera_fb_t back;
+    reader.frameBuffer(frames.size(), back);
+    expect(back.len == fb.len && memcmp(back.buf, fb.buf, fb.len) == 0 && back.format == PIXFORMAT_JPEG &&
+           back.width == 640 && back.timestamp.tv_sec == 9, "JPEG frame buffer read back");
+  }
+  reader.close();
+
+  // Reopened: the frames go on after the last one, with lower ids too (a session per opening)
+  expect(writer.open(path) && writer.frames() == frames.size() + 1, "reopen the corpus");
+  expect(writer.append(frames[0], PIXFORMAT_GRAYSCALE, 0, 0), "append after reopening");
+  writer.close();
+  expect(framesRead(path) == frames.size() + 2, "frames after reopening");
+}
+
+// Reset: the bytes past the last frame are left by an older session, another corpus, a cut frame
+static void leftovers(const string & path)
+{
+  // 10 frames of the same size, so an older session leaves whole records where the next ends
+  unlink(path.c_str());
+  CorpusWriter writer;
+  writer.open(path);
+  for(int i = 0; i < 10; i++)
+    writer.append(randomFrame(48, 64, CV_8UC1, 10 + i), PIXFORMAT_GRAYSCALE, i, 1000 * i);
+  writer.close();
+  vector<uint8_t> full = readFile(path);
+  size_t record = corpusRecordSize(48 * 64);
+  expect(full.size() == sizeof(CorpusFileHeader) + 10 * record && framesRead(path) == 10, "corpus of 10 frames");
+
+  // A frame without its trailer ends the corpus
+  vector<uint8_t> cut = full;
+  memset(&cut[sizeof(CorpusFileHeader) + 8 * record - sizeof(CorpusFrameTrailer)], 0, sizeof(CorpusFrameTrailer));
+  writeFile(path, cut.data(), cut.size());
+  expect(framesRead(path) == 7, "frame cut by a reset (reader)");
+  expect(framesReopened(path) == 7, "frame cut by a reset (writer)");
+
+  // Kept 3 frames, then 2 more with ids and timestamps going on, and the older session past them
+  writeFile(path, full.data(), sizeof(CorpusFileHeader) + 3 * record);
+  writer.open(path);
+  for(int i = 0; i < 2; i++)
+    writer.append(randomFrame(48, 64, CV_8UC1, 20 + i), PIXFORMAT_GRAYSCALE, 10 + i, 10000 + 1000 * i);
+  writer.close();
+  vector<uint8_t> reopened = readFile(path);
+  reopened.insert(reopened.end(), full.begin() + reopened.size(), full.end());
+  writeFile(path, reopened.data(), reopened.size());
+  expect(framesRead(path) == 5, "older session past the frames (reader)");
+  expect(framesReopened(path) == 5, "older session past the frames (writer)");
+
+  // The same with ids and timestamps going back: the frames after the reopening are a new session
+  writeFile(path, full.data(), sizeof(CorpusFileHeader) + 3 * record);
+  writer.open(path);
+  for(int i = 0; i < 2; i++)
+    writer.append(randomFrame(48, 64, CV_8UC1, 30 + i), PIXFORMAT_GRAYSCALE, i, 1000 * i);
+  writer.close();
+  reopened = readFile(path);
+  reopened.insert(reopened.end(), full.begin() + reopened.size(), full.end());
+  writeFile(path, reopened.data(), reopened.size());
+  expect(framesRead(path) == 5, "older session with the same ids past the frames");
+
+  // Another corpus in the clusters of a new one
+  unlink(path.c_str());
+  writer.open(path);
+  for(int i = 0; i < 2; i++)
+    writer.append(randomFrame(48, 64, CV_8UC1, 40 + i), PIXFORMAT_GRAYSCALE, i, 1000 * i);
+  writer.close();
+  vector<uint8_t> other = readFile(path);
+  other.insert(other.end(), full.begin() + other.size(), full.end());
+  writeFile(path, other.data(), other.size());
+  expect(framesRead(path) == 2, "another corpus past the frames");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char ** argv)
+{
+  string path = argc > 1 ? argv[1] : "corpusTest.sqc";
+  roundTrip(path);
+  leftovers(path);
+  unlink(path.c_str());
+
+  if(failures > 0)
+  {
+    printf("%d failures\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file edgeRunsTest.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file checks the run-length edge maps against OpenCV: encodeEdges and decodeEdges
+ *         give back the image, dilateEdges gives the image of dilate, and findEdgeContours gives
+ *         the contours of findContours(RETR_TREE, CHAIN_APPROX_SIMPLE), point by point (their
+ *         order is not compared, findEdgeContours lists them in raster order). The images are the
+ *         Canny output of the sample images, at full size and at 800x600, and random binary
+ *         images.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <edgeRuns.hpp>
+#include <stdio.h>
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+static int failures = 0;
+
+static bool lessPoint(const Point & a, const Point & b)
+{
+  return a.y != b.y ? a.y < b.y : a.x < b.x;
+}
+
+static bool lessContour(const vector<Point> & a, const vector<Point> & b)
+{
+  return lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), lessPoint);
+}
+
+// Everything on one binary image, dilated first or not
+static void check(const string & name, const Mat & binary, bool dilated)
+{
+  EdgeMap map, regions;
+  encodeEdges(binary, map);
+
+  Mat decoded;
+  decodeEdges(map, decoded);
+  if(countNonZero(decoded != (binary != 0)) != 0)
+  {
+    printf("FAIL %s: encodeEdges/decodeEdges\n", name.c_str());
+    failures++;
+    return;
+  }
+
+  Mat expected = binary != 0;
+  if(dilated)
+  {
+    dilate(expected, expected, Mat());
+    dilateEdges(map, regions);
+    decodeEdges(regions, decoded);
+    if(countNonZero(decoded != expected) != 0)
+    {
+      printf("FAIL %s: dilateEdges\n", name.c_str());
+      failures++;
+      return;
+    }
+  }
+
+  vector<vector<Point>> reference;
+  vector<Vec4i> hierarchy;
+  findContours(expected.clone(), reference, hierarchy, RETR_TREE, CHAIN_APPROX_SIMPLE);
+
+  pmr::monotonic_buffer_resource memory;
+  ContourList found(&memory);
+  findEdgeContours(dilated ? regions : map, found);
+  vector<vector<Point>> contours;
+  for(const Contour & contour : found)
+    contours.push_back(vector<Point>(contour.begin(), contour.end()));
+
+  sort(reference.begin(), reference.end(), lessContour);
+  sort(contours.begin(), contours.end(), lessContour);
+  if(contours != reference)
+  {
+    printf("FAIL %s%s: %zu contours, findContours %zu\n", name.c_str(), dilated ? " (dilated)" : "", contours.size(),
+           reference.size());
+    failures++;
+  }
+}
+
+// Edges of a sample image as the detection finds them: median, Gaussian blur and Canny
+static Mat cannyEdges(const Mat & gray)
+{
+  Mat median, blurred, edges;
+  medianBlur(gray, median, 3);
+  GaussianBlur(median, blurred, Size(3, 3), 0);
+  Canny(blurred, edges, 30, 80);
+  return edges;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char ** argv)
+{
+  string images = argc > 1 ? argv[1] : ".";
+  int samples = 0;
+  for(int i = 0;; i++, samples++)
+  {
+    string name = "test" + to_string(i) + ".jpg";
+    Mat gray = imread(images + "/" + name, IMREAD_GRAYSCALE);
+    if(gray.empty())
+      break;
+    Mat resized;
+    resize(gray, resized, Size(800, 600));
+    for(bool dilated : {false, true})
+    {
+      check(name, cannyEdges(gray), dilated);
+      check(name + " 800x600", cannyEdges(resized), dilated);
+    }
+  }
+  if(samples == 0)
+  {
+    printf("FAIL no sample image in %s\n", images.c_str());
+    failures++;
+  }
+
+  // Random images: noise (single pixels, touching diagonals) and shapes (holes, nested borders)
+  RNG rng(1);
+  for(int i = 0; i < 300; i++)
+  {
+    Mat binary(rng.uniform(1, 120), rng.uniform(1, 160), CV_8UC1);
+    if(i % 2 == 0)
+    {
+      rng.fill(binary, RNG::UNIFORM, 0, 256);
+      binary = binary > rng.uniform(100, 250);
+    }
+    else
+    {
+      binary.setTo(0);
+      for(int k = 0; k < 12; k++)
+      {
+        Point p(rng.uniform(0, binary.cols), rng.uniform(0, binary.rows));
+        int size = rng.uniform(1, 40);
+        if(k % 3 == 0)
+          circle(binary, p, size, Scalar(k % 2 ? 0 : 255), rng.uniform(0, 2) ? FILLED : 1);
+        else
+          rectangle(binary, Rect(p.x, p.y, size, rng.uniform(1, 40)), Scalar(k % 2 ? 0 : 255),
+                    rng.uniform(0, 2) ? FILLED : 1);
+      }
+    }
+    check("random " + to_string(i), binary, i % 3 == 0);
+  }
+
+  printf("%d failures\n", failures);
+  return failures != 0;
+}
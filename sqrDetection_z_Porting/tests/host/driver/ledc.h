@@ -0,0 +1,34 @@
+/**
+ * @file ledc.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the ESP-IDF header in the host builds of the tests: the types
+ *         esp_camera.h needs for camera_config_t.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_LEDC_H
+#define __HOST_LEDC_H
+
+typedef enum {
+  LEDC_TIMER_0 = 0,
+  LEDC_TIMER_1,
+  LEDC_TIMER_2,
+  LEDC_TIMER_3,
+} ledc_timer_t;
+
+typedef enum {
+  LEDC_CHANNEL_0 = 0,
+  LEDC_CHANNEL_1,
+  LEDC_CHANNEL_2,
+  LEDC_CHANNEL_3,
+  LEDC_CHANNEL_4,
+  LEDC_CHANNEL_5,
+  LEDC_CHANNEL_6,
+  LEDC_CHANNEL_7,
+} ledc_channel_t;
+
+#endif // __HOST_LEDC_H
@@ -0,0 +1,31 @@
+/**
+ * @file esp_heap_caps.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the ESP-IDF header in the host builds of the tests: every
+ *         capability is the heap, and it is never short of memory.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_ESP_HEAP_CAPS_H
+#define __HOST_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+#define heap_caps_malloc(size, caps)  malloc(size)
+#define heap_caps_calloc(n, size, caps) calloc(n, size)
+#define heap_caps_aligned_alloc(alignment, size, caps) aligned_alloc(alignment, size)
+#define heap_caps_free(ptr) free(ptr)
+#define heap_caps_get_free_size(caps) SIZE_MAX
+#define heap_caps_get_largest_free_block(caps) SIZE_MAX
+
+#endif // __HOST_ESP_HEAP_CAPS_H
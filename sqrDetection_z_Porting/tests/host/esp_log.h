@@ -0,0 +1,24 @@
+/**
+ * @file esp_log.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the ESP-IDF header in the host builds of the tests: errors and
+ *         warnings go to stderr, the rest is dropped.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_ESP_LOG_H
+#define __HOST_ESP_LOG_H
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do { (void)(tag); } while(0)
+#define ESP_LOGD(tag, format, ...) do { (void)(tag); } while(0)
+#define ESP_LOGV(tag, format, ...) do { (void)(tag); } while(0)
+
+#endif // __HOST_ESP_LOG_H
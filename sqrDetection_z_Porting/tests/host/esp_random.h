@@ -0,0 +1,32 @@
+/**
+ * @file esp_random.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the ESP-IDF header in the host builds of the tests: the random
+ *         numbers come from the random device of the system.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_ESP_RANDOM_H
+#define __HOST_ESP_RANDOM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+static inline uint32_t esp_random(void)
+{
+  uint32_t value = 0;
+  FILE * device = fopen("/dev/urandom", "rb");
+  if(device != NULL)
+  {
+    if(fread(&value, sizeof(value), 1, device) != 1)
+      value = 0;
+    fclose(device);
+  }
+  return value;
+}
+
+#endif // __HOST_ESP_RANDOM_H
@@ -0,0 +1,17 @@
+/**
+ * @file esp_system.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the ESP-IDF header in the host builds of the tests.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_ESP_SYSTEM_H
+#define __HOST_ESP_SYSTEM_H
+
+#include "esp_err.h"
+
+#endif // __HOST_ESP_SYSTEM_H
@@ -0,0 +1,26 @@
+/**
+ * @file esp_timer.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the ESP-IDF header in the host builds of the tests: the time
+ *         since boot is the monotonic clock.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_ESP_TIMER_H
+#define __HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int64_t esp_timer_get_time(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+#endif // __HOST_ESP_TIMER_H
@@ -0,0 +1,16 @@
+/**
+ * @file sdkconfig.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file stands in for the configuration ESP-IDF generates, in the host builds of the
+ *         tests: no option is set, the code takes its defaults.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __HOST_SDKCONFIG_H
+#define __HOST_SDKCONFIG_H
+
+#endif // __HOST_SDKCONFIG_H
@@ -0,0 +1,83 @@
+/**
+ * @file jpegDecodeBench.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file times the TJpgDec of the baseline and esp_jpg_decode (built with the
+ *         JD_FASTDECODE of the target) on the sample images and on synthetic SVGA and UXGA 4:2:2
+ *         frames, in microseconds per decode to RGB888.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpegUtils.h"
+#include "reference/reference.h"
+#include "esp_jpg_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RUNS 10
+
+// Best of RUNS decodes with both decoders
+static void bench(const char *name, const uint8_t *jpeg, size_t len)
+{
+  double reference = 1e30, current = 1e30;
+  int width = 0, height = 0;
+  for(int run = 0; run < RUNS; run++)
+  {
+    double start = nowUs();
+    free(reference_jpeg_decode(jpeg, len, 0, &width, &height));
+    double elapsed = nowUs() - start;
+    if(elapsed < reference)
+      reference = elapsed;
+  }
+  jpeg_decode_t out = {jpeg, len, malloc((size_t)width * height * 3), width, height, 3};
+  for(int run = 0; run < RUNS; run++)
+  {
+    double start = nowUs();
+    esp_jpg_decode(len, JPG_SCALE_NONE, readStream, writeOutput, &out);
+    double elapsed = nowUs() - start;
+    if(elapsed < current)
+      current = elapsed;
+  }
+  free(out.data);
+  printf("%-24s %7zu %10.0f %10.0f %7.2fx\n", name, len, reference, current, reference / current);
+}
+
+int main(int argc, char **argv)
+{
+  const char *images = argc > 1 ? argv[1] : ".";
+  char name[256];
+  uint8_t *jpeg;
+  size_t len;
+
+  printf("JD_FASTDECODE %d\n%-24s %7s %10s %10s %8s\n", JD_FASTDECODE, "us per decode", "bytes", "reference",
+         "current", "speedup");
+  for(int i = 0;; i++)
+  {
+    snprintf(name, sizeof(name), "%s/test%d.jpg", images, i);
+    if((jpeg = loadFile(name, &len)) == NULL)
+      break;
+    snprintf(name, sizeof(name), "test%d.jpg", i);
+    bench(name, jpeg, len);
+    free(jpeg);
+  }
+
+  static const int SIZE[][2] = {{800, 600}, {1600, 1200}};
+  static const int QUALITY[] = {50, 80, 95};
+  for(int z = 0; z < 2; z++)
+  {
+    uint8_t *rgb = malloc((size_t)SIZE[z][0] * SIZE[z][1] * 3);
+    synthFrame(rgb, SIZE[z][0], SIZE[z][1], 1, false);
+    for(int q = 0; q < 3; q++)
+    {
+      len = encodeJpeg(rgb, SIZE[z][0], SIZE[z][1], QUALITY[q], 2, 1, 0, &jpeg);
+      snprintf(name, sizeof(name), "%dx%d q%d", SIZE[z][0], SIZE[z][1], QUALITY[q]);
+      bench(name, jpeg, len);
+      free(jpeg);
+    }
+    free(rgb);
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file jpegDecodeTest.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file checks that esp_jpg_decode gives the output of the TJpgDec of the baseline,
+ *         byte for byte, at every scale: on the sample images, on them re-encoded with other
+ *         qualities, samplings and restart intervals, on synthetic frames (up to UXGA, and sizes not
+ *         multiple of the MCU) and on corrupted and truncated streams, that have to fail in the same
+ *         way.
+ *         Built once per JD_FASTDECODE, the lookahead decoder and the bit by bit one.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpegUtils.h"
+#include "reference/reference.h"
+#include "esp_jpg_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+static int checks = 0;
+
+// Size in the SOF0 marker, 0x0 if there is none
+static void jpegSize(const uint8_t *jpeg, size_t len, int *width, int *height)
+{
+  *width = *height = 0;
+  for(size_t i = 2; i + 8 < len && jpeg[i] == 0xFF; i += 2 + ((jpeg[i + 2] << 8) | jpeg[i + 3]))
+  {
+    if(jpeg[i + 1] == 0xC0)
+    {
+      *height = (jpeg[i + 5] << 8) | jpeg[i + 6];
+      *width = (jpeg[i + 7] << 8) | jpeg[i + 8];
+      return;
+    }
+  }
+}
+
+// Decode at every scale with both decoders, corrupted and truncated too when damage is set
+static void check(const char *name, const uint8_t *jpeg, size_t len, bool damage)
+{
+  int width, height;
+  jpegSize(jpeg, len, &width, &height);
+  for(int scale = 0; scale < 4; scale++)
+  {
+    int w = 0, h = 0;
+    uint8_t *expected = reference_jpeg_decode(jpeg, len, scale, &w, &h);
+    jpeg_decode_t out = {jpeg, len, calloc((size_t)(width >> scale) * (height >> scale) * 3 + 1, 1), width >> scale,
+                         height >> scale, 3};
+    esp_err_t err = esp_jpg_decode(len, (jpg_scale_t)scale, readStream, writeOutput, &out);
+    checks++;
+    if((expected == NULL) != (err != ESP_OK) ||
+       (expected != NULL && (w != out.width || h != out.height || memcmp(expected, out.data, (size_t)w * h * 3) != 0)))
+    {
+      printf("FAIL %s: scale %d, reference %s, esp_jpg_decode %s\n", name, scale, expected ? "ok" : "failed",
+             err == ESP_OK ? "ok" : "failed");
+      failures++;
+    }
+    free(expected);
+    free(out.data);
+  }
+  if(!damage)
+    return;
+
+  // Bytes flipped in the entropy-coded data, and the stream cut at 2/3
+  uint8_t *corrupted = malloc(len);
+  memcpy(corrupted, jpeg, len);
+  for(size_t i = len / 2; i < len - 2; i += 97)
+    corrupted[i] ^= 0x5A;
+  char damaged[128];
+  snprintf(damaged, sizeof(damaged), "%s (corrupted)", name);
+  check(damaged, corrupted, len, false);
+  snprintf(damaged, sizeof(damaged), "%s (truncated)", name);
+  check(damaged, jpeg, len * 2 / 3, false);
+  free(corrupted);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  const char *images = argc > 1 ? argv[1] : ".";
+  char name[256];
+  uint8_t *jpeg;
+  size_t len;
+
+  // Sample images, and them re-encoded: OV2640 4:2:2 with restart intervals, 4:2:0, 4:4:4
+  static const int SAMPLING[][2] = {{2, 1}, {2, 2}, {1, 1}};
+  static const int QUALITY[] = {10, 50, 95};
+  static const int RESTART[] = {0, 1, 7, 40};
+  int samples = 0;
+  for(int i = 0;; i++, samples++)
+  {
+    snprintf(name, sizeof(name), "%s/test%d.jpg", images, i);
+    uint8_t *sample = loadFile(name, &len);
+    if(sample == NULL)
+      break;
+    check(name, sample, len, true);
+
+    int width, height;
+    uint8_t *rgb = reference_jpeg_decode(sample, len, 0, &width, &height);
+    for(int s = 0; rgb != NULL && s < 3; s++)
+    {
+      for(int q = 0; q < 3; q++)
+      {
+        for(int r = 0; r < 4; r++)
+        {
+          len = encodeJpeg(rgb, width, height, QUALITY[q], SAMPLING[s][0], SAMPLING[s][1], RESTART[r], &jpeg);
+          snprintf(name, sizeof(name), "test%d.jpg %d:%d q%d rst%d", i, SAMPLING[s][0], SAMPLING[s][1], QUALITY[q],
+                   RESTART[r]);
+          check(name, jpeg, len, false);
+          free(jpeg);
+        }
+      }
+    }
+    free(rgb);
+    free(sample);
+  }
+  if(samples == 0)
+  {
+    printf("FAIL no sample image in %s\n", images);
+    failures++;
+  }
+
+  // Synthetic frames, grey and colour
+  static const int SIZE[][2] = {{320, 240}, {640, 480}, {800, 600}, {1600, 1200}, {333, 217}};
+  for(int z = 0; z < 5; z++)
+  {
+    int width = SIZE[z][0], height = SIZE[z][1];
+    uint8_t *rgb = malloc((size_t)width * height * 3);
+    for(int q = 0; q < 3; q++)
+    {
+      for(int r = 0; r < 4; r++)
+      {
+        synthFrame(rgb, width, height, q * 4 + r, r == 3);
+        len = encodeJpeg(rgb, width, height, QUALITY[q], 2, 1, RESTART[r], &jpeg);
+        snprintf(name, sizeof(name), "%dx%d q%d rst%d", width, height, QUALITY[q], RESTART[r]);
+        check(name, jpeg, len, q == 1);
+        free(jpeg);
+      }
+    }
+    free(rgb);
+  }
+
+  printf("%d decodes (JD_FASTDECODE %d), %d failures\n", checks, JD_FASTDECODE, failures);
+  return failures != 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file jpegSplitBench.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file times esp_jpg_decode_split against the single-band decoders on SVGA and UXGA
+ *         4:2:2 frames with a restart marker every MCU row, in microseconds per decode. The
+ *         speedup needs a second core: on a single-core host the two bands run one after the
+ *         other.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpegUtils.h"
+#include "esp_jpg_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define RUNS 10
+
+// Best of RUNS decodes, split or single band
+static double bench(const uint8_t *jpeg, size_t len, int width, int height, bool gray, bool split)
+{
+  jpeg_decode_t out = {jpeg, len, malloc((size_t)width * height * 3), width, height, gray ? 1 : 3};
+  double best = 1e30;
+  for(int run = 0; run < RUNS; run++)
+  {
+    double start = nowUs();
+    if(split)
+      esp_jpg_decode_split(jpeg, len, JPG_SCALE_NONE, gray, writeOutput, &out);
+    else if(gray)
+      esp_jpg_decode_gray(len, JPG_SCALE_NONE, readStream, writeOutput, &out);
+    else
+      esp_jpg_decode(len, JPG_SCALE_NONE, readStream, writeOutput, &out);
+    double elapsed = nowUs() - start;
+    if(elapsed < best)
+      best = elapsed;
+  }
+  free(out.data);
+  return best;
+}
+
+int main(void)
+{
+  static const int SIZE[][2] = {{800, 600}, {1600, 1200}};
+
+  printf("host cores: %ld\n%-24s %10s %10s %8s\n", sysconf(_SC_NPROCESSORS_ONLN), "us per decode", "single",
+         "split", "speedup");
+  for(int z = 0; z < 2; z++)
+  {
+    int width = SIZE[z][0], height = SIZE[z][1];
+    uint8_t *rgb = malloc((size_t)width * height * 3), *jpeg;
+    synthFrame(rgb, width, height, 1, false);
+    // 4:2:2 MCUs are 16x8: one row of them per interval
+    size_t len = encodeJpeg(rgb, width, height, 80, 2, 1, width / 16, &jpeg);
+    for(int gray = 0; gray < 2; gray++)
+    {
+      double single = bench(jpeg, len, width, height, gray, false);
+      double split = bench(jpeg, len, width, height, gray, true);
+      char name[64];
+      snprintf(name, sizeof(name), "%dx%d %s", width, height, gray ? "luma" : "RGB888");
+      printf("%-24s %10.0f %10.0f %7.2fx\n", name, single, split, single / split);
+    }
+    free(jpeg);
+    free(rgb);
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file jpegSplitTest.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file checks that esp_jpg_decode_split gives the output of the single-band decoders,
+ *         byte for byte at every scale: RGB888 against esp_jpg_decode and luma against
+ *         esp_jpg_decode_gray. The streams are the sample images re-encoded and synthetic frames,
+ *         with restart intervals that split them in row bands, in MCUs, or not at all.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpegUtils.h"
+#include "reference/reference.h"
+#include "esp_jpg_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+static int checks = 0;
+
+// Decode at every scale, split and single band, RGB888 and luma
+static void check(const char *name, const uint8_t *jpeg, size_t len, int width, int height)
+{
+  for(int scale = 0; scale < 4; scale++)
+  {
+    int w = width >> scale, h = height >> scale;
+    for(int bpp = 1; bpp <= 3; bpp += 2)
+    {
+      size_t size = (size_t)w * h * bpp;
+      jpeg_decode_t single = {jpeg, len, calloc(size + 1, 1), w, h, bpp};
+      jpeg_decode_t split = {jpeg, len, calloc(size + 1, 1), w, h, bpp};
+      esp_err_t err = bpp == 3 ? esp_jpg_decode(len, (jpg_scale_t)scale, readStream, writeOutput, &single)
+                               : esp_jpg_decode_gray(len, (jpg_scale_t)scale, readStream, writeOutput, &single);
+      esp_err_t splitErr = esp_jpg_decode_split(jpeg, len, (jpg_scale_t)scale, bpp == 1, writeOutput, &split);
+      checks++;
+      if(err != ESP_OK || splitErr != ESP_OK || memcmp(single.data, split.data, size) != 0)
+      {
+        printf("FAIL %s: scale %d, %s\n", name, scale, bpp == 3 ? "RGB888" : "luma");
+        failures++;
+      }
+      free(single.data);
+      free(split.data);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  const char *images = argc > 1 ? argv[1] : ".";
+  char name[256];
+  uint8_t *jpeg;
+  size_t len;
+
+  // OV2640 4:2:2, 4:2:0 and 4:4:4; intervals of one MCU, a few MCUs, one and two MCU rows
+  static const int SAMPLING[][2] = {{2, 1}, {2, 2}, {1, 1}};
+  static const int RESTART[] = {0, 1, 7, 20, 40, 80};
+  int samples = 0;
+  for(int i = 0;; i++, samples++)
+  {
+    snprintf(name, sizeof(name), "%s/test%d.jpg", images, i);
+    uint8_t *sample = loadFile(name, &len);
+    if(sample == NULL)
+      break;
+    int width, height;
+    uint8_t *rgb = reference_jpeg_decode(sample, len, 0, &width, &height);
+    for(int s = 0; rgb != NULL && s < 3; s++)
+    {
+      for(int r = 0; r < 6; r++)
+      {
+        len = encodeJpeg(rgb, width, height, 80, SAMPLING[s][0], SAMPLING[s][1], RESTART[r], &jpeg);
+        snprintf(name, sizeof(name), "test%d.jpg %d:%d rst%d", i, SAMPLING[s][0], SAMPLING[s][1], RESTART[r]);
+        check(name, jpeg, len, width, height);
+        free(jpeg);
+      }
+    }
+    free(rgb);
+    free(sample);
+  }
+  if(samples == 0)
+  {
+    printf("FAIL no sample image in %s\n", images);
+    failures++;
+  }
+
+  // Synthetic frames, the last one with a partial MCU row and intervals not dividing a row
+  static const int SIZE[][2] = {{640, 480}, {800, 600}, {1600, 1200}, {333, 217}};
+  static const int SYNTH_RESTART[] = {0, 1, 5, 50, 100, 333};
+  for(int z = 0; z < 4; z++)
+  {
+    int width = SIZE[z][0], height = SIZE[z][1];
+    uint8_t *rgb = malloc((size_t)width * height * 3);
+    for(int r = 0; r < 6; r++)
+    {
+      synthFrame(rgb, width, height, r, r % 2 == 1);
+      len = encodeJpeg(rgb, width, height, 80, SAMPLING[r % 3][0], SAMPLING[r % 3][1], SYNTH_RESTART[r], &jpeg);
+      snprintf(name, sizeof(name), "%dx%d rst%d", width, height, SYNTH_RESTART[r]);
+      check(name, jpeg, len, width, height);
+      free(jpeg);
+    }
+    free(rgb);
+  }
+
+  printf("%d decodes, %d failures\n", checks, failures);
+  return failures != 0;
+}
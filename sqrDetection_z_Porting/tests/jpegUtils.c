@@ -0,0 +1,154 @@
+/**
+ * @file jpegUtils.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file implements the helpers of the JPEG tests.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpegUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <jpeglib.h>
+
+size_t encodeJpeg(const uint8_t *rgb, int width, int height, int quality, int hSampling, int vSampling, int restart,
+                  uint8_t **jpeg)
+{
+  struct jpeg_compress_struct encoder;
+  struct jpeg_error_mgr error;
+  unsigned char *out = NULL;
+  unsigned long len = 0;
+
+  encoder.err = jpeg_std_error(&error);
+  jpeg_create_compress(&encoder);
+  jpeg_mem_dest(&encoder, &out, &len);
+  encoder.image_width = width;
+  encoder.image_height = height;
+  encoder.input_components = 3;
+  encoder.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&encoder);
+  jpeg_set_quality(&encoder, quality, TRUE);
+  encoder.comp_info[0].h_samp_factor = hSampling;
+  encoder.comp_info[0].v_samp_factor = vSampling;
+  for(int c = 1; c < 3; c++)
+  {
+    encoder.comp_info[c].h_samp_factor = 1;
+    encoder.comp_info[c].v_samp_factor = 1;
+  }
+  encoder.restart_interval = restart;
+
+  jpeg_start_compress(&encoder, TRUE);
+  while(encoder.next_scanline < (unsigned int)height)
+  {
+    JSAMPROW row = (JSAMPROW)(rgb + (size_t)encoder.next_scanline * width * 3);
+    jpeg_write_scanlines(&encoder, &row, 1);
+  }
+  jpeg_finish_compress(&encoder);
+  jpeg_destroy_compress(&encoder);
+  *jpeg = out;
+  return len;
+}
+
+uint8_t *decodeJpeg(const uint8_t *jpeg, size_t len, int components, int *width, int *height, long *warnings)
+{
+  struct jpeg_decompress_struct decoder;
+  struct jpeg_error_mgr error;
+
+  decoder.err = jpeg_std_error(&error);
+  jpeg_create_decompress(&decoder);
+  jpeg_mem_src(&decoder, jpeg, len);
+  if(jpeg_read_header(&decoder, TRUE) != JPEG_HEADER_OK)
+  {
+    jpeg_destroy_decompress(&decoder);
+    return NULL;
+  }
+  decoder.out_color_space = components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_start_decompress(&decoder);
+  *width = decoder.output_width;
+  *height = decoder.output_height;
+  uint8_t *out = malloc((size_t)*width * *height * components);
+  while(decoder.output_scanline < decoder.output_height)
+  {
+    JSAMPROW row = out + (size_t)decoder.output_scanline * *width * components;
+    jpeg_read_scanlines(&decoder, &row, 1);
+  }
+  jpeg_finish_decompress(&decoder);
+  *warnings = error.num_warnings;
+  jpeg_destroy_decompress(&decoder);
+  return out;
+}
+
+void synthFrame(uint8_t *rgb, int width, int height, unsigned int seed, bool gray)
+{
+  srand(seed);
+  for(int y = 0; y < height; y++)
+  {
+    for(int x = 0; x < width; x++)
+    {
+      int v = ((x / 37 + y / 29) & 1) ? 200 : 40;
+      v += (x * y / 97) % 23 + rand() % 16;
+      if((x - width / 2) * (x - width / 2) + (y - height / 3) * (y - height / 3) < width * width / 40)
+        v = 255 - v / 2;
+      if(v > 255)
+        v = 255;
+      uint8_t *p = rgb + ((size_t)y * width + x) * 3;
+      p[0] = v;
+      p[1] = gray ? v : (uint8_t)(x * 255 / width);
+      p[2] = gray ? v : (uint8_t)(y * 3 + v);
+    }
+  }
+}
+
+uint8_t *loadFile(const char *path, size_t *len)
+{
+  FILE *file = fopen(path, "rb");
+  if(file == NULL)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = malloc(*len);
+  if(data != NULL && fread(data, 1, *len, file) != *len)
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+size_t readStream(void *arg, size_t index, uint8_t *buf, size_t len)
+{
+  const jpeg_decode_t *in = (const jpeg_decode_t *)arg;
+  if(index + len > in->len)
+    len = in->len - index;
+  if(buf != NULL)
+    memcpy(buf, in->jpeg + index, len);
+  return len;
+}
+
+bool writeOutput(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
+{
+  jpeg_decode_t *out = (jpeg_decode_t *)arg;
+  if(data == NULL)
+  {
+    // Start (0, 0) with the size of the image, or end
+    return x != 0 || y != 0 || (w == out->width && h == out->height);
+  }
+  for(int row = 0; row < h; row++)
+    memcpy(out->data + ((size_t)(y + row) * out->width + x) * out->bpp, data + (size_t)row * w * out->bpp,
+           (size_t)w * out->bpp);
+  return true;
+}
+
+double nowUs(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
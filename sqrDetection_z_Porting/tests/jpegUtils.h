@@ -0,0 +1,99 @@
+/**
+ * @file jpegUtils.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the helpers of the JPEG tests: streams made with libjpeg (any
+ *         sampling and restart interval), synthetic frames and the decoders' output callbacks.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __JPEG_UTILS_H
+#define __JPEG_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @brief Encode an RGB888 frame with libjpeg
+ *
+ * @param rgb frame
+ * @param width width of the frame
+ * @param height height of the frame
+ * @param quality 1..100
+ * @param hSampling horizontal luma sampling factor (2 with vSampling 1 is 4:2:2)
+ * @param vSampling vertical luma sampling factor
+ * @param restart restart interval in MCUs, 0 for none
+ * @param jpeg stream (free() it)
+ * @return size_t length of the stream
+ */
+size_t encodeJpeg(const uint8_t *rgb, int width, int height, int quality, int hSampling, int vSampling, int restart,
+                  uint8_t **jpeg);
+
+/**
+ * @brief Decode a JPEG with libjpeg
+ *
+ * @param jpeg stream
+ * @param len length of the stream
+ * @param components 1 for luma, 3 for RGB888
+ * @param width width of the image
+ * @param height height of the image
+ * @param warnings warnings of libjpeg about the stream (corrupt data, bad markers)
+ * @return uint8_t* image (free() it), NULL if the stream could not be decoded
+ */
+uint8_t *decodeJpeg(const uint8_t *jpeg, size_t len, int components, int *width, int *height, long *warnings);
+
+/**
+ * @brief Fill an RGB888 frame with a checkerboard, gradients, a disc and noise
+ *
+ * @param rgb frame
+ * @param width width of the frame
+ * @param height height of the frame
+ * @param seed seed of the noise
+ * @param gray true for equal channels
+ */
+void synthFrame(uint8_t *rgb, int width, int height, unsigned int seed, bool gray);
+
+/**
+ * @brief Read a whole file
+ *
+ * @param path path of the file
+ * @param len length of the file
+ * @return uint8_t* content (free() it), NULL if it could not be read
+ */
+uint8_t *loadFile(const char *path, size_t *len);
+
+/**
+ * @brief Stream to decode and its output, with bpp bytes per pixel (the reader and the writer of
+ *        esp_jpg_decode share their argument)
+ */
+typedef struct {
+  const uint8_t *jpeg;
+  size_t len;
+  uint8_t *data;
+  int width;
+  int height;
+  int bpp;
+} jpeg_decode_t;
+
+// jpg_reader_cb reading the stream of a jpeg_decode_t
+size_t readStream(void *arg, size_t index, uint8_t *buf, size_t len);
+
+// jpg_writer_cb copying the blocks into the output of a jpeg_decode_t, of the size of the image
+bool writeOutput(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+
+// Monotonic time in microseconds
+double nowUs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __JPEG_UTILS_H
@@ -0,0 +1,110 @@
+/**
+ * @file jpgeCommon.hpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains what the jpge test and benchmark share: encoding a frame with the
+ *         encoder under test or with the one of the baseline, and the test frame.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __JPGE_COMMON_HPP
+#define __JPGE_COMMON_HPP
+
+#include "jpge.h"
+#include "reference/jpge.h"
+#include "jpegUtils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+// Stream of either encoder into a vector
+template <class OutputStream>
+struct VectorStream : OutputStream
+{
+  std::vector<uint8_t> data;
+
+  bool put_buf(const void * buf, int len) override
+  {
+    data.insert(data.end(), (const uint8_t *)buf, (const uint8_t *)buf + len);
+    return true;
+  }
+
+  unsigned int get_size() const override
+  {
+    return data.size();
+  }
+};
+
+// Encode a frame of channels bytes per pixel with the jpge of namespace Encoder
+template <class Encoder, class OutputStream, class Params>
+static std::vector<uint8_t> encode(const uint8_t * pixels, int width, int height, int channels, int quality,
+                                   int subsampling)
+{
+  VectorStream<OutputStream> stream;
+  Params params;
+  params.m_quality = quality;
+  params.m_subsampling = (decltype(params.m_subsampling))subsampling;
+  Encoder encoder;
+  if(!encoder.init(&stream, width, height, channels, params))
+    return std::vector<uint8_t>();
+  for(int y = 0; y < height; y++)
+    encoder.process_scanline(pixels + (size_t)y * width * channels);
+  encoder.process_scanline(NULL);
+  return stream.data;
+}
+
+static inline std::vector<uint8_t> encodeCurrent(const uint8_t * pixels, int width, int height, int channels,
+                                                 int quality, int subsampling)
+{
+  return encode<jpge::jpeg_encoder, jpge::output_stream, jpge::params>(pixels, width, height, channels, quality,
+                                                                         subsampling);
+}
+
+static inline std::vector<uint8_t> encodeReference(const uint8_t * pixels, int width, int height, int channels,
+                                                   int quality, int subsampling)
+{
+  return encode<reference_jpge::jpeg_encoder, reference_jpge::output_stream, reference_jpge::params>(
+    pixels, width, height, channels, quality, subsampling);
+}
+
+// Grey frame: gradients, waves, flat squares with sharp edges and noise
+static inline std::vector<uint8_t> greyFrame(int width, int height, unsigned int seed)
+{
+  std::vector<uint8_t> grey((size_t)width * height);
+  srand(seed);
+  for(int y = 0; y < height; y++)
+  {
+    for(int x = 0; x < width; x++)
+    {
+      int v = (x * 255 / width + y * 128 / height) / 2 + 40 * sin(x * 0.05) * cos(y * 0.07) + (rand() % 24 - 12);
+      if((x / 60 + y / 60) % 3 == 0)
+        v = x % 60 < 30 ? 20 : 230;
+      grey[(size_t)y * width + x] = v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+  }
+  return grey;
+}
+
+// PSNR of a JPEG decoded by libjpeg against the grey frame, -1 if it does not decode cleanly
+static inline double greyPsnr(const std::vector<uint8_t> & jpeg, const std::vector<uint8_t> & grey, int width,
+                              int height)
+{
+  int w, h;
+  long warnings = 0;
+  uint8_t * decoded = decodeJpeg(jpeg.data(), jpeg.size(), 1, &w, &h, &warnings);
+  if(decoded == NULL || warnings != 0 || w != width || h != height)
+  {
+    free(decoded);
+    return -1;
+  }
+  double error = 0;
+  for(size_t i = 0; i < grey.size(); i++)
+    error += (double)(grey[i] - decoded[i]) * (grey[i] - decoded[i]);
+  free(decoded);
+  return error == 0 ? 99 : 10 * log10(255.0 * 255.0 * grey.size() / error);
+}
+
+#endif // __JPGE_COMMON_HPP
@@ -0,0 +1,55 @@
+/**
+ * @file jpgeGreyBench.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file times the grayscale encode of jpge, the encoder of the baseline against the
+ *         one with the fast path, on a VGA frame at several qualities: milliseconds per frame,
+ *         size and PSNR.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpgeCommon.hpp"
+#include <stdio.h>
+
+using namespace std;
+
+#define WIDTH 640
+#define HEIGHT 480
+#define RUNS 40
+
+// Best of RUNS encodes
+template <class Encode>
+static double bench(Encode encode, const vector<uint8_t> & grey, int quality, vector<uint8_t> & jpeg)
+{
+  double best = 1e30;
+  for(int run = 0; run < RUNS; run++)
+  {
+    double start = nowUs();
+    jpeg = encode(grey.data(), WIDTH, HEIGHT, 1, quality, jpge::Y_ONLY);
+    double elapsed = nowUs() - start;
+    if(elapsed < best)
+      best = elapsed;
+  }
+  return best / 1000;
+}
+
+int main(void)
+{
+  static const int QUALITY[] = {50, 80, 90, 95, 100};
+  vector<uint8_t> grey = greyFrame(WIDTH, HEIGHT, 1);
+
+  printf("%-8s %22s %22s %8s\n", "VGA", "reference ms/bytes/dB", "current ms/bytes/dB", "speedup");
+  for(int quality : QUALITY)
+  {
+    vector<uint8_t> reference, current;
+    double referenceTime = bench(encodeReference, grey, quality, reference);
+    double currentTime = bench(encodeCurrent, grey, quality, current);
+    printf("q%-7d %6.2f %7zu %6.2f %6.2f %7zu %6.2f %7.2fx\n", quality, referenceTime, reference.size(),
+           greyPsnr(reference, grey, WIDTH, HEIGHT), currentTime, current.size(), greyPsnr(current, grey, WIDTH, HEIGHT),
+           referenceTime / currentTime);
+  }
+  return 0;
+}
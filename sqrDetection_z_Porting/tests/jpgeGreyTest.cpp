@@ -0,0 +1,71 @@
+/**
+ * @file jpgeGreyTest.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file checks the grayscale fast path of jpge against the encoder of the baseline:
+ *         its JPEGs decode cleanly with libjpeg at every size (not only multiples of 8), lose at
+ *         most 0.25 dB of PSNR and grow at most 2%. Above JPGE_FAST_GREY_MAX_QUALITY, and for
+ *         colour, the output has to be the same as before, byte for byte.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "jpgeCommon.hpp"
+#include <stdio.h>
+
+using namespace std;
+
+static int failures = 0;
+
+static void fail(const char * what, int width, int height, int quality)
+{
+  printf("FAIL %dx%d q%d: %s\n", width, height, quality, what);
+  failures++;
+}
+
+int main(void)
+{
+  static const int SIZE[][2] = {{640, 480}, {101, 75}, {8, 8}, {1, 1}, {333, 217}};
+  static const int QUALITY[] = {1, 10, 30, 50, 80, 90, 95, 96, 100};
+  double worst = 0;
+  for(auto & size : SIZE)
+  {
+    int width = size[0], height = size[1];
+    vector<uint8_t> grey = greyFrame(width, height, width);
+    for(int quality : QUALITY)
+    {
+      vector<uint8_t> current = encodeCurrent(grey.data(), width, height, 1, quality, jpge::Y_ONLY);
+      vector<uint8_t> reference = encodeReference(grey.data(), width, height, 1, quality, reference_jpge::Y_ONLY);
+      double psnr = greyPsnr(current, grey, width, height), referencePsnr = greyPsnr(reference, grey, width, height);
+      if(psnr < 0)
+        fail("does not decode cleanly", width, height, quality);
+      else if(psnr < referencePsnr - 0.25)
+        fail("PSNR lost", width, height, quality);
+      else if(current.size() > reference.size() * 1.02 + 16)
+        fail("JPEG grown", width, height, quality);
+      else if(quality > JPGE_FAST_GREY_MAX_QUALITY && current != reference)
+        fail("output of the generic path changed", width, height, quality);
+      if(referencePsnr - psnr > worst)
+        worst = referencePsnr - psnr;
+    }
+  }
+
+  // Colour goes through the generic path, unchanged
+  static const int SUBSAMPLING[] = {jpge::H1V1, jpge::H2V1, jpge::H2V2};
+  vector<uint8_t> rgb((size_t)333 * 217 * 3);
+  synthFrame(rgb.data(), 333, 217, 1, false);
+  for(int subsampling : SUBSAMPLING)
+  {
+    for(int quality : QUALITY)
+    {
+      if(encodeCurrent(rgb.data(), 333, 217, 3, quality, subsampling) !=
+         encodeReference(rgb.data(), 333, 217, 3, quality, subsampling))
+        fail("colour output changed", 333, 217, quality);
+    }
+  }
+
+  printf("worst PSNR loss %.2f dB, %d failures\n", worst, failures);
+  return failures != 0;
+}
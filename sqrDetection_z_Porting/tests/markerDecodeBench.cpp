@@ -0,0 +1,143 @@
+/**
+ * @file markerDecodeBench.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file measures decodeMarker on synthetic 800x600 frames: 20 MARKERS_4X4_32 markers
+ *         in perspective at 10, 6 and 4 pixels per cell, and blank quads (black, textured) that
+ *         have to be rejected. The corners are given with 0.3 px of noise, from a random corner
+ *         and in either direction. It reports the right ids and rotations, the false accepts and
+ *         the time per decode.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <opencv2/imgproc.hpp>
+#include <markerDecoder.hpp>
+#include <stdio.h>
+#include <time.h>
+
+using namespace std;
+using namespace cv;
+
+#define WIDTH 800
+#define HEIGHT 600
+#define MARKERS 20
+#define COLUMNS 7
+#define FRAMES 20
+#define RUNS 50
+
+static double nowUs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+struct Quad
+{
+  array<Point2f,4> corners; // clockwise from the top left corner of the marker
+  int id;                   // -1 for a blank quad
+};
+
+// Marker id (or a blank quad, black or textured) of cells x cells cells of 16 pixels
+static Mat markerImage(int id, RNG & rng)
+{
+  const MarkerDictionary & dictionary = MARKERS_4X4_32;
+  int cells = dictionary.bits + 2;
+  Mat image(cells * 16, cells * 16, CV_8UC1, Scalar(20));
+  if(id == -2)
+    rng.fill(image, RNG::UNIFORM, 0, 256);
+  for(int r = 0; id >= 0 && r < dictionary.bits; r++)
+  {
+    for(int c = 0; c < dictionary.bits; c++)
+    {
+      if(dictionary.codes[id] >> (r * dictionary.bits + c) & 1)
+        image(Rect((c + 1) * 16, (r + 1) * 16, 16, 16)).setTo(Scalar(235));
+    }
+  }
+  return image;
+}
+
+// Frame with MARKERS markers and MARKERS / 4 blank quads on a grid, each turned and in perspective
+static Mat renderFrame(float cellSize, RNG & rng, vector<Quad> & quads)
+{
+  Mat frame(HEIGHT, WIDTH, CV_8UC1, Scalar(190));
+  float side = cellSize * (MARKERS_4X4_32.bits + 2);
+  float step = (float)WIDTH / COLUMNS;
+  quads.clear();
+  for(int k = 0; k < MARKERS + MARKERS / 4; k++)
+  {
+    Point2f center(step / 2 + (k % COLUMNS) * step + rng.uniform(-4.f, 4.f),
+                   step / 2 + (k / COLUMNS) * step + rng.uniform(-4.f, 4.f));
+    Quad quad;
+    quad.id = k < MARKERS ? rng.uniform(0, MARKERS_4X4_32.size) : -1 - k % 2;
+    float angle = rng.uniform(0.f, (float)(2 * CV_PI));
+    for(int c = 0; c < 4; c++)
+    {
+      float a = angle + c * CV_PI / 2 - 3 * CV_PI / 4;
+      float radius = side / sqrtf(2) * rng.uniform(0.85f, 1.15f);
+      quad.corners[c] = center + Point2f(radius * cosf(a), radius * sinf(a));
+    }
+    Mat image = markerImage(quad.id, rng);
+    Point2f source[4] = {Point2f(0, 0), Point2f(image.cols, 0), Point2f(image.cols, image.rows), Point2f(0, image.rows)};
+    warpPerspective(image, frame, getPerspectiveTransform(source, quad.corners.data()), frame.size(), INTER_AREA,
+                    BORDER_TRANSPARENT);
+    quads.push_back(quad);
+  }
+
+  GaussianBlur(frame, frame, Size(0, 0), 0.7);
+  Mat noise(frame.size(), CV_16SC1);
+  rng.fill(noise, RNG::NORMAL, 0, 3);
+  add(frame, noise, frame, noArray(), CV_8U);
+  return frame;
+}
+
+int main()
+{
+  static const float CELL_SIZE[] = {10, 6, 4};
+  printf("%-10s %8s %8s %8s %8s %10s\n", "px/cell", "markers", "ids", "rotation", "false", "us/decode");
+  for(float cellSize : CELL_SIZE)
+  {
+    RNG rng(cellSize);
+    unsigned int markers = 0, ids = 0, rotations = 0, falseAccepts = 0, decodes = 0;
+    double time = 0;
+    for(int f = 0; f < FRAMES; f++)
+    {
+      vector<Quad> quads;
+      Mat frame = renderFrame(cellSize, rng, quads);
+      for(const Quad & quad : quads)
+      {
+        // Noisy corners from a random corner s, in either direction: the marker is seen turned
+        // (4 - s) quarter turns clockwise from corners[0]
+        int start = rng.uniform(0, 4), direction = rng.uniform(0, 2) ? 1 : 3;
+        array<Point2f,4> corners;
+        for(int c = 0; c < 4; c++)
+          corners[c] = quad.corners[(start + c * direction) & 3] + Point2f(rng.gaussian(0.3), rng.gaussian(0.3));
+
+        int id = -1, rotation = -1;
+        bool found = false;
+        double begin = nowUs();
+        for(int run = 0; run < RUNS; run++)
+          found = decodeMarker(frame, corners, MARKERS_4X4_32, id, rotation);
+        time += nowUs() - begin;
+        decodes += RUNS;
+
+        if(quad.id < 0)
+        {
+          falseAccepts += found;
+          continue;
+        }
+        markers++;
+        if(found && id == quad.id)
+        {
+          ids++;
+          rotations += rotation == ((4 - start) & 3);
+        }
+      }
+    }
+    printf("%-10.0f %8u %8u %8u %8u %10.2f\n", cellSize, markers, ids, rotations, falseAccepts, time / decodes);
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file pixelConvertBench.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file times every pixel_convert kernel on a VGA frame: the reference loops and every
+ *         implementation the CPU supports, in microseconds per frame.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "pixelConvertKernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define RUNS 30
+
+static double now_us(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+// Best of RUNS conversions of a frame
+static double time_kernel(pixel_kernel_fn kernel, const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  double best = 1e30;
+  for(int run = 0; run < RUNS; run++)
+  {
+    double start = now_us();
+    kernel(src, dst, pixels);
+    double elapsed = now_us() - start;
+    if(elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+int main(void)
+{
+  size_t pixels = WIDTH * HEIGHT;
+  uint8_t *src = aligned_alloc(64, pixels * 4), *dst = aligned_alloc(64, pixels * 4);
+  srand(1);
+  for(size_t i = 0; i < pixels * 4; i++)
+    src[i] = rand();
+
+  printf("%-20s %10s", "us per VGA frame", "reference");
+  for(unsigned int i = 0; i < PIXEL_IMPL_COUNT; i++)
+  {
+    if(pixconv_select(PIXEL_IMPLS[i]))
+      printf(" %10s", pixconv_name());
+  }
+  printf("\n");
+
+  for(unsigned int k = 0; k < PIXEL_KERNEL_COUNT; k++)
+  {
+    const pixel_kernel_t *kernel = &PIXEL_KERNELS[k];
+    printf("%-20s %10.0f", kernel->name, time_kernel(kernel->reference, src, dst, pixels));
+    for(unsigned int i = 0; i < PIXEL_IMPL_COUNT; i++)
+    {
+      if(pixconv_select(PIXEL_IMPLS[i]))
+        printf(" %10.0f", time_kernel(kernel->kernel, src, dst, pixels));
+    }
+    printf("\n");
+  }
+
+  free(src);
+  free(dst);
+  return 0;
+}
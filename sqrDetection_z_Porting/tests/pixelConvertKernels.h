@@ -0,0 +1,48 @@
+/**
+ * @file pixelConvertKernels.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the list of the pixel_convert kernels with their reference loops and
+ *         the implementations to compare, shared by the test and the benchmark.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __PIXELCONVERTKERNELS_H
+#define __PIXELCONVERTKERNELS_H
+
+#include <pixel_convert.h>
+#include "reference/reference.h"
+
+typedef void (*pixel_kernel_fn)(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+typedef struct {
+  const char *name;
+  pixel_kernel_fn kernel;
+  pixel_kernel_fn reference;
+  int in_bytes;   // bytes per input pixel
+  int out_bytes;  // bytes per output pixel
+} pixel_kernel_t;
+
+static const pixel_kernel_t PIXEL_KERNELS[] = {
+  {"rgb565_to_rgb888",   pixconv_rgb565_to_rgb888,   reference_rgb565_to_rgb888,   2, 3},
+  {"rgb565_to_bgr888",   pixconv_rgb565_to_bgr888,   reference_rgb565_to_bgr888,   2, 3},
+  {"rgb565_to_gray",     pixconv_rgb565_to_gray,     reference_rgb565_to_gray,     2, 1},
+  {"rgb888_to_rgb565le", pixconv_rgb888_to_rgb565le, reference_rgb888_to_rgb565le, 3, 2},
+  {"rgb888_to_gray",     pixconv_rgb888_to_gray,     reference_rgb888_to_gray,     3, 1},
+  {"bgr888_to_gray",     pixconv_bgr888_to_gray,     reference_bgr888_to_gray,     3, 1},
+  {"gray_to_rgb888",     pixconv_gray_to_rgb888,     reference_gray_to_rgb888,     1, 3},
+  {"swap_rb",            pixconv_swap_rb,            reference_swap_rb,            3, 3},
+  {"yuyv_to_rgb888",     pixconv_yuyv_to_rgb888,     reference_yuyv_to_rgb888,     2, 3},
+  {"yuyv_to_bgr888",     pixconv_yuyv_to_bgr888,     reference_yuyv_to_bgr888,     2, 3},
+  {"yuyv_to_gray",       pixconv_yuyv_to_gray,       reference_yuyv_to_gray,       2, 1},
+};
+#define PIXEL_KERNEL_COUNT (sizeof(PIXEL_KERNELS) / sizeof(PIXEL_KERNELS[0]))
+
+// Implementations compared (the ones the CPU does not support are skipped)
+static const pixconv_impl_t PIXEL_IMPLS[] = {PIXCONV_SCALAR, PIXCONV_SWAR, PIXCONV_SSSE3, PIXCONV_NEON};
+#define PIXEL_IMPL_COUNT (sizeof(PIXEL_IMPLS) / sizeof(PIXEL_IMPLS[0]))
+
+#endif // __PIXELCONVERTKERNELS_H
@@ -0,0 +1,137 @@
+/**
+ * @file pixelConvertTest.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file checks every implementation of every pixel_convert kernel against the loops it
+ *         replaced: every RGB565 value, every 24-bit triple and every (Y, U, V) combination, then
+ *         lengths 0..69 at every source and destination alignment, and the in-place swap.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "pixelConvertKernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes checked after the output, for overruns
+#define GUARD 64
+
+static int failures = 0;
+
+// Run a kernel with every implementation and every destination alignment, compare with the reference
+static void check(const pixel_kernel_t *k, const uint8_t *in, size_t pixels)
+{
+  size_t size = pixels * k->out_bytes + GUARD;
+  uint8_t *expected = malloc(size), *out = malloc(size + 4);
+  memset(expected, 0xA5, size);
+  k->reference(in, expected, pixels);
+
+  for(unsigned int i = 0; i < PIXEL_IMPL_COUNT; i++)
+  {
+    if(!pixconv_select(PIXEL_IMPLS[i]))
+      continue;
+    for(int offset = 0; offset < 4; offset++)
+    {
+      memset(out, 0xA5, size + 4);
+      k->kernel(in, out + offset, pixels);
+      if(memcmp(out + offset, expected, size) != 0)
+      {
+        printf("FAIL %s (%s): %zu pixels, destination offset %d\n", k->name, pixconv_name(), pixels, offset);
+        failures++;
+        break;
+      }
+    }
+  }
+  free(expected);
+  free(out);
+}
+
+int main(void)
+{
+  // Every 24-bit triple
+  size_t triples = 1u << 24;
+  uint8_t *rgb = malloc(triples * 3 + GUARD);
+  for(size_t i = 0; i < triples; i++)
+  {
+    rgb[3 * i] = i;
+    rgb[3 * i + 1] = i >> 8;
+    rgb[3 * i + 2] = i >> 16;
+  }
+  // Every RGB565 value
+  uint8_t *rgb565 = malloc(65536 * 2 + GUARD);
+  for(size_t i = 0; i < 65536; i++)
+  {
+    rgb565[2 * i] = i >> 8;
+    rgb565[2 * i + 1] = i;
+  }
+  // Every (Y, U, V) for both pixels of a pair: (y, u, y ^ 0x5a, v)
+  uint8_t *yuyv = malloc(triples * 4 + GUARD);
+  for(size_t i = 0; i < triples; i++)
+  {
+    yuyv[4 * i] = i;
+    yuyv[4 * i + 1] = i >> 8;
+    yuyv[4 * i + 2] = i ^ 0x5a;
+    yuyv[4 * i + 3] = i >> 16;
+  }
+
+  for(unsigned int k = 0; k < PIXEL_KERNEL_COUNT; k++)
+  {
+    const pixel_kernel_t *kernel = &PIXEL_KERNELS[k];
+    const uint8_t *in;
+    size_t pixels;
+    if(kernel->in_bytes == 1)
+    {
+      in = rgb;
+      pixels = 1 << 20;
+    }
+    else if(kernel->in_bytes == 3)
+    {
+      in = rgb;
+      pixels = triples;
+    }
+    else if(strncmp(kernel->name, "yuyv", 4) == 0)
+    {
+      in = yuyv;
+      pixels = triples * 2;
+    }
+    else
+    {
+      in = rgb565;
+      pixels = 65536;
+    }
+    check(kernel, in, pixels);
+
+    // Tails and source alignments
+    for(size_t len = 0; len < 70; len++)
+    {
+      for(int offset = 0; offset < 4; offset++)
+        check(kernel, in + offset * kernel->in_bytes + offset, len);
+    }
+    printf("%-20s checked\n", kernel->name);
+  }
+
+  // In place
+  for(unsigned int i = 0; i < PIXEL_IMPL_COUNT; i++)
+  {
+    if(!pixconv_select(PIXEL_IMPLS[i]))
+      continue;
+    uint8_t buffer[3003], expected[3003];
+    memcpy(buffer, rgb + 7, sizeof(buffer));
+    reference_swap_rb(rgb + 7, expected, 1001);
+    pixconv_swap_rb(buffer, buffer, 1001);
+    if(memcmp(buffer, expected, sizeof(buffer)) != 0)
+    {
+      printf("FAIL swap_rb in place (%s)\n", pixconv_name());
+      failures++;
+    }
+  }
+
+  free(rgb);
+  free(rgb565);
+  free(yuyv);
+  printf(failures ? "%d failures\n" : "all kernels match the reference\n", failures);
+  return failures != 0;
+}
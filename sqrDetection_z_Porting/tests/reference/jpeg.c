@@ -0,0 +1,65 @@
+/**
+ * @file jpeg.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file decodes a JPEG to RGB888 with the TJpgDec of the baseline (reference/tjpgd.c).
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "reference.h"
+#include "tjpgd.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Memory pool of the baseline decoder (as esp_jpg_decode.c)
+#define WORK_LEN 3100
+
+typedef struct {
+  const uint8_t *src;
+  size_t len;
+  size_t index;
+  uint8_t *rgb;
+  int width;
+} reference_jpeg_t;
+
+static UINT reference_read(JDEC *decoder, BYTE *buf, UINT len)
+{
+  reference_jpeg_t *jpeg = (reference_jpeg_t *)decoder->device;
+  if(len > jpeg->len - jpeg->index)
+    len = jpeg->len - jpeg->index;
+  if(buf)
+    memcpy(buf, jpeg->src + jpeg->index, len);
+  jpeg->index += len;
+  return len;
+}
+
+static UINT reference_write(JDEC *decoder, void *bitmap, JRECT *rect)
+{
+  reference_jpeg_t *jpeg = (reference_jpeg_t *)decoder->device;
+  size_t w = rect->right - rect->left + 1;
+  const BYTE *src = (const BYTE *)bitmap;
+  for(int y = rect->top; y <= rect->bottom; y++, src += w * 3)
+    memcpy(jpeg->rgb + ((size_t)y * jpeg->width + rect->left) * 3, src, w * 3);
+  return 1;
+}
+
+uint8_t *reference_jpeg_decode(const uint8_t *src, size_t len, int scale, int *width, int *height)
+{
+  static uint8_t work[WORK_LEN];
+  reference_jpeg_t jpeg = {src, len, 0, NULL, 0};
+  JDEC decoder;
+  if(jd_prepare(&decoder, reference_read, work, WORK_LEN, &jpeg) != JDR_OK)
+    return NULL;
+  *width = jpeg.width = decoder.width >> scale;
+  *height = decoder.height >> scale;
+  jpeg.rgb = calloc((size_t)*width * *height * 3, 1);
+  if(jpeg.rgb == NULL || jd_decomp(&decoder, reference_write, scale) != JDR_OK)
+  {
+    free(jpeg.rgb);
+    return NULL;
+  }
+  return jpeg.rgb;
+}
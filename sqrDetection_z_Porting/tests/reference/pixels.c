@@ -0,0 +1,167 @@
+/**
+ * @file pixels.c
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the pixel loops as they were in to_bmp.c, to_jpg.cpp and bitmapUtils.c
+ *         before pixel_convert.c. The gray conversions had no loop of their own (cvtColor was used):
+ *         they apply the BT.601 weights documented in pixel_convert.h to the RGB888 pixels.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include "reference.h"
+
+static uint8_t gray(int r, int g, int b)
+{
+  return (r * 4899 + g * 9617 + b * 1868 + 8192) >> 14;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// to_jpg.cpp convert_line_format (RGB565)
+void reference_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t i, o = 0;
+  for(i = 0; i < pixels * 2; i += 2)
+  {
+    dst[o++] = src[i] & 0xF8;
+    dst[o++] = (src[i] & 0x07) << 5 | (src[i+1] & 0xE0) >> 3;
+    dst[o++] = (src[i+1] & 0x1F) << 3;
+  }
+}
+
+// to_bmp.c fmt2rgb888 and bitmapUtils.c frm2bmp (RGB565)
+void reference_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t i;
+  uint8_t hb, lb;
+  for(i = 0; i < pixels; i++)
+  {
+    hb = *src++;
+    lb = *src++;
+    *dst++ = (lb & 0x1F) << 3;
+    *dst++ = (hb & 0x07) << 5 | (lb & 0xE0) >> 3;
+    *dst++ = hb & 0xF8;
+  }
+}
+
+void reference_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  uint8_t rgb[3];
+  for(size_t i = 0; i < pixels; i++)
+  {
+    reference_rgb565_to_rgb888(src + 2 * i, rgb, 1);
+    dst[i] = gray(rgb[0], rgb[1], rgb[2]);
+  }
+}
+
+// bitmapUtils.c _rgb565_write
+void reference_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t ix, ix2;
+  for(ix2 = ix = 0; ix < pixels * 3; ix += 3, ix2 += 2)
+  {
+    uint16_t r = src[ix];
+    uint16_t g = src[ix+1];
+    uint16_t b = src[ix+2];
+    uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    dst[ix2+1] = c>>8;
+    dst[ix2] = c&0xff;
+  }
+}
+
+void reference_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  for(size_t i = 0; i < pixels; i++)
+    dst[i] = gray(src[3*i], src[3*i+1], src[3*i+2]);
+}
+
+void reference_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  for(size_t i = 0; i < pixels; i++)
+    dst[i] = gray(src[3*i+2], src[3*i+1], src[3*i]);
+}
+
+// to_bmp.c fmt2rgb888 (GRAYSCALE)
+void reference_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t i;
+  uint8_t b;
+  for(i = 0; i < pixels; i++)
+  {
+    b = *src++;
+    *dst++ = b;
+    *dst++ = b;
+    *dst++ = b;
+  }
+}
+
+// bitmapUtils.c _rgb_write
+void reference_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t ix;
+  for(ix = 0; ix < pixels * 3; ix += 3)
+  {
+    dst[ix] = src[ix+2];
+    dst[ix+1] = src[ix+1];
+    dst[ix+2] = src[ix];
+  }
+}
+
+// to_jpg.cpp convert_line_format (YUV422)
+void reference_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t i, o = 0;
+  uint8_t y0, y1, u, v;
+  uint8_t r, g, b;
+  for(i = 0; i + 4 <= (pixels / 2) * 4; i += 4)
+  {
+    y0 = src[i];
+    u = src[i+1];
+    y1 = src[i+2];
+    v = src[i+3];
+
+    reference_yuv2rgb(y0, u, v, &r, &g, &b);
+    dst[o++] = r;
+    dst[o++] = g;
+    dst[o++] = b;
+
+    reference_yuv2rgb(y1, u, v, &r, &g, &b);
+    dst[o++] = r;
+    dst[o++] = g;
+    dst[o++] = b;
+  }
+}
+
+// to_bmp.c fmt2rgb888 (YUV422)
+void reference_yuyv_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  size_t i, maxi = pixels / 2;
+  uint8_t y0, y1, u, v;
+  uint8_t r, g, b;
+  for(i = 0; i < maxi; i++)
+  {
+    y0 = *src++;
+    u = *src++;
+    y1 = *src++;
+    v = *src++;
+
+    reference_yuv2rgb(y0, u, v, &r, &g, &b);
+    *dst++ = b;
+    *dst++ = g;
+    *dst++ = r;
+
+    reference_yuv2rgb(y1, u, v, &r, &g, &b);
+    *dst++ = b;
+    *dst++ = g;
+    *dst++ = r;
+  }
+}
+
+void reference_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+  for(size_t i = 0; i < pixels; i++)
+    dst[i] = src[2 * i];
+}
@@ -0,0 +1,59 @@
+/**
+ * @file reference.h
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file contains the code replaced by the optimized versions, kept as it was so the
+ *         tests can check that the new code gives the same results.
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#ifndef __REFERENCE_H
+#define __REFERENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+// Pixel loops of to_bmp.c, to_jpg.cpp and bitmapUtils.c before pixel_convert.c (reference/pixels.c)
+
+void reference_yuv2rgb(uint8_t y, uint8_t u, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b);
+
+void reference_rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_rgb565_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_rgb565_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_rgb888_to_rgb565le(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_rgb888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_bgr888_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_gray_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_swap_rb(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_yuyv_to_bgr888(const uint8_t *src, uint8_t *dst, size_t pixels);
+void reference_yuyv_to_gray(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+/*------------------------------------------------------------------------------------------------*/
+// JPEG decoding with the TJpgDec of the baseline (reference/jpeg.c, reference/tjpgd.c)
+
+/**
+ * @brief Decode a JPEG to RGB888 at 1/2^scale
+ *
+ * @param src JPEG stream
+ * @param len length of the stream
+ * @param scale 0..3
+ * @param width width of the output
+ * @param height height of the output
+ * @return uint8_t* output (free() it), NULL if the stream could not be decoded
+ */
+uint8_t *reference_jpeg_decode(const uint8_t *src, size_t len, int scale, int *width, int *height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __REFERENCE_H
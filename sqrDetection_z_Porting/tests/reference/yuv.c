@@ -11,8 +11,9 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
-#include "yuv.h"
-#include "esp_attr.h"
+// The YUYV to RGB conversion as it was in conversions/yuv.c before pixel_convert.c, kept as the
+// reference of the pixel_convert tests
+#include "reference.h"
 
 typedef struct {
         int16_t vY;
@@ -284,7 +285,7 @@ static const yuv_table_row yuv_table[256] = {
 
 #define YUYV_CONSTRAIN(v) ((v)<0)?0:(((v)>255)?255:(v))
 
-void IRAM_ATTR yuv2rgb(uint8_t y, uint8_t u, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+void reference_yuv2rgb(uint8_t y, uint8_t u, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
 {
     int16_t ri, gi, bi;
 
@@ -0,0 +1,29 @@
+/**
+ * @file stageBench.cpp
+ * @author simone maschio (simonemaschio01@gmail.com)
+ * @brief  This file runs the stage benchmark of the firmware (benchmark.cpp) on the host: the same
+ *         stage bodies on the same scenes, QVGA to UXGA (UXGA is skipped on the 4MB boards), with
+ *         the results written as the same JSON.
+ *         Usage: stageBench [output.json] [stage filter]
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+// ============================================= CODE ==============================================
+
+#include <benchmark.hpp>
+#include <stdio.h>
+
+int main(int argc, char ** argv)
+{
+  string path = argc > 1 ? argv[1] : "bench.json";
+  vector<BenchmarkResult> results;
+  runBenchmarks(results, argc > 2 ? argv[2] : NULL);
+  for(const BenchmarkResult & result : results)
+    printf("%-40s %10.1f us %6u iterations\n", result.name.c_str(), result.realTime, result.iterations);
+  if(!saveBenchmarks(results, path))
+    return 1;
+  printf("%zu results written to %s\n", results.size(), path.c_str());
+  return 0;
+}